@@ -0,0 +1,406 @@
+#include "agentSimulator.h"
+#include "error.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+namespace lcc {
+
+AgentSimulator::AgentSimulator(const Compartment& compartment, uint64_t seed) :
+        rules(compartment.getRuleNetwork()),
+        random(seed) {
+    for (size_t type = 0; type < rules.complexTypeCount(); type++) {
+        pools.push_back({ rules.getComplexType(type).domains.size(), {}, {} });
+    }
+
+    for (size_t species = 0; species < rules.speciesCount(); species++) {
+        const std::string& label = rules.getLabel(species);
+        if (!compartment.hasMolecule(label) || !compartment.getMolecule(label)->hasInitialCount()) {
+            continue;
+        }
+        double count = compartment.getMolecule(label)->getInitialCount();
+        if (count < 0) {
+            error("Species " + label + " has a negative initial count.");
+        }
+        const SpeciesGraph& graph = rules.getSpecies(species);
+        for (long copy = 0; copy < std::lround(count); copy++) {
+            int complex = complexes.size();
+            complexes.emplace_back();
+            liveComplexes++;
+            int first = agentTypes.size();
+            for (const Agent& agent : graph.agents) {
+                int id = addAgent(agent.type);
+                complexOf[id] = complex;
+                complexes[complex].push_back(id);
+                for (size_t d = 0; d < agent.sites.size(); d++) {
+                    SimSite& newSite = site(id, d);
+                    newSite.state = agent.sites[d].state;
+                    if (agent.sites[d].agent >= 0) {
+                        newSite.partner = first + agent.sites[d].agent;
+                        newSite.partnerDomain = agent.sites[d].domain;
+                    }
+                }
+            }
+        }
+    }
+
+    matches.resize(rules.ruleCount());
+    propensities.resize(rules.ruleCount(), 0);
+    for (size_t rule = 0; rule < rules.ruleCount(); rule++) {
+        for (const Pattern& pattern : rules.getRule(rule).reactants) {
+            MatchList list;
+            list.width = pattern.agents.size();
+            list.byAnchor.resize(agentTypes.size());
+            for (size_t agent = 0; agent < agentTypes.size(); agent++) {
+                rematch(list, pattern, agent);
+            }
+            matches[rule].push_back(std::move(list));
+        }
+        updatePropensity(rule);
+    }
+}
+
+double AgentSimulator::getTime() const {
+    return time;
+}
+
+size_t AgentSimulator::agentCount() const {
+    return agentTypes.size();
+}
+
+size_t AgentSimulator::complexCount() const {
+    return liveComplexes;
+}
+
+size_t AgentSimulator::eventCount() const {
+    return events;
+}
+
+double AgentSimulator::getPropensity(int rule) const {
+    return propensities[rule];
+}
+
+int AgentSimulator::addAgent(int type) {
+    AgentPool& pool = pools[type];
+    int id = agentTypes.size();
+    agentTypes.push_back(type);
+    agentSlots.push_back(pool.agents.size());
+    complexOf.push_back(-1);
+    pool.agents.push_back(id);
+    pool.sites.resize(pool.sites.size() + pool.domains);
+    return id;
+}
+
+AgentSimulator::SimSite& AgentSimulator::site(int agent, int domain) {
+    AgentPool& pool = pools[agentTypes[agent]];
+    return pool.sites[agentSlots[agent] * pool.domains + domain];
+}
+
+const AgentSimulator::SimSite& AgentSimulator::site(int agent, int domain) const {
+    const AgentPool& pool = pools[agentTypes[agent]];
+    return pool.sites[agentSlots[agent] * pool.domains + domain];
+}
+
+// Bonds to pattern agents that are not mapped yet are checked when their other end is mapped.
+bool AgentSimulator::matchAgent(const Pattern& pattern, size_t patternAgent, int agent,
+                                const std::vector<int>& mapped) const {
+    const AgentPattern& agentPattern = pattern.agents[patternAgent];
+    if (agentTypes[agent] != agentPattern.type) {
+        return false;
+    }
+    for (const SitePattern& sitePattern : agentPattern.sites) {
+        const SimSite& candidate = site(agent, sitePattern.domain);
+        if (sitePattern.state >= 0 && candidate.state != sitePattern.state) {
+            return false;
+        }
+        if (sitePattern.bond == BOND::FREE && candidate.partner >= 0) {
+            return false;
+        }
+        if ((sitePattern.bond == BOND::BOUND || sitePattern.bond == BOND::LABEL) && candidate.partner < 0) {
+            return false;
+        }
+        if (sitePattern.bond != BOND::LABEL) {
+            continue;
+        }
+        for (size_t other = 0; other < pattern.agents.size(); other++) {
+            for (const SitePattern& end : pattern.agents[other].sites) {
+                bool isPartner = end.bond == BOND::LABEL && end.label == sitePattern.label &&
+                                 !(other == patternAgent && end.domain == sitePattern.domain);
+                if (!isPartner) {
+                    continue;
+                }
+                int partnerAgent = other == patternAgent ? agent : mapped[other];
+                if (partnerAgent >= 0 && (candidate.partner != partnerAgent || candidate.partnerDomain != end.domain)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/* Pattern agents are mapped in order. One bound by a label to an agent mapped before can only be that agent's
+   partner; any other is searched for in the complex of the anchor. */
+void AgentSimulator::matchAt(const Pattern& pattern, int anchor, std::vector<int>& found) const {
+    std::vector<int> mapped(pattern.agents.size(), -1);
+    if (!matchAgent(pattern, 0, anchor, mapped)) {
+        return;
+    }
+    mapped[0] = anchor;
+
+    std::function<void(size_t)> extend = [&](size_t next) {
+        if (next == pattern.agents.size()) {
+            found.insert(found.end(), mapped.begin(), mapped.end());
+            return;
+        }
+        const std::vector<int>* candidates = &complexes[complexOf[anchor]];
+        std::vector<int> bound;
+        for (const SitePattern& sitePattern : pattern.agents[next].sites) {
+            if (sitePattern.bond != BOND::LABEL || !bound.empty()) {
+                continue;
+            }
+            for (size_t other = 0; other < next && bound.empty(); other++) {
+                for (const SitePattern& end : pattern.agents[other].sites) {
+                    if (end.bond == BOND::LABEL && end.label == sitePattern.label) {
+                        bound.push_back(site(mapped[other], end.domain).partner);
+                        break;
+                    }
+                }
+            }
+        }
+        if (!bound.empty()) {
+            candidates = &bound;
+        }
+        for (int agent : *candidates) {
+            if (agent < 0 || std::find(mapped.begin(), mapped.begin() + next, agent) != mapped.begin() + next ||
+                !matchAgent(pattern, next, agent, mapped)) {
+                continue;
+            }
+            mapped[next] = agent;
+            extend(next + 1);
+            mapped[next] = -1;
+        }
+    };
+    extend(1);
+}
+
+// Replaces the matches of list anchored at agent with its current ones.
+void AgentSimulator::rematch(MatchList& list, const Pattern& pattern, int agent) {
+    std::vector<int>& anchored = list.byAnchor[agent];
+    // removed from the back, so that moving the last match into a hole never moves one of agent's own
+    std::sort(anchored.begin(), anchored.end());
+    while (!anchored.empty()) {
+        int match = anchored.back();
+        anchored.pop_back();
+        int last = list.size() - 1;
+        if (match != last) {
+            std::copy(list.agents.begin() + last * list.width, list.agents.begin() + (last + 1) * list.width,
+                      list.agents.begin() + match * list.width);
+            std::vector<int>& moved = list.byAnchor[list.agents[match * list.width]];
+            *std::find(moved.begin(), moved.end(), last) = match;
+        }
+        list.agents.resize(last * list.width);
+    }
+
+    size_t before = list.size();
+    matchAt(pattern, agent, list.agents);
+    for (size_t match = before; match < list.size(); match++) {
+        anchored.push_back(match);
+    }
+}
+
+void AgentSimulator::updatePropensity(int rule) {
+    const RuleNetwork::Rule& compiled = rules.getRule(rule);
+    double propensity = compiled.rate;
+    for (const MatchList& list : matches[rule]) {
+        propensity *= list.size();
+    }
+    propensities[rule] = compiled.symmetric ? propensity / 2 : propensity;
+}
+
+bool AgentSimulator::step(double endTime) {
+    double total = 0;
+    for (double propensity : propensities) {
+        total += propensity;
+    }
+    std::uniform_real_distribution<double> uniform(0, 1);
+    double wait = total > 0 ? -std::log(1 - uniform(random)) / total : INFINITY;
+    if (time + wait > endTime) {
+        time = endTime;
+        return false;
+    }
+    time += wait;
+
+    double pick = uniform(random) * total;
+    size_t rule = 0;
+    while (rule + 1 < propensities.size() && pick >= propensities[rule]) {
+        pick -= propensities[rule];
+        rule++;
+    }
+    if (fire(rule)) {
+        events++;
+    }
+    return true;
+}
+
+void AgentSimulator::run(double endTime) {
+    while (step(endTime)) {
+    }
+}
+
+/* Applies rule to randomly picked matches of its reactants. Returns false for a null event: the picks are in
+   one complex, or a domain the rule binds is taken. */
+bool AgentSimulator::fire(int ruleId) {
+    const RuleNetwork::Rule& rule = rules.getRule(ruleId);
+    std::vector<int> ruleAgents;
+    for (MatchList& list : matches[ruleId]) {
+        if (list.size() == 0) {
+            return false;
+        }
+        size_t match = std::uniform_int_distribution<size_t>(0, list.size() - 1)(random);
+        ruleAgents.insert(ruleAgents.end(), list.agents.begin() + match * list.width,
+                          list.agents.begin() + (match + 1) * list.width);
+    }
+    if (rule.offsets.size() == 2 && complexOf[ruleAgents[0]] == complexOf[ruleAgents[rule.offsets[1]]]) {
+        return false;
+    }
+
+    auto isBroken = [&](int agent, int domain) {
+        return std::any_of(rule.breaks.begin(), rule.breaks.end(), [&](const RuleNetwork::RuleSite& broken) {
+            const SimSite& brokenSite = site(ruleAgents[broken.agent], broken.domain);
+            return (ruleAgents[broken.agent] == agent && broken.domain == domain) ||
+                   (brokenSite.partner == agent && brokenSite.partnerDomain == domain);
+        });
+    };
+    for (const RuleNetwork::Bond& bond : rule.bonds) {
+        for (const RuleNetwork::RuleSite& end : { bond.first, bond.second }) {
+            int agent = ruleAgents[end.agent];
+            if (site(agent, end.domain).partner >= 0 && !isBroken(agent, end.domain)) {
+                return false;
+            }
+        }
+    }
+
+    // every agent of the complexes the rule touches, before it changes them
+    std::vector<int> touched;
+    std::vector<int> changed = ruleAgents;
+    for (int agent : ruleAgents) {
+        std::vector<int>& members = complexes[complexOf[agent]];
+        if (!members.empty()) {
+            touched.insert(touched.end(), members.begin(), members.end());
+            freeComplexes.push_back(complexOf[agent]);
+            liveComplexes--;
+            members.clear();
+        }
+    }
+
+    for (const RuleNetwork::StateChange& change : rule.stateChanges) {
+        site(ruleAgents[change.site.agent], change.site.domain).state = change.state;
+    }
+    for (const RuleNetwork::RuleSite& broken : rule.breaks) {
+        SimSite& brokenSite = site(ruleAgents[broken.agent], broken.domain);
+        if (brokenSite.partner >= 0) {
+            changed.push_back(brokenSite.partner);
+            SimSite& partnerSite = site(brokenSite.partner, brokenSite.partnerDomain);
+            partnerSite.partner = partnerSite.partnerDomain = -1;
+            brokenSite.partner = brokenSite.partnerDomain = -1;
+        }
+    }
+    for (const RuleNetwork::Bond& bond : rule.bonds) {
+        SimSite& first = site(ruleAgents[bond.first.agent], bond.first.domain);
+        SimSite& second = site(ruleAgents[bond.second.agent], bond.second.domain);
+        first.partner = ruleAgents[bond.second.agent];
+        first.partnerDomain = bond.second.domain;
+        second.partner = ruleAgents[bond.first.agent];
+        second.partnerDomain = bond.first.domain;
+    }
+    rebuildComplexes(touched);
+
+    // a single agent pattern only sees its own sites; larger ones see the whole complex
+    for (size_t other = 0; other < matches.size(); other++) {
+        const RuleNetwork::Rule& otherRule = rules.getRule(other);
+        for (size_t reactant = 0; reactant < matches[other].size(); reactant++) {
+            MatchList& list = matches[other][reactant];
+            for (int agent : list.width == 1 ? changed : touched) {
+                rematch(list, otherRule.reactants[reactant], agent);
+            }
+        }
+        updatePropensity(other);
+    }
+    return true;
+}
+
+void AgentSimulator::rebuildComplexes(const std::vector<int>& agents) {
+    for (int agent : agents) {
+        complexOf[agent] = -1;
+    }
+    for (int start : agents) {
+        if (complexOf[start] >= 0) {
+            continue;
+        }
+        int complex;
+        if (freeComplexes.empty()) {
+            complex = complexes.size();
+            complexes.emplace_back();
+        } else {
+            complex = freeComplexes.back();
+            freeComplexes.pop_back();
+        }
+        liveComplexes++;
+        std::vector<int>& members = complexes[complex];
+        members.push_back(start);
+        complexOf[start] = complex;
+        for (size_t i = 0; i < members.size(); i++) {
+            const AgentPool& pool = pools[agentTypes[members[i]]];
+            for (size_t d = 0; d < pool.domains; d++) {
+                int partner = site(members[i], d).partner;
+                if (partner >= 0 && complexOf[partner] < 0) {
+                    complexOf[partner] = complex;
+                    members.push_back(partner);
+                }
+            }
+        }
+    }
+}
+
+size_t AgentSimulator::countMatches(const Pattern& pattern) const {
+    std::vector<int> found;
+    for (size_t agent = 0; agent < agentTypes.size(); agent++) {
+        matchAt(pattern, agent, found);
+    }
+    return found.size() / pattern.agents.size();
+}
+
+std::map<std::string, size_t> AgentSimulator::getPopulations() const {
+    std::map<std::string, size_t> populations;
+    std::vector<int> index(agentTypes.size(), -1);
+    for (const std::vector<int>& members : complexes) {
+        if (members.empty()) {
+            continue;
+        }
+        for (size_t i = 0; i < members.size(); i++) {
+            index[members[i]] = i;
+        }
+        SpeciesGraph graph;
+        for (int member : members) {
+            Agent agent;
+            agent.type = agentTypes[member];
+            for (size_t d = 0; d < pools[agent.type].domains; d++) {
+                const SimSite& memberSite = site(member, d);
+                Site copy;
+                copy.state = memberSite.state;
+                if (memberSite.partner >= 0) {
+                    copy.agent = index[memberSite.partner];
+                    copy.domain = memberSite.partnerDomain;
+                }
+                agent.sites.push_back(copy);
+            }
+            graph.agents.push_back(std::move(agent));
+        }
+        populations[rules.canonicalize(graph)]++;
+    }
+    return populations;
+}
+
+}
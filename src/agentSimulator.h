@@ -0,0 +1,109 @@
+#pragma once
+
+#include "context.h"
+#include "ruleNetwork.h"
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace lcc {
+
+/*  Agent Simulator:
+    --------------------------------------
+    Network-free stochastic simulation of the rules of a compartment (see
+    ruleNetwork.h), in the style of NFsim. Instead of species and reactions,
+    it keeps every agent of the system with its sites and bonds and applies
+    the rules to them directly, so its cost grows with the number of agents
+    and not with the number of species they could form.
+
+    For every reactant pattern of every rule, the simulator keeps the list of
+    its matches in the system, each anchored at the agent matched by the first
+    agent of the pattern. The propensity of a rule is its rate times the
+    number of matches of its reactants (halved for A + A). Firing a rule only
+    re-matches the agents of the complexes it touched, so match counts, and
+    with them propensities, are kept up to date incrementally. Bimolecular
+    rules pick each reactant independently, and a pick of two matches in the
+    same complex is a null event, as in NFsim.
+
+    Agents of one complex type share a pool: their sites are stored
+    contiguously, one block of the type's domains per agent.
+*/
+
+class AgentSimulator {
+    public:
+        /* Agents for the initial count of every species of the compartment's rule network, ie. every
+           seed such as EGFR(lig, Y1:off) = 50. The compartment must outlive the simulator. */
+        AgentSimulator(const Compartment& compartment, uint64_t seed = 1);
+
+        double getTime() const;
+        size_t agentCount() const;
+        size_t complexCount() const;
+        // rule firings, not counting null events
+        size_t eventCount() const;
+
+        /* Advances time to the next event and fires it, if it happens before endTime. Returns false,
+           with time at endTime, once no event does. */
+        bool step(double endTime);
+        void run(double endTime);
+
+        double getPropensity(int rule) const;
+        // matches of pattern anywhere in the system
+        size_t countMatches(const Pattern& pattern) const;
+        // population of every species present, by canonical label; walks every complex
+        std::map<std::string, size_t> getPopulations() const;
+
+    private:
+        struct SimSite {
+            int state = -1;
+            int partner = -1;       // bound agent, -1 if free
+            int partnerDomain = -1;
+        };
+        struct AgentPool {
+            size_t domains;
+            std::vector<SimSite> sites;     // domains sites per agent, in slot order
+            std::vector<int> agents;        // slot -> agent
+        };
+        // matches of one reactant pattern of one rule
+        struct MatchList {
+            size_t width;                               // agents of the pattern
+            std::vector<int> agents;                    // width agents per match
+            std::vector<std::vector<int>> byAnchor;     // agent -> matches anchored at it
+
+            size_t size() const { return agents.size() / width; }
+        };
+
+        int addAgent(int type);
+        SimSite& site(int agent, int domain);
+        const SimSite& site(int agent, int domain) const;
+
+        bool matchAgent(const Pattern& pattern, size_t patternAgent, int agent, const std::vector<int>& mapped) const;
+        // appends every match of pattern anchored at anchor to matches, width agents each
+        void matchAt(const Pattern& pattern, int anchor, std::vector<int>& matches) const;
+        void rematch(MatchList& list, const Pattern& pattern, int agent);
+        void updatePropensity(int rule);
+
+        bool fire(int rule);
+        // regroups agents, the members of the complexes an event touched, into connected complexes
+        void rebuildComplexes(const std::vector<int>& agents);
+
+        const RuleNetwork& rules;
+        std::mt19937_64 random;
+        double time = 0;
+        size_t events = 0;
+
+        std::vector<AgentPool> pools;               // one per complex type
+        std::vector<int> agentTypes;
+        std::vector<int> agentSlots;
+        std::vector<int> complexOf;
+        std::vector<std::vector<int>> complexes;    // complex -> agents, empty once merged or split
+        std::vector<int> freeComplexes;
+        size_t liveComplexes = 0;
+
+        std::vector<std::vector<MatchList>> matches;    // rule -> reactant -> matches
+        std::vector<double> propensities;
+};
+
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "ast.h"
+
+#include <cstddef>
+#include <new>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+/*  AST Arena:
+    --------------------------------------
+    Every node of a compilation is allocated out of an AstArena instead of
+    with 'new'. The arena keeps one NodePool per concrete node class, and each
+    pool hands out slots from fixed-size chunks with a bump index, so node
+    allocation is a pointer increment and nodes of the same class sit next
+    to each other in memory.
+
+    Nodes never delete their children or next statement; the arena owns all of
+    them. reset() runs every destructor and rewinds the pools while keeping
+    their chunks around for the next compilation, and the chunks themselves
+    are only released when the arena is destroyed.
+*/
+
+template<typename T, size_t ChunkSize = 256>
+class NodePool {
+    public:
+        NodePool() : count(0) {}
+        ~NodePool() {
+            reset();
+            for (Slot* chunk : chunks) {
+                delete[] chunk;
+            }
+        }
+        NodePool(const NodePool&) = delete;
+        NodePool& operator=(const NodePool&) = delete;
+
+        template<typename... Args>
+        T* make(Args&&... args) {
+            size_t chunk = count / ChunkSize;
+            if (chunk == chunks.size()) {
+                chunks.push_back(new Slot[ChunkSize]);
+            }
+            void* slot = chunks[chunk][count % ChunkSize].bytes;
+            T* node = new (slot) T(std::forward<Args>(args)...);
+            count++;
+            return node;
+        }
+
+        // destroys every node in the pool but keeps the chunks for reuse
+        void reset() {
+            for (size_t i = 0; i < count; i++) {
+                at(i)->~T();
+            }
+            count = 0;
+        }
+
+        size_t size() const {
+            return count;
+        }
+
+        size_t capacity() const {
+            return chunks.size() * ChunkSize;
+        }
+
+    private:
+        struct Slot {
+            alignas(T) unsigned char bytes[sizeof(T)];
+        };
+
+        T* at(size_t i) {
+            return std::launder(reinterpret_cast<T*>(chunks[i / ChunkSize][i % ChunkSize].bytes));
+        }
+
+        std::vector<Slot*> chunks;
+        size_t count;
+};
+
+class AstArena {
+    public:
+        AstArena() {}
+        AstArena(const AstArena&) = delete;
+        AstArena& operator=(const AstArena&) = delete;
+
+        template<typename T, typename... Args>
+        T* make(Args&&... args) {
+            return std::get<NodePool<T>>(pools).make(std::forward<Args>(args)...);
+        }
+
+        void reset() {
+            std::apply([](auto&... pool) { (pool.reset(), ...); }, pools);
+        }
+
+        // total number of live nodes across all pools
+        size_t size() const {
+            size_t total = 0;
+            std::apply([&total](const auto&... pool) { ((total += pool.size()), ...); }, pools);
+            return total;
+        }
+
+    private:
+        std::tuple<NodePool<ASTNode>,
+                   NodePool<UnaryNode>,
+                   NodePool<BinaryNode>,
+                   NodePool<TernaryNode>,
+                   NodePool<NumberNode>,
+                   NodePool<SymbolNode>,
+                   NodePool<LoopingNode>,
+                   NodePool<IfNode>,
+                   NodePool<IfElseNode>,
+                   NodePool<IdentifierNode>,
+                   NodePool<FunctionNode>,
+                   NodePool<ChemicalNode>,
+                   NodePool<ReturnNode>,
+                   NodePool<KeywordNode>,
+                   NodePool<ImportNode>,
+                   NodePool<ParamNode>,
+                   NodePool<IndexNode>,
+                   NodePool<SpeciesListNode>> pools;
+};
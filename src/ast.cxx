@@ -1,208 +1,239 @@
 #include "ast.h"
+#include "arena.h"
+#include "visitor.h"
+#include "walker.h"
 #include "error.h"
+#include "enumText.h"
+#include "units.h"
 #include <stack>
-
-// Requires all values in map are unique
-template <class Tkey, class Tvalue>
-std::unordered_map<Tvalue, Tkey> reverseMap (std::unordered_map<Tkey, Tvalue> map) {
-    std::unordered_map<Tvalue, Tkey> reversedMap;
-    for (auto &[key, value] : map) {
-        if (reversedMap.count(value) != 0) {
-            error("reverseMap() called on map with non-unique values.");
-        }
-        reversedMap[value] = key;
-    }
-    return reversedMap;
-}
-
-// Hashmaps for constant-time string->type conversion
-std::unordered_map<std::string, PREFIX> prefixTextToType {
-    { "Y", PREFIX::Y },    // yotta
-    { "Z", PREFIX::Z },    // zetta
-    { "E", PREFIX::E},    // exa
-    { "P", PREFIX::P },    // peta
-    { "T", PREFIX::T },    // tera
-    { "G", PREFIX::G },     // giga
-    { "M", PREFIX::M },     // mega
-    { "k", PREFIX::k },     // kilo
-    { "h", PREFIX::h },     // hecto
-    { "da", PREFIX::da},     // deka
-    { "d", PREFIX::d },    // deci
-    { "c", PREFIX::c },    // centi
-    { "m", PREFIX::m },    // milli
-    { "u", PREFIX::u },    // micro
-    { "n", PREFIX::n },    // nano
-    { "p", PREFIX::p },   // pico
-    { "f", PREFIX::f },   // femto
-    { "a", PREFIX::a },   // atto
-    { "z", PREFIX::z },   // zepto
-    { "y", PREFIX::y },   // yocto
-};
-
-std::unordered_map<PREFIX, std::string> prefixTypeToText = reverseMap(prefixTextToType);
-
-std::unordered_map<PREFIX, float> prefixToNumber {
-    { PREFIX::Y, 1e24 },    // yotta
-    { PREFIX::Z, 1e21 },    // zetta
-    { PREFIX::E, 1e18 },    // exa
-    { PREFIX::P, 1e15 },    // peta
-    { PREFIX::T, 1e12 },    // tera
-    { PREFIX::G, 1e9 },     // giga
-    { PREFIX::M, 1e6 },     // mega
-    { PREFIX::k, 1e3 },     // kilo
-    { PREFIX::h, 1e2 },     // hecto
-    { PREFIX::da, 1e1 },    // deka
-    {PREFIX::NO_PREFIX, 1e0},
-    { PREFIX::d, 1e-1 },    // deci
-    { PREFIX::c, 1e-2 },    // centi
-    { PREFIX::m, 1e-3 },    // milli
-    { PREFIX::u, 1e-6 },    // micro
-    { PREFIX::n, 1e-9 },    // nano
-    { PREFIX::p, 1e-12 },   // pico
-    { PREFIX::f, 1e-15 },   // femto
-    { PREFIX::a, 1e-18 },   // atto
-    { PREFIX::z, 1e-21 },   // zepto
-    { PREFIX::y, 1e-24 },   // yocto
+#include <algorithm>
+
+/* Text <-> type tables for conversion in both directions.
+   Entries are kept sorted by text (checked below); see enumText.h. */
+
+static constexpr EnumText<PREFIX> prefixTable[] = {
+    { "E", PREFIX::E },       // exa
+    { "G", PREFIX::G },       // giga
+    { "M", PREFIX::M },       // mega
+    { "P", PREFIX::P },       // peta
+    { "T", PREFIX::T },       // tera
+    { "Y", PREFIX::Y },       // yotta
+    { "Z", PREFIX::Z },       // zetta
+    { "a", PREFIX::a },       // atto
+    { "c", PREFIX::c },       // centi
+    { "d", PREFIX::d },       // deci
+    { "da", PREFIX::da },     // deka
+    { "f", PREFIX::f },       // femto
+    { "h", PREFIX::h },       // hecto
+    { "k", PREFIX::k },       // kilo
+    { "m", PREFIX::m },       // milli
+    { "n", PREFIX::n },       // nano
+    { "p", PREFIX::p },       // pico
+    { "u", PREFIX::u },       // micro
+    { "y", PREFIX::y },       // yocto
+    { "z", PREFIX::z },       // zepto
 };
+static_assert(isSortedByText(prefixTable) && hasUniqueValues(prefixTable));
+static constexpr auto prefixTypeToText = invertTable<enumSpan(prefixTable)>(prefixTable);
 
-std::unordered_map<std::string, UNIT> unitTextToType {
-    { "L", UNIT::LITER },
-    { "s", UNIT::SEC },
-    { "min", UNIT::MIN },
-    { "h", UNIT::HR },
-    { "g", UNIT::GRAM },
+static constexpr EnumText<UNIT> unitTable[] = {
+    { "A", UNIT::AMPERE },
     { "C", UNIT::CELSIUS },
     { "F", UNIT::FAHRENHEIT },
+    { "G", UNIT::GFORCE },
     { "K", UNIT::KELVIN },
-    { "V", UNIT::VOLT },
-    { "A", UNIT::AMPERE },
-    { "mol", UNIT::MOL },
+    { "L", UNIT::LITER },
     { "M", UNIT::MOLARITY },
-    { "m", UNIT::MOLALITY },
+    { "V", UNIT::VOLT },
     { "cd", UNIT::CANDELA },
+    { "g", UNIT::GRAM },
+    { "h", UNIT::HR },
+    { "m", UNIT::MOLALITY },
+    { "min", UNIT::MIN },
+    { "mol", UNIT::MOL },
     { "rpm", UNIT::RPM },
-    { "G", UNIT::GFORCE },
+    { "s", UNIT::SEC },
 };
+static_assert(isSortedByText(unitTable) && hasUniqueValues(unitTable));
+static constexpr auto unitTypeToText = invertTable<enumSpan(unitTable)>(unitTable);
 
-std::unordered_map<UNIT, std::string> unitTypeToText = reverseMap(unitTextToType);
-
-std::unordered_map<std::string, PARAM> paramTextToType {
-    { "ctr", PARAM::CONTAINR },
-    { "time", PARAM::TIME },
-    { "spd", PARAM::SPEED },
-    { "vol", PARAM::VOLUME },
-    { "temp", PARAM::TEMP },
-    { "form", PARAM::FORMULA },
-    { "voltage", PARAM::VOLTAGE },
+static constexpr EnumText<PARAM> paramTable[] = {
+    { "KM", PARAM::KM },
+    { "Ka", PARAM::Ka },
+    { "Ki", PARAM::Ki },
     { "config", PARAM::CONFIG },
+    { "ctr", PARAM::CONTAINR },
     { "eq", PARAM::EQUATION },
-    { "krev", PARAM::KREV },
-    { "kcat", PARAM::KCAT },
-    { "KM", PARAM::KM },
+    { "form", PARAM::FORMULA },
     { "k", PARAM::K },
-    { "Ki", PARAM::Ki },
+    { "kcat", PARAM::KCAT },
+    { "krev", PARAM::KREV },
     { "n", PARAM::n_param },
-    { "Ka", PARAM::Ka }
+    { "spd", PARAM::SPEED },
+    { "temp", PARAM::TEMP },
+    { "time", PARAM::TIME },
+    { "vol", PARAM::VOLUME },
+    { "voltage", PARAM::VOLTAGE },
 };
+static_assert(isSortedByText(paramTable) && hasUniqueValues(paramTable));
+static constexpr auto paramTypeToText = invertTable<enumSpan(paramTable)>(paramTable);
 
-std::unordered_map<PARAM, std::string> paramTypeToText = reverseMap(paramTextToType);
-
-std::unordered_map<std::string, SYMBOL> symbolTextToType {
-    { "+", SYMBOL::ADD },
-    { "-", SYMBOL::SUBTRACT },
-    { "/", SYMBOL::DIVIDE },
-    { "=", SYMBOL::ASSIGNMENT },
-    { "==", SYMBOL::EQUALS },
+static constexpr EnumText<SYMBOL> symbolTable[] = {
     { "!", SYMBOL::NOT },
     { "!=", SYMBOL::NOT_EQUALS },
-    { ",", SYMBOL::COMMA },
-    { ".", SYMBOL::DOT },
-    { ">", SYMBOL::GT },
-    { "<", SYMBOL::LT },
     { "\"", SYMBOL::QUOTE_DOUBLE },
-    { "\'", SYMBOL::QUOTE_SINGLE },
-    { "?", SYMBOL::QUESTION },
     { "%", SYMBOL::PERCENT },
-    { "^", SYMBOL::CARAT },
-    { "|", SYMBOL::BIT_OR },
     { "&", SYMBOL::BIT_AND },
-    { "||", SYMBOL::LOGI_OR },
     { "&&", SYMBOL::LOGI_AND },
-    { "_", SYMBOL::UNDERSCORE },
-    { ":", SYMBOL::COLON },
-    { ";", SYMBOL::SEMICOLON },
+    { "\'", SYMBOL::QUOTE_SINGLE },
     { "(", SYMBOL::PAREN_OPEN },
     { ")", SYMBOL::PAREN_CLOSED },
-    { "{", SYMBOL::CURLY_OPEN },
-    { "}", SYMBOL::CURLY_CLOSED },
-    { "[", SYMBOL::BRACKET_OPEN },
-    { "]", SYMBOL::BRACKET_CLOSED },
+    { "*", SYMBOL::MULTIPLY },
+    { "+", SYMBOL::ADD },
+    { ",", SYMBOL::COMMA },
+    { "-", SYMBOL::SUBTRACT },
     { "-->", SYMBOL::FORWARD },
+    { "--|", SYMBOL::INHIBITION },
+    { ".", SYMBOL::DOT },
+    { "..", SYMBOL::RANGE },
+    { "/", SYMBOL::DIVIDE },
+    { ":", SYMBOL::COLON },
+    { ";", SYMBOL::SEMICOLON },
+    { "<", SYMBOL::LT },
     { "<--", SYMBOL::BACKWARD },
     { "<->", SYMBOL::REVERSIBLE },
-    { "--|", SYMBOL::INHIBITION }
+    { "<=", SYMBOL::LEQ },
+    { "=", SYMBOL::ASSIGNMENT },
+    { "==", SYMBOL::EQUALS },
+    { ">", SYMBOL::GT },
+    { ">=", SYMBOL::GEQ },
+    { "?", SYMBOL::QUESTION },
+    { "[", SYMBOL::BRACKET_OPEN },
+    { "]", SYMBOL::BRACKET_CLOSED },
+    { "^", SYMBOL::CARAT },
+    { "_", SYMBOL::UNDERSCORE },
+    { "{", SYMBOL::CURLY_OPEN },
+    { "|", SYMBOL::BIT_OR },
+    { "||", SYMBOL::LOGI_OR },
+    { "}", SYMBOL::CURLY_CLOSED },
 };
+static_assert(isSortedByText(symbolTable) && hasUniqueValues(symbolTable));
+static constexpr auto symbolTypeToText = invertTable<enumSpan(symbolTable)>(symbolTable);
 
-std::unordered_map<SYMBOL, std::string> symbolTypeToText = reverseMap(symbolTextToType);
-
-std::unordered_map<std::string, IMPORT_TYPE> importTextToType {
+static constexpr EnumText<IMPORT_TYPE> importTable[] = {
     { "Centrifuge", IMPORT_TYPE::CENTRIFUGE },
-    { "Electrophoresis", IMPORT_TYPE::ELECTROPHORESIS }
+    { "Electrophoresis", IMPORT_TYPE::ELECTROPHORESIS },
 };
+static_assert(isSortedByText(importTable) && hasUniqueValues(importTable));
+static constexpr auto importTypeToText = invertTable<enumSpan(importTable)>(importTable);
 
-std::unordered_map<IMPORT_TYPE, std::string> importTypeToText = reverseMap(importTextToType);
-
-std::unordered_map<std::string, KEYWORD> keywordTextToType {
-    { "reagent", KEYWORD::REAGENT },
-    { "protocol", KEYWORD::PROTOCOL },
+static constexpr EnumText<KEYWORD> keywordTable[] = {
+    { "complex", KEYWORD::COMPLEX },
     { "container", KEYWORD::CONTAINER },
+    { "domain", KEYWORD::DOM },
     { "import", KEYWORD::IMPORT },
-    { "reaction", KEYWORD::REACTION },
-    { "protein", KEYWORD::PROTEIN },
-    { "complex", KEYWORD::COMPLEX},
-    { "pathway", KEYWORD::PATHWAY } ,
     { "membrane", KEYWORD::MEMBRANE },
-    { "domain", KEYWORD::DOM }, 
-    { "plasm", KEYWORD::PLASM }
+    { "pathway", KEYWORD::PATHWAY },
+    { "plasm", KEYWORD::PLASM },
+    { "protein", KEYWORD::PROTEIN },
+    { "protocol", KEYWORD::PROTOCOL },
+    { "reaction", KEYWORD::REACTION },
+    { "reagent", KEYWORD::REAGENT },
 };
+static_assert(isSortedByText(keywordTable) && hasUniqueValues(keywordTable));
+static constexpr auto keywordTypeToText = invertTable<enumSpan(keywordTable)>(keywordTable);
 
-std::unordered_map<KEYWORD, std::string> keywordTypeToText = reverseMap(keywordTextToType);
-
-std::unordered_map<std::string, PRIMITIVE_TYPE> primitiveTextToType {
-    { "int", PRIMITIVE_TYPE::PRIM_INT },
+static constexpr EnumText<PRIMITIVE_TYPE> primitiveTable[] = {
+    { "bool", PRIMITIVE_TYPE::PRIM_BOOL },
     { "double", PRIMITIVE_TYPE::PRIM_DOUBLE },
     { "float", PRIMITIVE_TYPE::PRIM_FLOAT },
-    { "bool", PRIMITIVE_TYPE::PRIM_BOOL },
-    { "string", PRIMITIVE_TYPE::PRIM_STRING }
+    { "int", PRIMITIVE_TYPE::PRIM_INT },
+    { "string", PRIMITIVE_TYPE::PRIM_STRING },
 };
+static_assert(isSortedByText(primitiveTable) && hasUniqueValues(primitiveTable));
+static constexpr auto primitiveTypeToText = invertTable<enumSpan(primitiveTable)>(primitiveTable);
+
+bool findPrefix(std::string_view text, PREFIX* type) {
+    return findText(prefixTable, text, type);
+}
+
+const char* prefixToText(PREFIX type) {
+    return textOf(prefixTypeToText, type);
+}
+
+bool findUnit(std::string_view text, UNIT* type) {
+    return findText(unitTable, text, type);
+}
+
+const char* unitToText(UNIT type) {
+    return textOf(unitTypeToText, type);
+}
+
+bool findParam(std::string_view text, PARAM* type) {
+    return findText(paramTable, text, type);
+}
+
+const char* paramToText(PARAM type) {
+    return textOf(paramTypeToText, type);
+}
+
+bool findSymbol(std::string_view text, SYMBOL* type) {
+    return findText(symbolTable, text, type);
+}
+
+const char* symbolToText(SYMBOL type) {
+    return textOf(symbolTypeToText, type);
+}
+
+bool findImport(std::string_view text, IMPORT_TYPE* type) {
+    return findText(importTable, text, type);
+}
+
+const char* importToText(IMPORT_TYPE type) {
+    return textOf(importTypeToText, type);
+}
 
-std::unordered_map<PRIMITIVE_TYPE, std::string> primitiveTypeToText = reverseMap(primitiveTextToType);
+bool findKeyword(std::string_view text, KEYWORD* type) {
+    return findText(keywordTable, text, type);
+}
 
-std::string prefixTexts[] = {"NONE", "Y", "Z", "E", "P", "T", "G", "M", "k", "h", "da",
+const char* keywordToText(KEYWORD type) {
+    return textOf(keywordTypeToText, type);
+}
+
+bool findPrimitive(std::string_view text, PRIMITIVE_TYPE* type) {
+    return findText(primitiveTable, text, type);
+}
+
+const char* primitiveToText(PRIMITIVE_TYPE type) {
+    return textOf(primitiveTypeToText, type);
+}
+
+static constexpr const char* prefixTexts[] = {"NONE", "Y", "Z", "E", "P", "T", "G", "M", "k", "h", "da",
                              "d", "c", "m", "u", "n", "p", "f", "a", "z", "y"};
-std::string unitTexts[] = {"NONE", "LITER", "SEC", "MIN", "HR", "GRAM", "CELSIUS",
+static constexpr const char* unitTexts[] = {"NONE", "LITER", "SEC", "MIN", "HR", "GRAM", "CELSIUS",
                            "FAHRENHEIT", "KELVIN", "VOLT", "AMPERE", "MOL", "MOLARITY",
                            "MOLALITY", "CANDELA", "RPM", "GFORCE"};
-std::string paramTexts[] = {"UNINITIALIZED", "CONTAINER", "TIME", "MASS", "SPEED", "VOLUME", "TEMP", "FORMULA",
-                            "VOLTAGE","CONFIG", "CHEM", "EQUATION", "KREV", "KCAT", "KM", "k",
+static constexpr const char* paramTexts[] = {"UNINITIALIZED", "CONTAINER", "TIME", "MASS", "SPEED", "VOLUME", "TEMP", "FORMULA",
+                            "VOLTAGE","CONFIG", "EQUATION", "MOLS", "KREV", "KCAT", "KM", "k",
                             "Ki", "n", "Ka"};
-std::string symbolTexts[] = {"UNINITIALIZED", "ADD", "SUBTRACT", "MULTIPLY", "DIVIDE", "ASSIGNMENT",
+static constexpr const char* symbolTexts[] = {"UNINITIALIZED", "ADD", "SUBTRACT", "MULTIPLY", "DIVIDE", "ASSIGNMENT",
                              "EQUALS", "NOT", "NOT_EQUALS", "COMMA", "DOT", "GEQ", "LEQ",
                              "GT", "LT", "QUOTE_DOUBLE", "QUOTE_SINGLE", "QUESTION", "PERCENT",
                              "CARAT", "BIT_OR", "BIT_AND", "LOGI_OR", "LOGI_AND", "UNDERSCORE",
                              "COLON", "SEMICOLON", "PAREN_OPEN", "PAREN_CLOSED", "CURLY_OPEN",
                              "CURLY_CLOSED", "BRACKET_OPEN", "BRACKET_CLOSED", "FORWARD", 
-                             "BACKWARD", "REVERSIBLE", "INHIBITION", "UNKNOWN"};
-std::string loopingTexts[] = {"UNINITIALIZED", "FOR", "WHILE", "DO"};
-std::string keywordTexts[] = {"UNINITIALIZED", "REAGENT", "PROTOCOL", "CONTAINER", "IMPORT", "REACTION", "PROTEIN",
+                             "BACKWARD", "REVERSIBLE", "INHIBITION", "RANGE", "UNKNOWN"};
+static constexpr const char* loopingTexts[] = {"UNINITIALIZED", "FOR", "WHILE", "DO"};
+static constexpr const char* keywordTexts[] = {"UNINITIALIZED", "REAGENT", "PROTOCOL", "CONTAINER", "IMPORT", "REACTION", "PROTEIN", "COMPLEX",
                               "PATHWAY", "MEMBRANE", "DOMAIN", "PLASM"};
-std::string keywordTypeTexts[] = {"UNINITIALIZED", "FUNCTION", "NON_FUNCTION"};
-std::string numberTexts[] = {"FLOAT", "INTEGER"};
-std::string importTexts[] = {"UNINITIALIZED", "CENTRIFUGE", "ELECTROPHORESIS"};
-std::string identifierTexts[] = {"UNINITIALIZED", "PRIMITIVE", "NON_FUNCTION", "FUNCTION"};
-std::string primitiveTexts[] = {"NON-PRIMITIVE", "INT", "DOUBLE", "FLOAT", "BOOL", "STRING"};
-std::string functionTexts[] = {"UNINITIALIZED", "INSTANCE", "STATIC", "CLASS"};
-std::string returnTexts[] = {"UNINITIALIZED", "VOID", "RETURN"};
+static constexpr const char* keywordTypeTexts[] = {"UNINITIALIZED", "FUNCTION", "NON_FUNCTION"};
+static constexpr const char* numberTexts[] = {"FLOAT", "INTEGER"};
+static constexpr const char* importTexts[] = {"UNINITIALIZED", "CENTRIFUGE", "ELECTROPHORESIS"};
+static constexpr const char* identifierTexts[] = {"UNINITIALIZED", "PRIMITIVE", "NON_FUNCTION", "FUNCTION"};
+static constexpr const char* primitiveTexts[] = {"NON-PRIMITIVE", "INT", "FLOAT", "DOUBLE", "BOOL", "STRING"};
+static constexpr const char* functionTexts[] = {"UNINITIALIZED", "INSTANCE", "STATIC", "CLASS"};
+static constexpr const char* returnTexts[] = {"UNINITIALIZED", "VOID", "RETURN"};
 
 /* Abstract Superclass ASTNode + helper methods */
 ASTNode::ASTNode() :
@@ -232,10 +263,9 @@ ASTNode::ASTNode(Tokenizer::Token* newToken) :
     nextStatement(NULL),
     nodeType(NODE::AST_NODE) {}
 
-ASTNode::~ASTNode() {
-    // std::cout << "Node destructed" << std::endl;
-    delete nextStatement;
-}
+/* Nodes are owned by the AstArena they were made in, so destructors never
+   delete children or the next statement. */
+ASTNode::~ASTNode() {}
 
 void ASTNode::printNode() {
     std::string type; 
@@ -313,289 +343,300 @@ void ASTNode::setNodeType(NODE newNodeType) {
     nodeType = newNodeType;
 }
 
-void ASTNode::assertNodeType(NODE expectedNodeType, std::string errorMessageOnFail, bool reversed) {
+void ASTNode::assertNodeType(NODE expectedNodeType, LazyMessage errorMessageOnFail, bool reversed) {
 #ifdef DEBUG
     if (!reversed) {
         if (nodeType != expectedNodeType) {
-            error(errorMessageOnFail);
+            error(errorMessageOnFail.str());
         }
     } else {
         if (nodeType == expectedNodeType) {
-            error(errorMessageOnFail);
+            error(errorMessageOnFail.str());
         }
     }
 #endif
 }
 
-void ASTNode::assertNodeType(std::unordered_set<NODE> expectedNodeTypes, std::string errorMessageOnFail, bool reversed) {
+void ASTNode::assertNodeType(std::initializer_list<NODE> expectedNodeTypes, LazyMessage errorMessageOnFail, bool reversed) {
 #ifdef DEBUG
+    bool found = std::find(expectedNodeTypes.begin(), expectedNodeTypes.end(), nodeType) != expectedNodeTypes.end();
     if (!reversed) {
-        if (expectedNodeTypes.count(nodeType) == 0) {
-            error(errorMessageOnFail);
+        if (!found) {
+            error(errorMessageOnFail.str());
         }
     } else {
-        if (expectedNodeTypes.count(nodeType) == 1) {
-            error(errorMessageOnFail);
+        if (found) {
+            error(errorMessageOnFail.str());
         }
     }
 #endif
 }
 
-void ASTNode::traverse(std::string tabs, std::string dashes) {
-    // // dfs recursive algorithm
-    visited = true;
-    std::cout << tabs;
-    printNode();
-    std::vector<ASTNode*> children = getChildren();
-    for (ASTNode* child : children) {
-        if (!child->visited) {
-            child->traverse(tabs + "\t", dashes + "-");
+void ASTNode::traverse() {
+    // iterative dfs, children are indented one tab per level
+    ASTWalker().walk(this, [](ASTNode* node, int depth, bool fromNextStatement) {
+        std::string tabs(depth, '\t');
+        if (fromNextStatement) {
+            std::cout << tabs << std::string(depth, '-') << "-" << "> ";
         }
-    }
-    if (hasNextStatement) {
-        std::cout << tabs << dashes << "-" << "> ";
-        getNextStatement()->traverse(tabs, dashes);
-    }
-}
-
-void ASTNode::resetVisited() {
-    if (this != nullptr) {
-        visited = false;
-        nextStatement->resetVisited();
-        for (ASTNode* child : getChildren()) {
-            child->resetVisited();
+        std::cout << tabs;
+        node->printNode();
+        return true;
+    });
+}
+
+/* Collects the direct children of a node. Binary-family nodes (symbol, keyword,
+   if, looping, index) fall through to visitBinary, and so on for unary and
+   ternary nodes; leaf nodes fall through to visitNode and have no children. */
+class ChildCollector : public ASTVisitor<ChildCollector, ChildSpan> {
+    public:
+        ChildSpan visitUnary(UnaryNode* unary) {
+            ChildSpan children;
+            children.push(unary->getChild());
+            return children;
         }
-    }
-}
-
-std::vector<ASTNode*> ASTNode::getChildren() {
-    NODE nodeType = getNodeType();
-    std::vector<ASTNode*> children;
-    if (this == nullptr) {
-        return children;
-    }
-    switch (nodeType) {
-        // ternary
-        case NODE::IF_ELSE_NODE: {
-            IfElseNode* loop = dynamic_cast<IfElseNode*>(this);
-            children.push_back(loop->getLeft());
-            children.push_back(loop->getCenter());
-            children.push_back(loop->getRight());
-            break;
-        }
-        // binary
-        case NODE::LOOPING_NODE: {
-            LoopingNode* loop = dynamic_cast<LoopingNode*>(this);
-            children.push_back(loop->getLeft());
-            children.push_back(loop->getRight());
-            break;
-        }
-        case NODE::SYMBOL_NODE: {
-            SymbolNode* symbol = dynamic_cast<SymbolNode*>(this);
-            children.push_back(symbol->getLeft());
-            children.push_back(symbol->getRight());
-            break;
-        }
-        case NODE::KEYWORD_NODE: {
-            KeywordNode* keyword = dynamic_cast<KeywordNode*>(this);
-            children.push_back(keyword->getLeft());
-            children.push_back(keyword->getRight());
-            break;
+        ChildSpan visitBinary(BinaryNode* binary) {
+            ChildSpan children;
+            children.push(binary->getLeft());
+            children.push(binary->getRight());
+            return children;
         }
-        case NODE::IF_NODE: {
-            IfNode* ifNode = dynamic_cast<IfNode*>(this);
-            children.push_back(ifNode->getLeft());
-            children.push_back(ifNode->getRight());
-            break;
+        ChildSpan visitTernary(TernaryNode* ternary) {
+            ChildSpan children;
+            children.push(ternary->getLeft());
+            children.push(ternary->getCenter());
+            children.push(ternary->getRight());
+            return children;
         }
-        case NODE::INDEX_NODE: {
-            IndexNode* indexNode = dynamic_cast<IndexNode*>(this);
-            children.push_back(indexNode->getLeft());
-            children.push_back(indexNode->getRight());
-            break;
+        ChildSpan visitSpeciesList(SpeciesListNode* list) {
+            return ChildSpan(list->getSpeciesList().data(), list->size());
         }
-        // unary
-        case NODE::RETURN_NODE: {
-            ReturnNode* ret = dynamic_cast<ReturnNode*>(this);
-            children.push_back(ret->getChild());
-            break;
-        }
-        case NODE::FUNCTION_NODE: {
-            FunctionNode* function = dynamic_cast<FunctionNode*>(this);
-            // push child (linked list of parameters (symbol nodes))
+        ChildSpan visitFunction(FunctionNode* function) {
+            // children are the linked list of parameters (symbol nodes)
+            ChildSpan children;
             if (function->hasParams()) {
-                SymbolNode* params = dynamic_cast<SymbolNode*>(function->getChild());
-                children.push_back(params->getLeft());
-                children.push_back(params->getRight());
+                SymbolNode* params = static_cast<SymbolNode*>(function->getChild());
+                children.push(params->getLeft());
+                children.push(params->getRight());
             }
-            break;
-        }
-        // no children
-        case NODE::NUMBER_NODE:
-            break;
-        case NODE::IDENTIFIER_NODE:
-            break;
-        case NODE::CHEMICAL_NODE:
-            break;
-        case NODE::IMPORT_NODE:
-            break;
-        case NODE::PARAM_NODE:
-            break;
-        case NODE::UNARY_NODE: {
-            UnaryNode* unary = dynamic_cast<UnaryNode*>(this);
-            children.push_back(unary->getChild());
-            break;
-        }
-        case NODE::BINARY_NODE: {
-            BinaryNode* binary = dynamic_cast<BinaryNode*>(this);
-            children.push_back(binary->getLeft());
-            children.push_back(binary->getRight());
-            break;
+            return children;
         }
-        case NODE::TERNARY_NODE: {
-            TernaryNode* ternary = dynamic_cast<TernaryNode*>(this);
-            children.push_back(ternary->getLeft());
-            children.push_back(ternary->getCenter());
-            children.push_back(ternary->getRight());
-            break;
-        }
-        default:
-            // an AST Node, no children to push
-            break;
+};
+
+ChildSpan ASTNode::getChildren() {
+    if (this == nullptr) {
+        return ChildSpan();
     }
-    return children;
+    return ChildCollector().visit(this);
 }
 
-NumberNode* ASTNode::evaluate(Scope* curScope) {
-    std::cout << "in evaluate!!";
-    
-    if (nodeType == NODE::SYMBOL_NODE) {
-        std::cout << "checking symbol node";
-        SymbolNode* symbol = dynamic_cast<SymbolNode*>(this);
-        NumberNode* left = symbol->getLeft()->evaluate(curScope);
-        // left->printNode();
-        
-        NumberNode* right = symbol->getRight()->evaluate(curScope);
-        // right->printNode();
-        std::cout << "about to compare prefixes + units";
-        
-        bool samePrefixUnit = left->comparePrefixUnit(right);
-        std::cout << "compared prefixes + units";
-
-        NumberNode* res = new NumberNode();
-        float resValue = 0.0;
-
-        switch(symbol->getSymbol()) {
+static bool hasUnit(const Quantity& quantity) {
+    return quantity.unit != UNIT::NO_UNIT;
+}
+
+static double canonical(const Quantity& quantity) {
+    return toCanonical(quantity.num, quantity.prefix, quantity.unit);
+}
+
+static std::string unitName(const Quantity& quantity) {
+    return std::string(prefixToText(quantity.prefix)) + unitToText(quantity.unit);
+}
+
+[[noreturn]] static void unitError(const std::string& message, SymbolNode* symbol) {
+    error(message + " on line " + std::to_string(symbol->getLine()) + ".\n");
+}
+
+/* Brings right to the prefix + unit of left (or left to right's if only right
+   has a unit) so the two numbers can be added or compared. */
+static void matchUnits(Quantity& left, Quantity& right, SymbolNode* symbol) {
+    if (!hasUnit(right)) {
+        right.prefix = left.prefix;
+        right.unit = left.unit;
+    } else if (!hasUnit(left)) {
+        left.prefix = right.prefix;
+        left.unit = right.unit;
+    } else if (dimensionOf(left.unit) != dimensionOf(right.unit)) {
+        unitError("Cannot apply " + symbol->getText() + " to " + unitName(left) + " and " + unitName(right), symbol);
+    } else {
+        right.num = fromCanonical(canonical(right), left.prefix, left.unit);
+        right.prefix = left.prefix;
+        right.unit = left.unit;
+    }
+}
+
+/* Expresses a canonical value in the first unit that has its dimension. */
+static Quantity withDimension(double value, Dimension dimension, SymbolNode* symbol) {
+    Quantity res;
+    if (!findUnitOf(dimension, &res.unit)) {
+        unitError("No unit has the dimension of the result of " + symbol->getText(), symbol);
+    }
+    res.num = fromCanonical(value, PREFIX::NO_PREFIX, res.unit);
+    return res;
+}
+
+Quantity ASTNode::evaluate(Scope* curScope) {
+    if (SymbolNode* symbol = nodeCast<SymbolNode>(this)) {
+        Quantity left = symbol->getLeft()->evaluate(curScope);
+        Quantity right = symbol->getRight()->evaluate(curScope);
+        Quantity res;
+
+        switch (symbol->getSymbol()) {
             case SYMBOL::ADD: {
-                resValue = left->getNum() + right->getNum();
+                matchUnits(left, right, symbol);
+                res = left;
+                res.num = left.num + right.num;
                 break;
             }
             case SYMBOL::SUBTRACT: {
-                resValue = left->getNum() - right->getNum();
+                matchUnits(left, right, symbol);
+                res = left;
+                res.num = left.num - right.num;
                 break;
             }
             case SYMBOL::MULTIPLY: {
-                resValue = left->getNum() * right->getNum();
+                if (hasUnit(left) && hasUnit(right)) {
+                    res = withDimension(canonical(left) * canonical(right),
+                                        dimensionOf(left.unit) * dimensionOf(right.unit), symbol);
+                } else {
+                    res = hasUnit(left) ? left : right;
+                    res.num = left.num * right.num;
+                }
                 break;
             }
             case SYMBOL::DIVIDE: {
-                resValue = left->getNum() / right->getNum();
+                if (hasUnit(right)) {
+                    res = withDimension(canonical(left) / canonical(right),
+                                        dimensionOf(left.unit) / dimensionOf(right.unit), symbol);
+                } else {
+                    res = left;
+                    res.num = left.num / right.num;
+                }
                 break;
             }
-            case SYMBOL::CARAT: {
-                resValue = std::pow(left->getNum(), right->getNum());
+            case SYMBOL::PERCENT: {
+                matchUnits(left, right, symbol);
+                res = left;
+                res.num = std::fmod(left.num, right.num);
                 break;
             }
-            case SYMBOL::PERCENT: {
-                resValue = (int) left->getNum() % (int) right->getNum();
+            case SYMBOL::CARAT: {
+                if (hasUnit(right)) {
+                    unitError("Exponent " + unitName(right) + " must be a plain number", symbol);
+                }
+                if (!hasUnit(left)) {
+                    res.num = std::pow(left.num, right.num);
+                } else if (std::floor(right.num) == right.num) {
+                    int exponent = static_cast<int>(right.num);
+                    res = withDimension(std::pow(canonical(left), exponent), dimensionOf(left.unit).pow(exponent), symbol);
+                } else {
+                    unitError("Cannot raise " + unitName(left) + " to a fractional power", symbol);
+                }
+                break;
             }
             case SYMBOL::LOGI_OR: {
-                resValue = left->getNum() || right->getNum();
+                res.num = left.num || right.num;
                 break;
             }
             case SYMBOL::LOGI_AND: {
-                resValue = left->getNum() && right->getNum();
+                res.num = left.num && right.num;
                 break;
             }
             case SYMBOL::EQUALS: {
-                resValue = left->getNum() == right->getNum();
+                matchUnits(left, right, symbol);
+                res.num = left.num == right.num;
                 break;
             }
             case SYMBOL::NOT_EQUALS: {
-                resValue = left->getNum() != right->getNum();
+                matchUnits(left, right, symbol);
+                res.num = left.num != right.num;
                 break;
             }
             case SYMBOL::GEQ: {
-                resValue = left->getNum() >= right->getNum();
+                matchUnits(left, right, symbol);
+                res.num = left.num >= right.num;
                 break;
             }
             case SYMBOL::GT: {
-                resValue = left->getNum() > right->getNum();
+                matchUnits(left, right, symbol);
+                res.num = left.num > right.num;
                 break;
             }
             case SYMBOL::LEQ: {
-                resValue = left->getNum() <= right->getNum();
+                matchUnits(left, right, symbol);
+                res.num = left.num <= right.num;
                 break;
             }
             case SYMBOL::LT: {
-                resValue = left->getNum() < right->getNum();
+                matchUnits(left, right, symbol);
+                res.num = left.num < right.num;
                 break;
             }
             default: {
-                std::string failMsg = "Evaluation operation cannot be performed with symbol " + symbol->getText();
-                fprintf(stderr, failMsg.c_str());
-                exit(1);
+                error("Evaluation operation cannot be performed with symbol " + symbol->getText());
             }
         }
-            res->setNum(resValue);
-            res->setNumType(NUMBER::FLOAT);
-            
-            if (samePrefixUnit) {
-                res->setPrefix(left->getPrefix());
-                res->setUnit(left->getUnit());
-            }
-            else {
-                // infer prefix if only unit for 1 number is passed in.
-                if (left->getPrefix() == PREFIX::NO_PREFIX) {
-                    res->setPrefix(right->getPrefix());
-                } else {
-                    res->setPrefix(left->getPrefix());
-                }
-                // infer unit if only unit for 1 number is passed in.
-                if (left->getUnit() == UNIT::NO_UNIT) {
-                    res->setUnit(right->getUnit());
-                } else {
-                    res->setUnit(left->getUnit());
-                }
-            }
 
-            return res;
-        
+        bool integral = std::isfinite(res.num) && std::floor(res.num) == res.num;
+        res.numType = left.numType == NUMBER::INTEGER && right.numType == NUMBER::INTEGER && integral ?
+                      NUMBER::INTEGER : NUMBER::FLOAT;
+        return res;
     }
-    else if (nodeType == NODE::NUMBER_NODE) {
-        NumberNode* result = dynamic_cast<NumberNode*>(this);
-        return result;
+    else if (NumberNode* number = nodeCast<NumberNode>(this)) {
+        return number->getQuantity();
     }
-    else if (nodeType == NODE::IDENTIFIER_NODE) {
-        IdentifierNode* identifier = dynamic_cast<IdentifierNode*>(this);        
-        // to-do: look up on symbol table
-        if (curScope->hasSymbol(identifier->getName())){
-            std::variant<double, std::string> answer = curScope->getSymbolValue(identifier->getName());
-            if (answer.index() == 0) {
-                NumberNode* result = new NumberNode();
-                result->setNum(std::get<double>(answer));
-                return result;
-            } else {
-                fprintf(stderr, "Found identifier in symboltable but the value is not a number.\n");
-                exit(1);
+    else if (IdentifierNode* identifier = nodeCast<IdentifierNode>(this)) {
+        // innermost declaration wins; enclosing scopes are searched outwards.
+        // The binding is kept so that evaluating the node again skips the lookup.
+        ResolvedSlot binding = identifier->getResolved();
+        if (binding.kind != RESOLVED::VARIABLE) {
+            binding.scope = curScope != NULL ? curScope->resolve(identifier->getName(), &binding.index) : NULL;
+            if (binding.scope != NULL) {
+                binding.kind = RESOLVED::VARIABLE;
+                identifier->setResolved(binding);
             }
-        } else {
-            std::string failMsg = "Identifier " + identifier->getName() + " is not declared.\n";
-            fprintf(stderr, failMsg.c_str());
-            exit(1);
         }
-
+        if (binding.scope == NULL) {
+            error("Identifier " + identifier->getName() + " is not declared.\n");
+        }
+        const SymbolValue& answer = binding.scope->getSymbolValue(binding.index);
+        if (answer.index() != 0) {
+            error("Found identifier in symboltable but the value is not a number.\n");
+        }
+        Quantity result;
+        result.num = std::get<double>(answer);
+        return result;
+    }
+    error("Cannot evaluate " + getText() + " as a number.\n");
+}
+
+bool ASTNode::isConstant() {
+    if (SymbolNode* symbol = nodeCast<SymbolNode>(this)) {
+        switch (symbol->getSymbol()) {
+            case SYMBOL::ADD:
+            case SYMBOL::SUBTRACT:
+            case SYMBOL::MULTIPLY:
+            case SYMBOL::DIVIDE:
+            case SYMBOL::PERCENT:
+            case SYMBOL::CARAT:
+            case SYMBOL::LOGI_OR:
+            case SYMBOL::LOGI_AND:
+            case SYMBOL::EQUALS:
+            case SYMBOL::NOT_EQUALS:
+            case SYMBOL::GEQ:
+            case SYMBOL::GT:
+            case SYMBOL::LEQ:
+            case SYMBOL::LT:
+                return symbol->getLeft() != nullptr && symbol->getLeft()->isConstant() &&
+                       symbol->getRight() != nullptr && symbol->getRight()->isConstant();
+            default:
+                return false;
+        }
     }
+    if (IdentifierNode* identifier = nodeCast<IdentifierNode>(this)) {
+        ResolvedSlot binding = identifier->getResolved();
+        return binding.kind == RESOLVED::VARIABLE && binding.scope->getSymbolValue(binding.index).index() == 0;
+    }
+    return nodeType == NODE::NUMBER_NODE;
 }
 
 /* Unary node constructors + helper methods */
@@ -614,10 +655,7 @@ UnaryNode::UnaryNode(Tokenizer::Token* newToken) :
 	   child = nullptr;
         setNodeType(NODE::UNARY_NODE);
 }
-UnaryNode::~UnaryNode() {
-    // std::cout << "Unary Node destructed" << std::endl;
-    delete child;
-}
+UnaryNode::~UnaryNode() {}
 
 ASTNode* UnaryNode::getChild() {
     return child;
@@ -653,11 +691,7 @@ BinaryNode::BinaryNode(Tokenizer::Token* newToken,
     setNodeType(NODE::BINARY_NODE);
 }
 
-BinaryNode::~BinaryNode() {
-    // std::cout << "Binary Node destructed" << std::endl;
-    delete left;
-    delete right;
-}
+BinaryNode::~BinaryNode() {}
 
 ASTNode* BinaryNode::getLeft() {
     return left;
@@ -696,12 +730,7 @@ TernaryNode::TernaryNode(Tokenizer::Token* newToken,
         right = newRight;
         setNodeType(NODE::TERNARY_NODE);
 }
-TernaryNode::~TernaryNode() {
-    // std::cout << "Ternary Node destructed" << std::endl;
-    delete left;
-    delete center;
-    delete right;
-}
+TernaryNode::~TernaryNode() {}
 
 ASTNode* TernaryNode::getLeft() {
     return left;
@@ -753,20 +782,14 @@ NumberNode::NumberNode(Tokenizer::Token* newToken) :
     unit = UNIT::NO_UNIT;
 }
 
-NumberNode::~NumberNode() {
-    std::cout << "Number Node destructed" << std::endl;
-}
+NumberNode::~NumberNode() {}
 
 double NumberNode::getNum() {
     return num;
 }
 
 double NumberNode::getSIValue() { 
-    // TODO: account for conversions to SI
-    if (unit != UNIT::MOL && unit != UNIT::NO_UNIT && unit != UNIT::MOLARITY) {
-        error("getSIValue() not yet implemented for non-mol units.");
-    }
-    return num * prefixToNumber[prefix];
+    return toCanonical(num, prefix, unit);
 }
 
 NUMBER NumberNode::getNumType() {
@@ -781,7 +804,11 @@ UNIT NumberNode::getUnit() {
     return unit;
 }
 
-void NumberNode::setNum(float newNum) {
+Quantity NumberNode::getQuantity() {
+    return { num, numType, prefix, unit };
+}
+
+void NumberNode::setNum(double newNum) {
     num = newNum;
 }
 
@@ -797,10 +824,11 @@ void NumberNode::setUnit(UNIT newUnit) {
     unit = newUnit;
 }
 
-bool NumberNode::comparePrefixUnit(NumberNode* other) {
-    std::cout << "inside comparing prefix unit";
-    return convertEnum(prefix) == convertEnum(other->prefix) &&
-           convertEnum(unit) == convertEnum(other->unit);
+void NumberNode::setQuantity(const Quantity& quantity) {
+    num = quantity.num;
+    numType = quantity.numType;
+    prefix = quantity.prefix;
+    unit = quantity.unit;
 }
 
 void NumberNode::printNode() {
@@ -821,9 +849,7 @@ SymbolNode::SymbolNode(Tokenizer::Token* newToken) :
         setNodeType(NODE::SYMBOL_NODE);
         symbol = SYMBOL::UNINITIALIZED;
     }
-SymbolNode::~SymbolNode() {
-    std::cout << "Symbol Node with symbol " << symbolTypeToText[symbol] << " destructed" << std::endl;
-}
+SymbolNode::~SymbolNode() {}
 
 SYMBOL SymbolNode::getSymbol() {
     return symbol;
@@ -831,18 +857,18 @@ SYMBOL SymbolNode::getSymbol() {
 
 void SymbolNode::setSymbol(SYMBOL newSymbol) {
     symbol = newSymbol;
-    this->setText(symbolTypeToText[newSymbol]);
+    this->setText(symbolToText(newSymbol));
 }
 
-void SymbolNode::assertSymbol(SYMBOL expectedSymbol, std::string errorMessageOnFail, bool reversed) {
+void SymbolNode::assertSymbol(SYMBOL expectedSymbol, LazyMessage errorMessageOnFail, bool reversed) {
 #ifdef DEBUG
     if (!reversed) {
         if (symbol != expectedSymbol) {
-            error(errorMessageOnFail);
+            error(errorMessageOnFail.str());
         }
     } else {
         if (symbol == expectedSymbol) {
-            error(errorMessageOnFail);
+            error(errorMessageOnFail.str());
         }
     }
 #endif
@@ -863,9 +889,7 @@ LoopingNode::LoopingNode(Tokenizer::Token* newToken,
         setNodeType(NODE::LOOPING_NODE);
         loopType = newLoopType;
     }
-LoopingNode::~LoopingNode() {
-    std::cout << "Looping Node destructed" << std::endl;
-}
+LoopingNode::~LoopingNode() {}
 
 LOOPING LoopingNode::getLoopType() {
     return loopType;
@@ -889,9 +913,7 @@ IfNode::IfNode(Tokenizer::Token* newToken,
                BinaryNode(newToken, newLeft, newRight) {
         setNodeType(NODE::IF_NODE);
     }
-IfNode::~IfNode() {
-    std::cout << "If Node destructed" << std::endl;
-}
+IfNode::~IfNode() {}
 void IfNode::printNode() {
     std::cout << "IfNode" << getPos() << ": " << std::endl;
 };
@@ -908,9 +930,7 @@ IfElseNode::IfElseNode(Tokenizer::Token* newToken,
     }
     
 
-IfElseNode::~IfElseNode() {
-    std::cout << "If-Else Node destructed" << std::endl;
-}
+IfElseNode::~IfElseNode() {}
 void IfElseNode::printNode() {
     std::cout << "IfElseNode" << getPos() << ": " << std::endl;
 };
@@ -963,6 +983,14 @@ void IdentifierNode::setPrimitiveType(PRIMITIVE_TYPE newPrimitiveType) {
     primitiveType = newPrimitiveType;
 }
 
+const ResolvedSlot& IdentifierNode::getResolved() {
+    return resolved;
+}
+
+void IdentifierNode::setResolved(ResolvedSlot newResolved) {
+    resolved = newResolved;
+}
+
 void IdentifierNode::printNode() {
     std::cout << "IdentifierNode" << getPos() << ": ";
     std::cout << name << " (name), ";
@@ -1060,6 +1088,14 @@ void ChemicalNode::setFormula(std::string newFormula) {
     formula = newFormula;
 }
 
+const ResolvedSlot& ChemicalNode::getResolved() {
+    return resolved;
+}
+
+void ChemicalNode::setResolved(ResolvedSlot newResolved) {
+    resolved = newResolved;
+}
+
 void ChemicalNode::printNode() {
     std::cout << "ChemicalNode" << getPos() << ": ";
     std::cout << formula << std::endl;
@@ -1076,9 +1112,7 @@ ReturnNode::ReturnNode(Tokenizer::Token* newToken) :
     UnaryNode(newToken) {
         setNodeType(NODE::RETURN_NODE);
     }
-ReturnNode::~ReturnNode() {
-    std::cout << "Return Node destructed" << std::endl;
-}
+ReturnNode::~ReturnNode() {}
 
 void ReturnNode::printNode() {
     std::cout << "ReturnNode" << getPos() << ": " << std::endl << "\t";
@@ -1112,9 +1146,7 @@ KeywordNode::KeywordNode(Tokenizer::Token* newToken,
                 allowStatements = false;
         }
     }
-KeywordNode::~KeywordNode() {
-    std::cout << "Keyword Node destructed" << std::endl;
-}
+KeywordNode::~KeywordNode() {}
 
 KEYWORD KeywordNode::getKeyword() {
     return keyword;
@@ -1132,15 +1164,15 @@ void KeywordNode::setAllowStatements(bool permission) {
     allowStatements = permission;
 }
 
-void KeywordNode::assertKeyword(KEYWORD expectedKeyword, std::string errorMessageOnFail, bool reversed) {
+void KeywordNode::assertKeyword(KEYWORD expectedKeyword, LazyMessage errorMessageOnFail, bool reversed) {
 #ifdef DEBUG
     if (!reversed) {
         if (keyword != expectedKeyword) {
-            error(errorMessageOnFail);
+            error(errorMessageOnFail.str());
         }
     } else {
         if (keyword == expectedKeyword) {
-            error(errorMessageOnFail);
+            error(errorMessageOnFail.str());
         }
     }
 #endif
@@ -1162,9 +1194,7 @@ ImportNode::ImportNode(Tokenizer::Token* newToken, IMPORT_TYPE newImport) :
         setNodeType(NODE::IMPORT_NODE);
         import = newImport;
     }
-ImportNode::~ImportNode() {
-    std::cout << "Import Node destructed" << std::endl;
-}
+ImportNode::~ImportNode() {}
 IMPORT_TYPE ImportNode::getImport() {
     return import;
 }
@@ -1201,14 +1231,12 @@ ParamNode::ParamNode(Tokenizer::Token* newToken, PARAM newParamType) :
         setNodeType(NODE::PARAM_NODE);
 }
 
-ParamNode::~ParamNode() {
-    std::cout << "Param Node destructed" << std::endl;
-}
+ParamNode::~ParamNode() {}
 
 
 void ParamNode::setParamType(PARAM newParamType) {
     paramType = newParamType;
-    this->setText(paramTypeToText[newParamType]);
+    this->setText(paramToText(newParamType));
 }
 
 PARAM ParamNode::getParamType() {
@@ -1232,13 +1260,51 @@ IndexNode::IndexNode(Tokenizer::Token* newToken,
                      BinaryNode(newToken, newLeft, newRight) {
         setNodeType(NODE::INDEX_NODE);
     }
-IndexNode::~IndexNode() {
-    std::cout << "Index Node destructed" << std::endl;
-}
+IndexNode::~IndexNode() {}
 void IndexNode::printNode() {
     std::cout << "IndexNode" << getPos() << ": " << std::endl;
 }
 
+SpeciesListNode::SpeciesListNode() {
+    setNodeType(NODE::SPECIES_LIST_NODE);
+}
+SpeciesListNode::SpeciesListNode(Tokenizer::Token* newToken) : ASTNode(newToken) {
+    setNodeType(NODE::SPECIES_LIST_NODE);
+}
+SpeciesListNode::~SpeciesListNode() {}
+void SpeciesListNode::printNode() {
+    std::cout << "SpeciesListNode" << getPos() << ": " << species.size() << " species (";
+    for (size_t i = 0; i < coefficients.size(); i++) {
+        std::cout << (i ? ", " : "") << coefficients[i];
+    }
+    std::cout << " coefficients)" << std::endl;
+}
+
+void SpeciesListNode::addSpecies(ASTNode* newSpecies, int coefficient) {
+    species.push_back(newSpecies);
+    coefficients.push_back(coefficient);
+}
+
+size_t SpeciesListNode::size() {
+    return species.size();
+}
+
+ASTNode* SpeciesListNode::getSpecies(size_t i) {
+    return species[i];
+}
+
+void SpeciesListNode::setSpecies(size_t i, ASTNode* newSpecies) {
+    species[i] = newSpecies;
+}
+
+int SpeciesListNode::getCoefficient(size_t i) {
+    return coefficients[i];
+}
+
+const std::vector<ASTNode*>& SpeciesListNode::getSpeciesList() {
+    return species;
+}
+
 template<typename Type>
 static int convertEnum(Type t) {
     return static_cast<int>(t);
@@ -1246,10 +1312,8 @@ static int convertEnum(Type t) {
 
 
 void ASTNode::singlePrintNodeChildren() {
-    std::vector<ASTNode*> children;
     this->printNode();
-    children = this->getChildren();
-    for (ASTNode* child : children) {
+    for (ASTNode* child : getChildren()) {
         std::cout << "\t";
         child->printNode();
     }
@@ -2,17 +2,22 @@
 
 #include "tokenizer.h"
 #include "scope.h"
+#include "error.h"
 
 #include <map>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 #include <stack>
 #include <optional>
+#include <string_view>
 #include <cmath>
 #include <iomanip>
 
 
+class ASTNode;
 class NumberNode;
+class AstArena;
 
 enum class PREFIX {
    NO_PREFIX,    // no prefix
@@ -136,6 +141,7 @@ enum class SYMBOL {
     BACKWARD,           // <-
     REVERSIBLE,         // <->
     INHIBITION,         // --|
+    RANGE,              // .. (species arrays, ie. R[0..999])
     UNKNOWN
 };
 
@@ -223,33 +229,63 @@ enum class NODE {
     CHEMICAL_NODE,
     KEYWORD_NODE,
     IMPORT_NODE,
-    INDEX_NODE
+    INDEX_NODE,
+    SPECIES_LIST_NODE
 };
 
-extern std::unordered_map<std::string, PREFIX> prefixTextToType;
-extern std::unordered_map<PREFIX, float> prefixToNumber;
-extern std::unordered_map<std::string, UNIT> unitTextToType;
-extern std::unordered_set<std::string> noPrefixUnits;
-extern std::unordered_map<std::string, PARAM> paramTextToType;
-extern std::unordered_map<std::string, SYMBOL> symbolTextToType;
-extern std::unordered_map<std::string, IMPORT_TYPE> importTextToType;
-extern std::unordered_map<std::string, KEYWORD> keywordTextToType;
-extern std::unordered_map<std::string, PRIMITIVE_TYPE> primitiveTextToType;
+// Text -> type; false if text is not a valid spelling
+bool findPrefix(std::string_view text, PREFIX* type);
+bool findUnit(std::string_view text, UNIT* type);
+bool findParam(std::string_view text, PARAM* type);
+bool findSymbol(std::string_view text, SYMBOL* type);
+bool findImport(std::string_view text, IMPORT_TYPE* type);
+bool findKeyword(std::string_view text, KEYWORD* type);
+bool findPrimitive(std::string_view text, PRIMITIVE_TYPE* type);
+
+// Type -> text; "" if the type has no L++ spelling
+const char* prefixToText(PREFIX type);
+const char* unitToText(UNIT type);
+const char* paramToText(PARAM type);
+const char* symbolToText(SYMBOL type);
+const char* importToText(IMPORT_TYPE type);
+const char* keywordToText(KEYWORD type);
+const char* primitiveToText(PRIMITIVE_TYPE type);
+
+enum class RESOLVED {
+    UNRESOLVED,
+    VARIABLE,       // index is a symbol slot of scope
+    NAME            // index is a molecule / reaction name ID given out by a NameResolver
+};
 
-extern std::unordered_map<PREFIX, std::string> prefixTypeToText;
-extern std::unordered_map<UNIT, std::string> unitTypeToText;
-extern std::unordered_map<PARAM, std::string> paramTypeToText;
-extern std::unordered_map<SYMBOL, std::string> symbolTypeToText;
-extern std::unordered_map<IMPORT_TYPE, std::string> importTypeToText;
-extern std::unordered_map<KEYWORD, std::string> keywordTypeToText;
-extern std::unordered_map<PRIMITIVE_TYPE, std::string> primitiveTypeToText;
+/*  What an identifier or chemical refers to, filled in by name resolution so
+    that later phases index a table instead of hashing the name again.
+    VARIABLE bindings are made by the parser and are only meaningful until the
+    statement has been constant folded; NAME bindings are made before context
+    building. */
+struct ResolvedSlot {
+    RESOLVED kind = RESOLVED::UNRESOLVED;
+    int index = -1;
+    Scope* scope = nullptr;
+};
+
+/*  Value of a constant expression. Prefix and unit travel with the number:
+    an operand without a unit takes on the other operand's prefix and unit,
+    operands of the same dimension are converted to the left operand's prefix
+    and unit, and products and quotients are given in a unit of the resulting
+    dimension (see units.h). */
+struct Quantity {
+    double num = 0;
+    NUMBER numType = NUMBER::FLOAT;
+    PREFIX prefix = PREFIX::NO_PREFIX;
+    UNIT unit = UNIT::NO_UNIT;
+};
 
 
 /*  Abstract Syntax Tree Node Hierarchy:
     --------------------------------------
     Parent Class: AST Node
     Child Classes: UnaryNode, BinaryNode, TernaryNode, NumberNode,
-                   IdentifierNode, ImportNode
+                   IdentifierNode, ImportNode, SpeciesListNode
     Grandchild Classes: ReturnNode, KeywordNode, SymbolNode, LoopingNode
 
                          ASTNode
@@ -264,6 +300,30 @@ extern std::unordered_map<PRIMITIVE_TYPE, std::string> primitiveTypeToText;
     child node classes due not contain any children. 
 */
 
+/*  View over a node's children. Unary, binary and ternary nodes have at most
+    three, which are held inline (null children are skipped when the span is
+    built), so iterating them never touches the heap. Nodes with any number
+    of children (SpeciesListNode) hand out a view of their own storage. */
+class ChildSpan {
+    public:
+        ChildSpan() : external(nullptr), count(0) {}
+        ChildSpan(ASTNode* const* newExternal, size_t newCount) : external(newExternal), count(newCount) {}
+        void push(ASTNode* child) {
+            if (child != nullptr) {
+                children[count++] = child;
+            }
+        }
+        ASTNode* const* begin() const { return external ? external : children; }
+        ASTNode* const* end() const { return begin() + count; }
+        ASTNode* operator[](size_t i) const { return begin()[i]; }
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+    private:
+        ASTNode* children[3];
+        ASTNode* const* external;     // nullptr: children are inline
+        size_t count;
+};
+
 class ASTNode {
     public:
         ASTNode();
@@ -287,14 +347,17 @@ class ASTNode {
         void setNextStatement(ASTNode* newNextStatement);
         NODE getNodeType();
         void setNodeType(NODE newNodeType);
-        void assertNodeType(NODE expectedNodeType, std::string errorMessageOnFail, bool reversed = false);
-        void assertNodeType(std::unordered_set<NODE> expectedNodeTypes, std::string errorMessageOnFail, bool reversed = false);
-        void traverse(std::string tabs, std::string dashes);
-        void resetVisited();
-        std::vector<ASTNode*> getChildren();
-        NumberNode* evaluate(Scope* curScope);
+        // errorMessageOnFail is only built if the assertion fails
+        void assertNodeType(NODE expectedNodeType, LazyMessage errorMessageOnFail, bool reversed = false);
+        void assertNodeType(std::initializer_list<NODE> expectedNodeTypes, LazyMessage errorMessageOnFail, bool reversed = false);
+        void traverse();
+        ChildSpan getChildren();
+        // evaluates an expression without allocating; unbound identifiers are looked up from curScope
+        Quantity evaluate(Scope* curScope);
+        // true if evaluate() needs no scope: numbers, bound numeric variables and operators on them
+        bool isConstant();
         bool hasNextStatement = false;
-        bool visited = false;
+        uint32_t visitEpoch = 0;    // epoch of the last ASTWalker walk that reached this node
         void singlePrintNodeChildren();
 
     private:
@@ -362,16 +425,16 @@ class NumberNode : public ASTNode {
         ~NumberNode();
         void printNode() override;
         double getNum();
-        double getSIValue();  // getSIValue = value * prefix * conversion to SI units
+        double getSIValue();  // value in canonical units, see units.h
         NUMBER getNumType();
         PREFIX getPrefix();
         UNIT getUnit();
-        void setNum(float newNum);
+        Quantity getQuantity();
+        void setNum(double newNum);
         void setNumType(NUMBER newNumType);
         void setPrefix(PREFIX newPrefix);
         void setUnit(UNIT newUnit);
-
-        bool comparePrefixUnit(NumberNode* other);
+        void setQuantity(const Quantity& quantity);
     private:
         double num;  // turn both ints + floats into floats for now
         NUMBER numType;     // can indicate if int/float, cast at runtime
@@ -387,7 +450,7 @@ class SymbolNode : public BinaryNode {
         void printNode() override;
         SYMBOL getSymbol();
         void setSymbol(SYMBOL newSymbol);
-        void assertSymbol(SYMBOL expectedSymbol, std::string errorMessageOnFail, bool reversed = false);
+        void assertSymbol(SYMBOL expectedSymbol, LazyMessage errorMessageOnFail, bool reversed = false);
     private:
         SYMBOL symbol;
 };
@@ -437,10 +500,13 @@ class IdentifierNode : public ASTNode {
         void setType(IDENTIFIER_TYPE newType);
         PRIMITIVE_TYPE getPrimitiveType();
         void setPrimitiveType(PRIMITIVE_TYPE newPrimitiveType);
+        const ResolvedSlot& getResolved();
+        void setResolved(ResolvedSlot newResolved);
     private:
         std::string name;
         IDENTIFIER_TYPE type;
         PRIMITIVE_TYPE primitiveType;
+        ResolvedSlot resolved;
 };
 
 class FunctionNode: public UnaryNode {
@@ -477,8 +543,11 @@ class ChemicalNode : public ASTNode {
         void printNode() override;
         std::string getFormula();
         void setFormula(std::string newName);
+        const ResolvedSlot& getResolved();
+        void setResolved(ResolvedSlot newResolved);
     private:
         std::string formula;
+        ResolvedSlot resolved;
 };
 
 class ReturnNode : public UnaryNode {
@@ -502,7 +571,7 @@ class KeywordNode : public BinaryNode {
         bool statementsAllowed();
         void setKeyword(KEYWORD newKeyword);
         void setAllowStatements(bool permission);
-        void assertKeyword(KEYWORD expectedKeyword, std::string errorMessageOnFail, bool reversed = false);
+        void assertKeyword(KEYWORD expectedKeyword, LazyMessage errorMessageOnFail, bool reversed = false);
     private:
         KEYWORD keyword;
         bool allowStatements;
@@ -544,5 +613,79 @@ class IndexNode : public BinaryNode {
         void printNode() override;
 };
 
+/*  One side of a chemical equation, flattened: 'A + 2 B + C' is a single node
+    holding the species A, B, C and their coefficients 1, 2, 1 side by side
+    instead of a chain of ADD and MULTIPLY symbol nodes. Species are
+    IdentifierNodes or ChemicalNodes, or IndexNodes until loops are expanded. */
+class SpeciesListNode : public ASTNode {
+    public:
+        SpeciesListNode();
+        SpeciesListNode(Tokenizer::Token* newToken);
+        ~SpeciesListNode();
+        void printNode() override;
+        void addSpecies(ASTNode* newSpecies, int coefficient);
+        size_t size();
+        ASTNode* getSpecies(size_t i);
+        void setSpecies(size_t i, ASTNode* newSpecies);
+        int getCoefficient(size_t i);
+        const std::vector<ASTNode*>& getSpeciesList();
+    private:
+        std::vector<ASTNode*> species;
+        std::vector<int> coefficients;
+};
+
+/*  Tag-checked downcasts:
+    --------------------------------------
+    Every node stores its NODE tag, so downcasting does not need RTTI.
+    nodeCast<T>(node) returns the node as a T* when its tag is T's tag or the
+    tag of a class derived from T, and nullptr otherwise (like dynamic_cast).
+*/
+template<typename T> struct NodeTag;
+template<> struct NodeTag<ASTNode> { static constexpr NODE value = NODE::AST_NODE; };
+template<> struct NodeTag<UnaryNode> { static constexpr NODE value = NODE::UNARY_NODE; };
+template<> struct NodeTag<BinaryNode> { static constexpr NODE value = NODE::BINARY_NODE; };
+template<> struct NodeTag<TernaryNode> { static constexpr NODE value = NODE::TERNARY_NODE; };
+template<> struct NodeTag<NumberNode> { static constexpr NODE value = NODE::NUMBER_NODE; };
+template<> struct NodeTag<SymbolNode> { static constexpr NODE value = NODE::SYMBOL_NODE; };
+template<> struct NodeTag<LoopingNode> { static constexpr NODE value = NODE::LOOPING_NODE; };
+template<> struct NodeTag<IfNode> { static constexpr NODE value = NODE::IF_NODE; };
+template<> struct NodeTag<IfElseNode> { static constexpr NODE value = NODE::IF_ELSE_NODE; };
+template<> struct NodeTag<IdentifierNode> { static constexpr NODE value = NODE::IDENTIFIER_NODE; };
+template<> struct NodeTag<FunctionNode> { static constexpr NODE value = NODE::FUNCTION_NODE; };
+template<> struct NodeTag<ChemicalNode> { static constexpr NODE value = NODE::CHEMICAL_NODE; };
+template<> struct NodeTag<ReturnNode> { static constexpr NODE value = NODE::RETURN_NODE; };
+template<> struct NodeTag<KeywordNode> { static constexpr NODE value = NODE::KEYWORD_NODE; };
+template<> struct NodeTag<ImportNode> { static constexpr NODE value = NODE::IMPORT_NODE; };
+template<> struct NodeTag<ParamNode> { static constexpr NODE value = NODE::PARAM_NODE; };
+template<> struct NodeTag<IndexNode> { static constexpr NODE value = NODE::INDEX_NODE; };
+template<> struct NodeTag<SpeciesListNode> { static constexpr NODE value = NODE::SPECIES_LIST_NODE; };
+
+// true if a node tagged 'actual' is an instance of the class tagged 'expected'
+inline bool nodeIsA(NODE actual, NODE expected) {
+    if (actual == expected || expected == NODE::AST_NODE) {
+        return true;
+    }
+    switch (expected) {
+        case NODE::UNARY_NODE:
+            return actual == NODE::RETURN_NODE || actual == NODE::FUNCTION_NODE;
+        case NODE::BINARY_NODE:
+            return actual == NODE::SYMBOL_NODE || actual == NODE::LOOPING_NODE ||
+                   actual == NODE::IF_NODE || actual == NODE::KEYWORD_NODE ||
+                   actual == NODE::INDEX_NODE;
+        case NODE::TERNARY_NODE:
+            return actual == NODE::IF_ELSE_NODE;
+        default:
+            return false;
+    }
+}
+
+template<typename T>
+T* nodeCast(ASTNode* node) {
+    if (node == nullptr || !nodeIsA(node->getNodeType(), NodeTag<T>::value)) {
+        return nullptr;
+    }
+    return static_cast<T*>(node);
+}
+
 template<typename Type>
 static int convertEnum(Type t);
\ No newline at end of file
@@ -0,0 +1,265 @@
+#include "compiledModel.h"
+#include "error.h"
+
+#include <cmath>
+#include <map>
+
+namespace lcc {
+
+static constexpr int TYPE_COUNT = static_cast<int>(REACTION_TYPE::CBMMU) + 1;
+static constexpr int PARAM_COUNT = static_cast<int>(PARAM::Ka) + 1;
+static constexpr PARAM REACTION_PARAMETERS[] = { PARAM::K, PARAM::KREV, PARAM::KCAT, PARAM::KM, PARAM::Ki,
+                                                 PARAM::n_param, PARAM::Ka };
+
+static void appendRow(CsrMatrix& matrix, const std::map<int, int>& row) {
+    if (matrix.offsets.empty()) {
+        matrix.offsets.push_back(0);
+    }
+    for (auto& [column, value] : row) {
+        if (value != 0) {
+            matrix.columns.push_back(column);
+            matrix.values.push_back(value);
+        }
+    }
+    matrix.offsets.push_back(matrix.columns.size());
+}
+
+// Preorder, so that the species of a compartment follow those of its parent; prefix is the path of compartment.
+static void collectCompartments(const Compartment* compartment, const std::string& prefix,
+                                std::vector<std::pair<const Compartment*, std::string>>& compartments) {
+    compartments.emplace_back(compartment, prefix);
+    for (Compartment* child : compartment->getChildren()) {
+        collectCompartments(child, prefix + child->getName() + "/", compartments);
+    }
+}
+
+/* A rule network only holds the species reached so far (see ruleNetwork.h); lowering one that is not expanded in
+   full, or that was cut off at its limits, would silently lose reactions. */
+static void checkRuleNetwork(const Compartment* compartment) {
+    const RuleNetwork& rules = compartment->getRuleNetwork();
+    if (rules.isTruncated()) {
+        error("Rule network of compartment " + compartment->getName() + " reached its limit of species or " +
+              "reactions and cannot be compiled in full.");
+    }
+    for (size_t species = 0; species < rules.speciesCount(); species++) {
+        if (!rules.isReached(species)) {
+            error("Rule network of compartment " + compartment->getName() + " is not expanded; call " +
+                  "Simulation::expandRuleNetworks() before compiling.");
+        }
+    }
+}
+
+CompiledModel::CompiledModel(const Simulation& simulation) {
+    std::vector<std::pair<const Compartment*, std::string>> compartments;
+    collectCompartments(simulation.getGlobalCompartment(), "", compartments);
+    for (auto& [compartment, prefix] : compartments) {
+        checkRuleNetwork(compartment);
+    }
+
+    std::unordered_map<const Compartment*, int> compartmentIds;
+    for (auto& [compartment, prefix] : compartments) {
+        compartmentIds[compartment] = compartmentNames.size();
+        compartmentNames.push_back(compartment->getName());
+        compartmentVolumes.push_back(compartment->getVolume());
+        compartmentOffsets.push_back(speciesNames.size());
+        for (Molecule* molecule : compartment->getMolecules()) {
+            speciesIds[prefix + molecule->getName()] = speciesNames.size();
+            speciesNames.push_back(prefix + molecule->getName());
+            speciesCompartments.push_back(compartmentIds[compartment]);
+            initialState.push_back(molecule->hasInitialCount() ? molecule->getInitialCount() : 0);
+        }
+    }
+    compartmentOffsets.push_back(speciesNames.size());
+    auto speciesOf = [&](Molecule* molecule) {
+        if (molecule == nullptr) {
+            return -1;
+        }
+        auto found = compartmentIds.find(molecule->getCompartment());
+        if (found == compartmentIds.end()) {
+            error("Molecule " + molecule->getName() + " is in a compartment outside of simulation " + simulation.getName() + ".");
+        }
+        return compartmentOffsets[found->second] + molecule->getIndexInCompartment();
+    };
+
+    // counting sort by type, stable within a type
+    std::vector<Reaction*> unsorted;
+    for (auto& [compartment, prefix] : compartments) {
+        unsorted.insert(unsorted.end(), compartment->getReactions().begin(), compartment->getReactions().end());
+    }
+    typeOffsets.assign(TYPE_COUNT + 1, 0);
+    for (Reaction* reaction : unsorted) {
+        typeOffsets[static_cast<int>(reaction->getType()) + 1]++;
+    }
+    for (int type = 0; type < TYPE_COUNT; type++) {
+        typeOffsets[type + 1] += typeOffsets[type];
+    }
+    std::vector<Reaction*> sorted(unsorted.size());
+    std::vector<int> next(typeOffsets.begin(), typeOffsets.end() - 1);
+    for (Reaction* reaction : unsorted) {
+        sorted[next[static_cast<int>(reaction->getType())]++] = reaction;
+    }
+
+    parameters.resize(PARAM_COUNT);
+    for (PARAM parameter : REACTION_PARAMETERS) {
+        parameters[static_cast<int>(parameter)].assign(sorted.size(), NAN);
+    }
+    for (size_t i = 0; i < sorted.size(); i++) {
+        Reaction* reaction = sorted[i];
+        reactionNames.push_back(reaction->getName());
+        reactionTypes.push_back(reaction->getType());
+        int compartment = compartmentIds.at(reaction->getCompartment());
+        double volume = compartmentVolumes[compartment];
+        reactionCompartments.push_back(compartment);
+        reactionVolumes.push_back(volume);
+
+        Activation* activation = dynamic_cast<Activation*>(reaction);
+        Inhibition* inhibition = dynamic_cast<Inhibition*>(reaction);
+        for (PARAM parameter : REACTION_PARAMETERS) {
+            double& value = parameters[static_cast<int>(parameter)][i];
+            if (reaction->hasParameter(parameter)) {
+                value = reaction->getParameterValue(parameter);
+            } else if (activation != nullptr && activation->hasActivationParameter(parameter)) {
+                value = activation->getActivationParameterValue(parameter);
+            } else if (inhibition != nullptr && inhibition->hasInhibitionParameter(parameter)) {
+                value = inhibition->getInhibitionParameterValue(parameter);
+            }
+        }
+        if (activation != nullptr) {
+            modifiers.push_back(speciesOf(activation->getActivator()));
+        } else if (inhibition != nullptr) {
+            modifiers.push_back(speciesOf(inhibition->getInhibitor()));
+        } else {
+            modifiers.push_back(reaction->hasProtein() ? speciesOf(reaction->getProtein()) : -1);
+        }
+
+        // both sides of a molecule on both sides count, ie. 2 A --> A + B is of order 2 and takes one A
+        std::map<int, int> orders;
+        std::map<int, int> coefficients;
+        std::map<int, int> net;
+        for (auto& [molecule, order] : reaction->getReactantCoefficients()) {
+            orders[speciesOf(molecule)] += order;
+            net[speciesOf(molecule)] -= order;
+        }
+        for (auto& [molecule, coefficient] : reaction->getProductCoefficients()) {
+            if (coefficient <= 0) {
+                error("Product " + molecule->getName() + " of reaction " + reaction->getName() +
+                      " has a coefficient that is not positive.");
+            }
+            coefficients[speciesOf(molecule)] += coefficient;
+            net[speciesOf(molecule)] += coefficient;
+        }
+        appendRow(reactantOrders, orders);
+        appendRow(productCoefficients, coefficients);
+        appendRow(stoichiometry, net);
+
+        double scaling = volume;
+        for (auto& [species, order] : orders) {
+            scaling /= std::pow(compartmentVolumes[speciesCompartments[species]], order);
+        }
+        propensityScaling.push_back(scaling);
+        for (auto& [species, value] : net) {
+            if (value != 0) {
+                stoichiometryScaling.push_back(volume / compartmentVolumes[speciesCompartments[species]]);
+            }
+        }
+    }
+    if (sorted.empty()) {
+        reactantOrders.offsets = productCoefficients.offsets = stoichiometry.offsets = { 0 };
+    }
+}
+
+size_t CompiledModel::compartmentCount() const {
+    return compartmentNames.size();
+}
+
+const std::string& CompiledModel::getCompartmentName(int compartment) const {
+    return compartmentNames[compartment];
+}
+
+double CompiledModel::getCompartmentVolume(int compartment) const {
+    return compartmentVolumes[compartment];
+}
+
+std::pair<int, int> CompiledModel::getCompartmentRange(int compartment) const {
+    return { compartmentOffsets[compartment], compartmentOffsets[compartment + 1] };
+}
+
+size_t CompiledModel::speciesCount() const {
+    return speciesNames.size();
+}
+
+const std::string& CompiledModel::getSpeciesName(int species) const {
+    return speciesNames[species];
+}
+
+int CompiledModel::findSpecies(const std::string& name) const {
+    auto found = speciesIds.find(name);
+    return found == speciesIds.end() ? -1 : found->second;
+}
+
+int CompiledModel::getSpeciesCompartment(int species) const {
+    return speciesCompartments[species];
+}
+
+const std::vector<double>& CompiledModel::getInitialState() const {
+    return initialState;
+}
+
+size_t CompiledModel::reactionCount() const {
+    return reactionNames.size();
+}
+
+const std::string& CompiledModel::getReactionName(int reaction) const {
+    return reactionNames[reaction];
+}
+
+REACTION_TYPE CompiledModel::getReactionType(int reaction) const {
+    return reactionTypes[reaction];
+}
+
+std::pair<int, int> CompiledModel::getTypeRange(REACTION_TYPE type) const {
+    int index = static_cast<int>(type);
+    return { typeOffsets[index], typeOffsets[index + 1] };
+}
+
+const std::vector<double>& CompiledModel::getParameter(PARAM parameter) const {
+    const std::vector<double>& values = parameters[static_cast<int>(parameter)];
+    if (values.size() != reactionNames.size()) {
+        error(std::string("Parameter ") + paramToText(parameter) + " is not a reaction parameter.");
+    }
+    return values;
+}
+
+const std::vector<int>& CompiledModel::getModifiers() const {
+    return modifiers;
+}
+
+const CsrMatrix& CompiledModel::getReactantOrders() const {
+    return reactantOrders;
+}
+
+const CsrMatrix& CompiledModel::getProductCoefficients() const {
+    return productCoefficients;
+}
+
+const CsrMatrix& CompiledModel::getStoichiometry() const {
+    return stoichiometry;
+}
+
+const std::vector<int>& CompiledModel::getReactionCompartments() const {
+    return reactionCompartments;
+}
+
+const std::vector<double>& CompiledModel::getReactionVolumes() const {
+    return reactionVolumes;
+}
+
+const std::vector<double>& CompiledModel::getPropensityScaling() const {
+    return propensityScaling;
+}
+
+const std::vector<double>& CompiledModel::getStoichiometryScaling() const {
+    return stoichiometryScaling;
+}
+
+}
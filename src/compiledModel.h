@@ -0,0 +1,121 @@
+#pragma once
+
+#include "context.h"
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace lcc {
+
+/* Sparse matrix in compressed sparse row form: the entries of row r are columns[offsets[r] .. offsets[r + 1])
+   and values[offsets[r] .. offsets[r + 1]), in increasing column order. */
+struct CsrMatrix {
+    std::vector<int> offsets;       // rows + 1 entries
+    std::vector<int> columns;
+    std::vector<int> values;
+
+    size_t rows() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+    size_t nonZeros() const { return columns.size(); }
+};
+
+/*  Compiled Model:
+    --------------------------------------
+    Immutable, flat form of a Simulation for numerical engines, lowered once
+    after context building:
+        - the compartment tree is flattened in preorder, and the species of
+          all compartments are numbered 0..n-1, those of one compartment
+          contiguously (getCompartmentRange()); species of compartments
+          below the global one are named by their path, ie. "cell/nucleus/X"
+        - initial counts are one contiguous state vector (0 for species
+          without one)
+        - reactions are sorted by REACTION_TYPE, so that a kernel runs one
+          rate law over a contiguous range (getTypeRange())
+        - parameters are one array per PARAM, indexed by reaction, NaN where
+          the reaction has no such parameter; an activation or inhibition
+          adds its own parameters (Ka, Ki, n) to those of its reaction
+        - the enzyme, activator or inhibitor of a reaction is its modifier
+        - reactant orders, product coefficients and the net stoichiometry
+          (products minus reactants) are CSR matrices with a row per
+          reaction and a column per species
+        - volumes are resolved per reaction and species, so that a kernel
+          never looks at compartments: a reaction's rate, in concentration
+          per time of its own compartment, changes species s by
+          stoichiometry * getStoichiometryScaling() (its volume over that of
+          s), and getPropensityScaling() turns the product of reactant
+          amounts into that of concentrations times the reaction's volume
+    None of it points back into the Simulation, which may be freed once the
+    model is compiled. Compiling does not change the Simulation: rule
+    networks must be expanded in full beforehand
+    (Simulation::expandRuleNetworks()), and one that is not, or that hit
+    its limits, is an error.
+*/
+
+class CompiledModel {
+    public:
+        explicit CompiledModel(const Simulation& simulation);
+
+        size_t compartmentCount() const;
+        const std::string& getCompartmentName(int compartment) const;
+        double getCompartmentVolume(int compartment) const;
+        // species of compartment, as [first, second)
+        std::pair<int, int> getCompartmentRange(int compartment) const;
+
+        size_t speciesCount() const;
+        const std::string& getSpeciesName(int species) const;
+        // -1 if there is no species named name
+        int findSpecies(const std::string& name) const;
+        int getSpeciesCompartment(int species) const;
+        const std::vector<double>& getInitialState() const;
+
+        size_t reactionCount() const;
+        const std::string& getReactionName(int reaction) const;
+        REACTION_TYPE getReactionType(int reaction) const;
+        // reactions of type, as [first, second)
+        std::pair<int, int> getTypeRange(REACTION_TYPE type) const;
+        // value per reaction; NaN where a reaction has no such parameter
+        const std::vector<double>& getParameter(PARAM parameter) const;
+        // species per reaction, -1 where a reaction has none
+        const std::vector<int>& getModifiers() const;
+
+        const CsrMatrix& getReactantOrders() const;
+        const CsrMatrix& getProductCoefficients() const;
+        const CsrMatrix& getStoichiometry() const;
+
+        // compartment per reaction, the one the reaction was declared in
+        const std::vector<int>& getReactionCompartments() const;
+        // volume of the compartment per reaction
+        const std::vector<double>& getReactionVolumes() const;
+        // per reaction, its volume over the product of reactant volumes to the power of their orders
+        const std::vector<double>& getPropensityScaling() const;
+        // per entry of getStoichiometry(), the reaction's volume over the species' volume
+        const std::vector<double>& getStoichiometryScaling() const;
+
+    private:
+        std::vector<std::string> compartmentNames;
+        std::vector<double> compartmentVolumes;
+        std::vector<int> compartmentOffsets;            // compartment -> first species, one past the last at the end
+
+        std::vector<std::string> speciesNames;
+        std::unordered_map<std::string, int> speciesIds;
+        std::vector<int> speciesCompartments;
+        std::vector<double> initialState;
+
+        std::vector<std::string> reactionNames;
+        std::vector<REACTION_TYPE> reactionTypes;
+        std::vector<int> typeOffsets;                   // REACTION_TYPE -> first reaction, one past the last type at the end
+        std::vector<std::vector<double>> parameters;    // PARAM -> value per reaction
+        std::vector<int> modifiers;
+
+        CsrMatrix reactantOrders;
+        CsrMatrix productCoefficients;
+        CsrMatrix stoichiometry;
+
+        std::vector<int> reactionCompartments;
+        std::vector<double> reactionVolumes;
+        std::vector<double> propensityScaling;
+        std::vector<double> stoichiometryScaling;
+};
+
+}
@@ -1,6 +1,7 @@
 #include <string>
 #include <vector>
 #include <unordered_set>
+#include <array>
 #include <map>
 #include <unordered_map>
 #include <optional>
@@ -9,6 +10,7 @@
 #include <math.h>
 #include <iterator>
 #include <stack>
+#include <queue>
 #include <list>
 #include <limits>
 #include <math.h>
@@ -39,14 +41,84 @@ std::unordered_map<REACTION_TYPE, std::string> reactionTypeToAcronym = {
 
 namespace {
     std::vector<REACTION_TYPE> validReactionTypes = {REACTION_TYPE::SU, REACTION_TYPE::SAI, REACTION_TYPE::SAA, REACTION_TYPE::ESU, REACTION_TYPE::MMU, REACTION_TYPE::RB, REACTION_TYPE::CBSU, REACTION_TYPE::CBESU, REACTION_TYPE::CBMMU};
-    std::unordered_set<PARAM> validReactionParameters = {PARAM::K, PARAM::KREV, PARAM::KCAT, PARAM::KM, PARAM::Ki, PARAM::Ka, PARAM::n_param};
-    std::unordered_map<REACTION_TYPE, std::vector<PARAM>> requiredParams = {
-            {REACTION_TYPE::SU,  {PARAM::K,    PARAM::KREV}},
-            {REACTION_TYPE::SAI, {PARAM::Ki,   PARAM::n_param}},
-            {REACTION_TYPE::SAA, {PARAM::Ka,   PARAM::n_param}},
-            {REACTION_TYPE::ESU, {PARAM::K,    PARAM::KREV}},
-            {REACTION_TYPE::MMU, {PARAM::KCAT, PARAM::KM}}
+    constexpr ParamMask REACTION_PARAMETERS = paramBit(PARAM::K) | paramBit(PARAM::KREV) | paramBit(PARAM::KCAT) |
+                                              paramBit(PARAM::KM) | paramBit(PARAM::Ki) | paramBit(PARAM::Ka) |
+                                              paramBit(PARAM::n_param);
+
+    /* Parameters a reaction of a type must have, and those it may have on top of them: an SU reaction given only k
+     * gets krev = 0 in Reaction::setType(). Types without an entry cannot be inferred from parameters. */
+    struct TypeSignature {
+        ParamMask required = 0;
+        ParamMask optional = 0;
     };
+    constexpr size_t TYPE_COUNT = static_cast<size_t>(REACTION_TYPE::CBMMU) + 1;
+    constexpr std::array<TypeSignature, TYPE_COUNT> makeTypeSignatures() {
+        std::array<TypeSignature, TYPE_COUNT> signatures{};
+        signatures[static_cast<size_t>(REACTION_TYPE::SU)]  = {paramBit(PARAM::K), paramBit(PARAM::KREV)};
+        signatures[static_cast<size_t>(REACTION_TYPE::SAI)] = {paramBit(PARAM::Ki) | paramBit(PARAM::n_param), 0};
+        signatures[static_cast<size_t>(REACTION_TYPE::SAA)] = {paramBit(PARAM::Ka) | paramBit(PARAM::n_param), 0};
+        signatures[static_cast<size_t>(REACTION_TYPE::ESU)] = {paramBit(PARAM::K) | paramBit(PARAM::KREV), 0};
+        signatures[static_cast<size_t>(REACTION_TYPE::MMU)] = {paramBit(PARAM::KCAT) | paramBit(PARAM::KM), 0};
+        return signatures;
+    }
+    constexpr std::array<TypeSignature, TYPE_COUNT> typeSignatures = makeTypeSignatures();
+
+    /* The reaction parameters are consecutive PARAMs, so every set of them is a small index into a table of the
+     * types (bit per REACTION_TYPE) that the set admits. Sets with any other parameter admit no type. */
+    constexpr int FIRST_REACTION_PARAMETER = static_cast<int>(PARAM::KREV);
+    constexpr size_t REACTION_PARAMETER_SETS = size_t(1) << 7;
+    static_assert(REACTION_PARAMETERS == (REACTION_PARAMETER_SETS - 1) << FIRST_REACTION_PARAMETER,
+                  "reaction parameters must be consecutive PARAMs starting at KREV");
+
+    using TypeMask = uint32_t;
+    constexpr TypeMask typeBit(REACTION_TYPE type) {
+        return TypeMask(1) << static_cast<int>(type);
+    }
+    constexpr std::array<TypeMask, REACTION_PARAMETER_SETS> makeAdmissibleTypes() {
+        std::array<TypeMask, REACTION_PARAMETER_SETS> admissible{};
+        for (size_t set = 0; set < REACTION_PARAMETER_SETS; set++) {
+            ParamMask mask = ParamMask(set) << FIRST_REACTION_PARAMETER;
+            for (size_t type = 0; type < TYPE_COUNT; type++) {
+                const TypeSignature& signature = typeSignatures[type];
+                if (signature.required != 0 && (mask & signature.required) == signature.required &&
+                    (mask & ~(signature.required | signature.optional)) == 0) {
+                    admissible[set] |= TypeMask(1) << type;
+                }
+            }
+        }
+        return admissible;
+    }
+    constexpr std::array<TypeMask, REACTION_PARAMETER_SETS> admissibleTypes = makeAdmissibleTypes();
+
+    TypeMask typesAdmittedBy(ParamMask parameters) {
+        if ((parameters & ~REACTION_PARAMETERS) != 0) {
+            return 0;
+        }
+        return admissibleTypes[parameters >> FIRST_REACTION_PARAMETER];
+    }
+
+    int countParameters(ParamMask parameters) {
+        int count = 0;
+        for (; parameters != 0; parameters &= parameters - 1) {
+            count++;
+        }
+        return count;
+    }
+
+    // "k and krev" for a mask of the two
+    std::string listParameters(ParamMask parameters) {
+        std::vector<std::string> names;
+        for (int bit = 0; bit < 32; bit++) {
+            if (parameters & (ParamMask(1) << bit)) {
+                names.push_back(paramToText(static_cast<PARAM>(bit)));
+            }
+        }
+        std::string list;
+        for (size_t i = 0; i < names.size(); i++) {
+            list += (i == 0 ? "" : i + 1 == names.size() ? " and " : ", ") + names[i];
+        }
+        return list;
+    }
 }
 
 /* FIXEDCOUNTHANDLER */
@@ -73,6 +145,7 @@ class FixedCountHandler {
         void addChangePoint(double time, double value);
 
         const std::map<double, std::optional<double>>& getIntervalPoints();
+        const std::vector<FixedCountStep>& getTimeline();
         void addInterval(double value, double startTime, double endTime);
     private:
         Molecule* molecule;
@@ -83,15 +156,13 @@ class FixedCountHandler {
 
         // Tuples are <start, end, value>. Order is important: has intervals in the order they were added.
         std::vector<std::tuple<double, double, double>> intervals;
-        // Tuples are <start, end, possible value>.
-        std::list<std::tuple<double, double, std::optional<double>>> processedIntervals;
+        // Sorted by time, see FixedCountStep.
+        std::vector<FixedCountStep> timeline;
         // Points are <time, value to change to>. See wiki/Compiler Context/Interface Notes/Constant, Changed and Fixed Molecules (Interface)/ for more info.
         std::map<double, std::optional<double>> intervalPoints;
         bool haveBeenProcessed = false;
 
         void processIntervals();
-        void removeExtraIntervals();
-        void mergeIntervals();
         void convertIntervals();
 };
 
@@ -140,14 +211,17 @@ void FixedCountHandler::addChangePoint(double time, double value) {
 const std::map<double, std::optional<double>>& FixedCountHandler::getIntervalPoints() {
     if (!haveBeenProcessed) {
         processIntervals();
-        removeExtraIntervals();
-        mergeIntervals();
         convertIntervals();
         haveBeenProcessed = true;
     }
     return intervalPoints;
 }
 
+const std::vector<FixedCountStep>& FixedCountHandler::getTimeline() {
+    this->getIntervalPoints();
+    return timeline;
+}
+
 void FixedCountHandler::addInterval(double value, double startTime, double endTime) {
     if (startTime < 0) {
         error("Assignment to molecule " + molecule->getName() + " of count " + std::to_string(value) + " at times (start, end) = (" + std::to_string(startTime) + ", " + std::to_string(endTime) + ") has invalid negative start time.");
@@ -167,139 +241,56 @@ void FixedCountHandler::addInterval(double value, double startTime, double endTi
     }
 }
 
-// See wiki/Compiler Context/Implementation Notes/processIntervals()/
+/* Sweeps the start and end times of the intervals in time order, keeping the intervals in effect in a max-heap of
+ * declaration indices, as the latest declaration wins where intervals overlap. An interval that ended stays in the
+ * heap until it reaches the top. After all events at one time, the count is that of the top interval, or free if
+ * there is none; a step is only added where this count changes, so zero-length and adjacent equal slices never
+ * appear. O(n log n) in the number of intervals.
+ * */
 void FixedCountHandler::processIntervals() {
-    constexpr int TIME_INDEX = 0;
-    constexpr int VALUE_INDEX = 1;
-    constexpr int INDEX_INDEX = 2;
-    constexpr int IS_END_INDEX = 3;
-
-    // Tuples are of the form (time, value, isEnd, index)
-    // if isEnd = false, time refers to time that this interval starts. Otherwise, time that it ends.
-    // index is for sorting later so that we preserve declaration order
-
-    // processedIntervals.CODEPOINT 1
-    std::vector<std::tuple<double, double, int, bool>> startAndEndTuples;
-    {
-        int index = 0;
-        for (auto& [startTime, endTime, value] : intervals) {
-            std::tuple<double, double, int, bool> startTuple(startTime, value, index, false);
-            startAndEndTuples.push_back(startTuple);
-            if (!isinf(endTime)) {
-                std::tuple<double, double, int, bool> endTuple(endTime, value, index, true);
-                startAndEndTuples.push_back(endTuple);
-            }
-            index++;
+    // (time, isEnd, index): ends sort after starts at the same time, so an interval [t, t] never takes effect
+    std::vector<std::tuple<double, bool, int>> events;
+    events.reserve(2 * intervals.size());
+    for (size_t index = 0; index < intervals.size(); index++) {
+        auto& [startTime, endTime, value] = intervals[index];
+        events.emplace_back(startTime, false, index);
+        if (!isinf(endTime)) {
+            events.emplace_back(endTime, true, index);
         }
     }
-    // processedIntervals.CODEPOINT 2
-
-    if (startAndEndTuples.empty()) { return; }
-
-    std::sort(startAndEndTuples.begin(), startAndEndTuples.end(),
-              [](const auto& lhs, const auto& rhs) {
-                  // sorts by time, then by end-ness, then by index
-                  if (std::get<TIME_INDEX>(lhs) != std::get<TIME_INDEX>(rhs)) {
-                      return std::get<TIME_INDEX>(lhs) < std::get<TIME_INDEX>(rhs);
-                  } else if (std::get<IS_END_INDEX>(lhs) != std::get<IS_END_INDEX>(rhs)) {
-                      return std::get<IS_END_INDEX>(lhs) < std::get<IS_END_INDEX>(rhs);
-                  } else {
-                      return std::get<INDEX_INDEX>(lhs) < std::get<INDEX_INDEX>(rhs);
-                  }
-              });
-
-    // For code clarity below.
-    typedef std::list<std::pair<std::optional<double>, int>> scopeType; // N.B. the word scope as used here refers to something else than scope used everywhere else in LCC
-    constexpr int START_TIME_INDEX = 0;
-    constexpr int END_TIME_INDEX = 1;
-    constexpr int SCOPE_INDEX = 2;
-
-    std::vector<std::tuple<double, double, scopeType>> intervalsWithScopes;
-
-    scopeType startingScope;
-    std::pair<std::optional<double>, int> base = {std::nullopt, -1};
-    startingScope.push_back(base);
-    std::tuple<double, double, scopeType> nextTuple(0, -1, startingScope);
-
-    // processedIntervals.CODEPOINT 3
-    for (auto& [time, value, index, isEnd] : startAndEndTuples) {
-        // Now that we know the end time for the last interval, modify and push it.
-        std::get<END_TIME_INDEX>(nextTuple) = time;
-        intervalsWithScopes.push_back(nextTuple);
-        // Then, modify the next scope as determined by the tuple we are processing.
-        scopeType scope(std::get<SCOPE_INDEX>(nextTuple));  // copies
-        std::pair<std::optional<double>, int> declaration = {std::optional<double>(value), index};
-        if (!isEnd) {
-            scope.push_front(declaration);
-        } else {
-            auto iter = find_if(scope.begin(), scope.end(),
-                                [=](auto item) {
-                                    return std::get<0>(item) == std::get<0>(declaration)
-                                           && std::get<1>(item) == std::get<1>(declaration);
-                                });
-            if (iter == scope.end()) {
-                error("Closing constant molecule count declaration that doesn't exist.");
-            }
-            scope.erase(iter);
-        }
-        nextTuple = {time, -1, scope};
-    }
-    std::get<END_TIME_INDEX>(nextTuple) = std::numeric_limits<double>::infinity();
-    intervalsWithScopes.push_back(nextTuple);
-
-    // processedIntervals.CODEPOINT 4
+    std::sort(events.begin(), events.end());
 
-    processedIntervals.clear();
-
-    for (auto& [startTime, endTime, scope] : intervalsWithScopes) {
-        int largestIndex = std::numeric_limits<int>::min();
-        std::optional<double> value(std::nullopt);
-        for (auto& [tempValue, index] : scope) {
-            if (index > largestIndex) {
-                largestIndex = index;
-                value = tempValue;
+    timeline.clear();
+    if (events.empty()) {
+        return;
+    }
+    timeline.push_back({0, std::nullopt});
+    std::priority_queue<int> active;
+    std::vector<bool> ended(intervals.size(), false);
+    for (size_t event = 0; event < events.size();) {
+        double time = std::get<0>(events[event]);
+        for (; event < events.size() && std::get<0>(events[event]) == time; event++) {
+            auto& [eventTime, isEnd, index] = events[event];
+            if (isEnd) {
+                ended[index] = true;
+            } else {
+                active.push(index);
             }
         }
-        std::tuple<double, double, std::optional<double>> processedInterval = {startTime, endTime, value};
-        processedIntervals.push_back(processedInterval);
-    }
-}
-
-// See wiki/Compiler Context/Implementation Notes/getIntervalPoints() Overview/
-void FixedCountHandler::removeExtraIntervals() {
-    auto iterator = processedIntervals.begin();
-    while (iterator != processedIntervals.end()) {
-        auto& [start, end, value] = *iterator;
-        if (start == end) {
-            iterator = processedIntervals.erase(iterator);
-        } else {
-            ++iterator;
+        while (!active.empty() && ended[active.top()]) {
+            active.pop();
+        }
+        std::optional<double> count;
+        if (!active.empty()) {
+            count = std::get<2>(intervals[active.top()]);
         }
-    }
-}
-
-// See wiki/Compiler Context/Implementation Notes/getIntervalPoints() Overview/
-void FixedCountHandler::mergeIntervals() {
-    auto iterator = processedIntervals.begin();
-    if (iterator == processedIntervals.end()) {
-        return;
-    }
-    auto nextIterator = std::next(iterator);
-    while (nextIterator != processedIntervals.end()) {
-        auto& [start1, end1, value1] = *iterator;
-        auto& [start2, end2, value2] = *nextIterator;
-        if (value1 == value2) {
-            std::tuple<double, double, std::optional<double>> newTuple(start1, end2, value1);
-
-            processedIntervals.erase(nextIterator);  // Don't need to update nextIterator as we will reassign below.
-            iterator = processedIntervals.erase(iterator);
 
-            // We don't want to advance iterator as there may be more intervals with the same value.
-            iterator = processedIntervals.insert(iterator, newTuple);
-            nextIterator = std::next(iterator);
-        } else {
-            ++iterator;
-            ++nextIterator;
+        if (timeline.back().time == time) {
+            // only at time 0, replacing the initial free step
+            timeline.pop_back();
+        }
+        if (timeline.empty() || timeline.back().count != count) {
+            timeline.push_back({time, count});
         }
     }
 }
@@ -307,8 +298,8 @@ void FixedCountHandler::mergeIntervals() {
 // See wiki/Compiler Context/Implementation Notes/getIntervalPoints() Overview/
 void FixedCountHandler::convertIntervals() {
     intervalPoints.clear();
-    for (auto& [start, end, value] : processedIntervals) {
-        intervalPoints[start] = value;
+    for (auto& [time, count] : timeline) {
+        intervalPoints.emplace_hint(intervalPoints.end(), time, count);
     }
 }
 
@@ -387,6 +378,10 @@ const std::map<double, std::optional<double>>& Molecule::getIntervalPoints() con
     return fixedCountHandler->getIntervalPoints();
 }
 
+const std::vector<FixedCountStep>& Molecule::getFixedCountTimeline() const {
+    return fixedCountHandler->getTimeline();
+}
+
 /* REACTION */
 
 Reaction::Reaction(Compartment* newCompartment, const std::string& newName) :
@@ -398,7 +393,10 @@ Reaction::Reaction(Compartment* newCompartment, const std::string& newName) :
         products(),
 
         stoichiometry(),
-        parameters()
+        reactantCoefficients(),
+        productCoefficients(),
+        parameters(),
+        parameterMask(0)
 {
     if (newCompartment == nullptr) {
         error("newCompartment passed to Reaction::Reaction() constructor cannot be null.");
@@ -414,7 +412,10 @@ Reaction::Reaction(const Reaction& reaction) :
         products(reaction.products),
 
         stoichiometry(reaction.stoichiometry),
-        parameters(reaction.parameters) {
+        reactantCoefficients(reaction.reactantCoefficients),
+        productCoefficients(reaction.productCoefficients),
+        parameters(reaction.parameters),
+        parameterMask(reaction.parameterMask) {
 
 }
 
@@ -433,20 +434,46 @@ REACTION_TYPE Reaction::getType() const {
 }
 
 bool Reaction::canHaveType(REACTION_TYPE reactionType) const {
-    if (reactionType == REACTION_TYPE::SU && parameters.size() == 1 && parameters.count(PARAM::K) == 1) {
-        // Special handling for implied krev = 0 (i.e. only k specified). krev will be set to 0 when reaction type is assigned in setType().
-        return true;
+    return (typesAdmittedBy(this->getTypeParameterMask()) & typeBit(reactionType)) != 0;
+}
+
+void Reaction::inferType(std::initializer_list<REACTION_TYPE> candidates, const std::string& displayName) {
+    ParamMask parameters = this->getTypeParameterMask();
+    TypeMask admitted = typesAdmittedBy(parameters);
+    for (REACTION_TYPE candidate : candidates) {
+        if (admitted & typeBit(candidate)) {
+            this->setType(candidate);
+            return;
+        }
     }
-    if (parameters.size() > requiredParams[reactionType].size()) {
-        return false;
-    } else {
-        for (PARAM requiredParam : requiredParams[reactionType]) {
-            if (parameters.count(requiredParam) == 0) {
-                return false;
-            }
+
+    // the candidate needing the fewest parameters added or taken away
+    ParamMask missing = 0;
+    ParamMask conflicting = 0;
+    REACTION_TYPE closest = REACTION_TYPE::NOT_YET_DETERMINED;
+    for (REACTION_TYPE candidate : candidates) {
+        const TypeSignature& signature = typeSignatures[static_cast<size_t>(candidate)];
+        ParamMask candidateMissing = signature.required & ~parameters;
+        ParamMask candidateConflicting = parameters & ~(signature.required | signature.optional);
+        if (closest == REACTION_TYPE::NOT_YET_DETERMINED ||
+            countParameters(candidateMissing) + countParameters(candidateConflicting) <
+            countParameters(missing) + countParameters(conflicting)) {
+            closest = candidate;
+            missing = candidateMissing;
+            conflicting = candidateConflicting;
         }
     }
-    return true;
+    std::string message = "Reaction type of reaction " + displayName + " cannot be determined: as type " +
+                          reactionTypeToAcronym.at(closest) + " it";
+    if (missing != 0) {
+        message += " is missing parameter" + std::string(countParameters(missing) > 1 ? "s " : " ") +
+                   listParameters(missing);
+    }
+    if (conflicting != 0) {
+        message += std::string(missing != 0 ? " and" : "") + " has conflicting parameter" +
+                   (countParameters(conflicting) > 1 ? "s " : " ") + listParameters(conflicting);
+    }
+    error(message + ".");
 }
 
 void Reaction::setType(REACTION_TYPE newType) {
@@ -454,6 +481,7 @@ void Reaction::setType(REACTION_TYPE newType) {
         // TODO: wrap message behind compiler flags
         std::cout << "Warning: reaction " << this->getName() << " in compartment " << compartment->getName() << " was assumed to have implicit parameter krev = 0." << std::endl;
         parameters[PARAM::KREV] = 0.0;
+        parameterMask |= paramBit(PARAM::KREV);
     }
     type = newType;
 }
@@ -465,6 +493,8 @@ const std::vector<Molecule*>& Reaction::getReactants() const {
 void Reaction::addReactant(Molecule* molecule, int stoichiometricCoefficient) {
     reactants.push_back(molecule);
     stoichiometry[molecule] = stoichiometricCoefficient;
+    // reactant coefficients are given negative
+    reactantCoefficients[molecule] += stoichiometricCoefficient < 0 ? -stoichiometricCoefficient : 1;
 }
 
 const std::vector<Molecule*>& Reaction::getProducts() const {
@@ -474,6 +504,7 @@ const std::vector<Molecule*>& Reaction::getProducts() const {
 void Reaction::addProduct(Molecule* molecule, int stoichiometricCoefficient) {
     products.push_back(molecule);
     stoichiometry[molecule] = stoichiometricCoefficient;
+    productCoefficients[molecule] += stoichiometricCoefficient;
 }
 
 bool Reaction::hasProtein() const {
@@ -498,6 +529,14 @@ int Reaction::getStoichiometricCoefficient(Molecule* molecule) {
     return stoichiometry[molecule];
 }
 
+const std::unordered_map<Molecule*, int>& Reaction::getReactantCoefficients() const {
+    return reactantCoefficients;
+}
+
+const std::unordered_map<Molecule*, int>& Reaction::getProductCoefficients() const {
+    return productCoefficients;
+}
+
 bool Reaction::hasParameter(PARAM parameter) const {
     return parameters.count(parameter) > 0;
 }
@@ -510,8 +549,17 @@ const std::unordered_map<PARAM, double>& Reaction::getParameters() const {
     return parameters;
 }
 
+ParamMask Reaction::getParameterMask() const {
+    return parameterMask;
+}
+
 void Reaction::addParameter(PARAM parameterName, double value) {
     parameters[parameterName] = value;
+    parameterMask |= paramBit(parameterName);
+}
+
+ParamMask Reaction::getTypeParameterMask() const {
+    return parameterMask;
 }
 
 /* ACTIVATION : REACTION */
@@ -520,7 +568,8 @@ Activation::Activation(Reaction* oldReaction, const std::string& newActivationRe
         Reaction(*oldReaction),
         activationReactionName(newActivationReactionName),
         activator(newActivator),
-        activationParameters() {
+        activationParameters(),
+        activationParameterMask(0) {
     if (oldReaction->getType() != REACTION_TYPE::SU) {
         error("Converting reactions to activations is only supported for standard unregulated reactions.");
     }
@@ -546,19 +595,11 @@ double Activation::getActivationParameterValue(PARAM parameter) const {
 
 void Activation::addActivationParameter(PARAM parameterName, double value) {
     activationParameters[parameterName] = value;
+    activationParameterMask |= paramBit(parameterName);
 }
 
-bool Activation::canHaveType(REACTION_TYPE reactionType) const {
-    if (activationParameters.size() > requiredParams[reactionType].size()) {
-        return false;
-    } else {
-        for (PARAM requiredParam : requiredParams[reactionType]) {
-            if (activationParameters.count(requiredParam) == 0) {
-                return false;
-            }
-        }
-    }
-    return true;
+ParamMask Activation::getTypeParameterMask() const {
+    return activationParameterMask;
 }
 
 /* INHIBITION : REACTION */
@@ -567,7 +608,8 @@ Inhibition::Inhibition(Reaction* oldReaction, const std::string& newInhibitionRe
         Reaction(*oldReaction),
         inhibitionReactionName(newInhibitionReactionName),
         inhibitor(newInhibitor),
-        inhibitionParameters() {
+        inhibitionParameters(),
+        inhibitionParameterMask(0) {
     if (oldReaction->getType() != REACTION_TYPE::SU) {
         error("Converting reactions to inhibitions is only supported for standard unregulated reactions.");
     }
@@ -593,19 +635,11 @@ double Inhibition::getInhibitionParameterValue(PARAM parameter) const {
 
 void Inhibition::addInhibitionParameter(PARAM parameterName, double value) {
     inhibitionParameters[parameterName] = value;
+    inhibitionParameterMask |= paramBit(parameterName);
 }
 
-bool Inhibition::canHaveType(REACTION_TYPE reactionType) const {
-    if (inhibitionParameters.size() > requiredParams[reactionType].size()) {
-        return false;
-    } else {
-        for (PARAM requiredParam : requiredParams[reactionType]) {
-            if (inhibitionParameters.count(requiredParam) == 0) {
-                return false;
-            }
-        }
-    }
-    return true;
+ParamMask Inhibition::getTypeParameterMask() const {
+    return inhibitionParameterMask;
 }
 
 /* COMPARTMENT */
@@ -616,8 +650,8 @@ Compartment::Compartment(Compartment* newParent, const std::string& newName, COM
         volume(LCC_DEFAULT_VOLUME),
         isSpatial(false),
 
-        moleculeNameToIndex(),
-        reactionNameToIndex(),
+        moleculeNameToHandle(),
+        reactionNameToHandle(),
         molecules(),
         reactions(),
 
@@ -630,8 +664,8 @@ Compartment::Compartment(Compartment* newParent, const std::string& newName, COM
         volume(newVolume),
         isSpatial(false),
 
-        moleculeNameToIndex(),
-        reactionNameToIndex(),
+        moleculeNameToHandle(),
+        reactionNameToHandle(),
         molecules(),
         reactions(),
 
@@ -644,8 +678,8 @@ Compartment::Compartment(Compartment* newParent, const std::string& newName, COM
         volume(LCC_DEFAULT_VOLUME),
         isSpatial(newIsSpatial),
 
-        moleculeNameToIndex(),
-        reactionNameToIndex(),
+        moleculeNameToHandle(),
+        reactionNameToHandle(),
         molecules(),
         reactions(),
 
@@ -659,18 +693,18 @@ Compartment::Compartment(Compartment* newParent, const std::string& newName, COM
         volume(newVolume),
         isSpatial(newIsSpatial),
 
-        moleculeNameToIndex(),
-        reactionNameToIndex(),
+        moleculeNameToHandle(),
+        reactionNameToHandle(),
         molecules(),
         reactions(),
 
         children() {}
 
 Compartment::~Compartment() {
-    for (Molecule* molecule : molecules) {
+    for (Molecule* molecule : molecules.values()) {
         delete molecule;
     }
-    for (Reaction* reaction : reactions) {
+    for (Reaction* reaction : reactions.values()) {
         delete reaction;
     }
     for (Compartment* child : children) {
@@ -707,20 +741,237 @@ void Compartment::addChild(Compartment* child) {
 }
 
 const std::vector<Molecule*>& Compartment::getMolecules() const {
-    return molecules;
+    return molecules.values();
 }
 
 bool Compartment::hasMolecule(const std::string& nameToSearch) const {
-    return moleculeNameToIndex.count(nameToSearch) > 0;
+    return moleculeNameToHandle.count(nameToSearch) > 0;
 }
 
 Molecule* Compartment::getMolecule(const std::string& nameToFind) const {
-    return molecules[moleculeNameToIndex.at(nameToFind)];
+    return molecules.get(moleculeNameToHandle.at(nameToFind));
 }
 
 void Compartment::addMolecule(Molecule* molecule) {
-    molecules.push_back(molecule);
-    moleculeNameToIndex[molecule->getName()] = molecules.size() - 1;
+    moleculeNameToHandle[molecule->getName()] = molecules.insert(molecule);
+}
+
+void Compartment::removeMolecule(Molecule* molecule) {
+    SlotHandle handle = moleculeNameToHandle.at(molecule->getName());
+    moleculeNameToHandle.erase(molecule->getName());
+    molecules.remove(handle);
+    if (molecule->indexInCompartment < (int) molecules.size()) {
+        // the last molecule moved into the removed one's place
+        molecules.values()[molecule->indexInCompartment]->indexInCompartment = molecule->indexInCompartment;
+    }
+}
+
+// NameResolver ID of an IDENTIFIER or CHEMICAL node, or -1 if it was not resolved.
+static int nameIdOf(ASTNode* node) {
+    if (IdentifierNode* identifier = nodeCast<IdentifierNode>(node)) {
+        return identifier->getResolved().kind == RESOLVED::NAME ? identifier->getResolved().index : -1;
+    }
+    if (ChemicalNode* chemical = nodeCast<ChemicalNode>(node)) {
+        return chemical->getResolved().kind == RESOLVED::NAME ? chemical->getResolved().index : -1;
+    }
+    return -1;
+}
+
+static std::string speciesName(ASTNode* node) {
+    node->assertNodeType({ NODE::IDENTIFIER_NODE, NODE::CHEMICAL_NODE }, "Expected a molecule name, ie. A or H_{2}O.");
+    if (IdentifierNode* identifier = nodeCast<IdentifierNode>(node)) {
+        return identifier->getName();
+    }
+    return nodeCast<ChemicalNode>(node)->getFormula();
+}
+
+Molecule* Compartment::findOrAddMolecule(ASTNode* speciesNode) {
+    int nameId = nameIdOf(speciesNode);
+    if (nameId >= 0 && nameId < (int) moleculeByNameId.size()) {
+        if (Molecule** molecule = molecules.find(moleculeByNameId[nameId])) {
+            return *molecule;
+        }
+    }
+
+    // first time this compartment sees the name (or the node is unresolved)
+    std::string moleculeName = speciesName(speciesNode);
+    Molecule* molecule = nullptr;
+    if (this->hasMolecule(moleculeName)) {
+        molecule = this->getMolecule(moleculeName);
+    } else {
+        molecule = this->addNamedMolecule(moleculeName);
+    }
+    if (nameId >= 0) {
+        if (nameId >= (int) moleculeByNameId.size()) {
+            moleculeByNameId.resize(nameId + 1);
+        }
+        moleculeByNameId[nameId] = moleculeNameToHandle.at(molecule->getName());
+    }
+    return molecule;
+}
+
+// Splits an element name, "R[3]", into "R" and 3. False for any other name.
+static bool splitElementName(const std::string& name, std::string* base, long* index) {
+    size_t open = name.rfind('[');
+    if (open == std::string::npos || open == 0 || name.back() != ']') {
+        return false;
+    }
+    const char* digits = name.c_str() + open + 1;
+    char* end = nullptr;
+    *index = std::strtol(digits, &end, 10);
+    if (end == digits || *end != ']') {
+        return false;
+    }
+    *base = name.substr(0, open);
+    return true;
+}
+
+static std::string elementName(const std::string& base, long index) {
+    return base + "[" + std::to_string(index) + "]";
+}
+
+Molecule* Compartment::addNamedMolecule(const std::string& moleculeName) {
+    if (speciesArrays.count(moleculeName) > 0) {
+        error("Species array " + moleculeName + " must be indexed, ie. " + elementName(moleculeName, 0) + ".");
+    }
+    Molecule* molecule = new Molecule(this, moleculeName, molecules.size());
+    this->addMolecule(molecule);
+
+    std::string base;
+    long index;
+    if (splitElementName(moleculeName, &base, &index) && speciesArrays.count(base) > 0) {
+        const std::vector<SpeciesRange>& ranges = speciesArrays.at(base);
+        // the latest range declared for the element decides its initial count
+        auto range = std::find_if(ranges.rbegin(), ranges.rend(), [index](const SpeciesRange& range) {
+            return range.contains(index);
+        });
+        if (range == ranges.rend()) {
+            error("Element " + moleculeName + " is outside of every range declared for species array " + base + ".");
+        }
+        if (range->initialCount.has_value()) {
+            molecule->setInitialCount(range->initialCount.value());
+        }
+        arrayElements[base][index] = moleculeNameToHandle.at(moleculeName);
+    }
+    return molecule;
+}
+
+void Compartment::declareSpeciesArray(const std::string& base, long first, long last, std::optional<double> initialCount) {
+    if (first > last) {
+        error("Species array " + base + "[" + std::to_string(first) + ".." + std::to_string(last) + "] has an empty range.");
+    }
+    if (this->hasMolecule(base)) {
+        error("Molecule " + base + " cannot also be declared as a species array.");
+    }
+    std::map<long, SlotHandle>& elements = arrayElements[base];
+    if (speciesArrays.count(base) == 0) {
+        // elements used before the first declaration were added as plain molecules
+        for (const auto& [moleculeName, handle] : moleculeNameToHandle) {
+            std::string elementBase;
+            long index;
+            if (splitElementName(moleculeName, &elementBase, &index) && elementBase == base) {
+                elements[index] = handle;
+            }
+        }
+    }
+    speciesArrays[base].push_back({ first, last, initialCount });
+
+    if (initialCount.has_value()) {
+        for (auto element = elements.lower_bound(first); element != elements.end() && element->first <= last; ++element) {
+            if (Molecule** molecule = molecules.find(element->second)) {
+                (*molecule)->setInitialCount(initialCount.value());
+            }
+        }
+    }
+}
+
+bool Compartment::hasSpeciesArray(const std::string& base) const {
+    return speciesArrays.count(base) > 0;
+}
+
+const std::unordered_map<std::string, std::vector<SpeciesRange>>& Compartment::getSpeciesArrays() const {
+    return speciesArrays;
+}
+
+// Time index of a molecule assignment, ie. the [2] of A[2] = 5 or the [1 : 4] of A[1 : 4] = 5.
+static void processTimeIndex(Molecule* molecule, ASTNode* timeIndex, double value) {
+    switch (timeIndex->getNodeType()) {
+        case NODE::NUMBER_NODE: {
+            NumberNode* timeNode = nodeCast<NumberNode>(timeIndex);
+            double time = timeNode->getSIValue();
+            FixedCountHandler::getFixedCountHandler(molecule)->addChangePoint(time, value);
+            break;
+        }
+        case NODE::SYMBOL_NODE: {
+            SymbolNode* colon = nodeCast<SymbolNode>(timeIndex);
+            colon->assertSymbol(SYMBOL::COLON, "Index node has SYMBOL right child, but it's symbol is not a COLON.");
+
+            double startTime, endTime;
+            if (colon->getLeft()->getNodeType() == NODE::NUMBER_NODE) {
+                NumberNode* startTimeNode = nodeCast<NumberNode>(colon->getLeft());
+                startTime = startTimeNode->getSIValue();
+            } else {
+                colon->getLeft()->assertNodeType(NODE::AST_NODE, "Colon node has left child other than AST_NODE or NUMBER_NODE."); // needs to change to evaluate numerical expressions
+                startTime = 0;
+            }
+            if (colon->getRight()->getNodeType() == NODE::NUMBER_NODE) {
+                NumberNode* endTimeNode = nodeCast<NumberNode>(colon->getRight());
+                endTime = endTimeNode->getSIValue();
+            } else {
+                colon->getRight()->assertNodeType(NODE::AST_NODE, "Colon node has right child other than AST_NODE or NUMBER_NODE."); // needs to change to evaluate numerical expressions
+                endTime = std::numeric_limits<double>::infinity();
+            }
+
+            FixedCountHandler::getFixedCountHandler(molecule)->addInterval(value, startTime, endTime);
+            break;
+        }
+        default:
+            error("Index node with right child other than NUMBER or SYMBOL type.");
+    }
+}
+
+// Element index of a species array, which must be a whole number without a unit.
+static long arrayIndex(ASTNode* indexNode, const std::string& base) {
+    indexNode->assertNodeType(NODE::NUMBER_NODE, [&] { return "Index of species array " + base + " must be a number."; });
+    NumberNode* number = nodeCast<NumberNode>(indexNode);
+    if (number->getUnit() != UNIT::NO_UNIT || std::floor(number->getNum()) != number->getNum()) {
+        error("Index of species array " + base + " on line " + std::to_string(indexNode->getLine()) + " must be a whole number.");
+    }
+    return static_cast<long>(number->getNum());
+}
+
+/* Assignments to species arrays:
+ *      R[0..999] = 10;     declares R[0] ... R[999], each with initial count 10
+ *      R[3] = 5;           initial count of one element
+ *      R[3][2 s] = 5;      time index of one element, as for any other molecule
+ * */
+void Compartment::processArrayAssignment(IndexNode* indexNode, double value) {
+    SymbolNode* range = nodeCast<SymbolNode>(indexNode->getRight());
+    if (range != nullptr && range->getSymbol() == SYMBOL::RANGE) {
+        indexNode->getLeft()->assertNodeType({NODE::IDENTIFIER_NODE, NODE::CHEMICAL_NODE}, "Only a species name can be declared as a species array.");
+        std::string base = speciesName(indexNode->getLeft());
+        this->declareSpeciesArray(base, arrayIndex(range->getLeft(), base), arrayIndex(range->getRight(), base), value);
+        return;
+    }
+
+    IndexNode* element = indexNode;
+    ASTNode* timeIndex = nullptr;
+    if (IndexNode* inner = nodeCast<IndexNode>(indexNode->getLeft())) {
+        element = inner;
+        timeIndex = indexNode->getRight();
+    }
+    element->getLeft()->assertNodeType({NODE::IDENTIFIER_NODE, NODE::CHEMICAL_NODE}, "Species arrays have a single index.");
+    std::string base = speciesName(element->getLeft());
+    if (!this->hasSpeciesArray(base)) {
+        error(base + " is indexed twice on line " + std::to_string(element->getLeft()->getLine()) + ", but is not a species array.");
+    }
+    std::string name = elementName(base, arrayIndex(element->getRight(), base));
+    Molecule* molecule = this->hasMolecule(name) ? this->getMolecule(name) : this->addNamedMolecule(name);
+    if (timeIndex != nullptr) {
+        processTimeIndex(molecule, timeIndex, value);
+    } else {
+        molecule->setInitialCount(value);
+    }
 }
 
 // See wiki/Compiler Context/Interface Notes/processMoleculeAssignments() Well-Formed Inputs/ for information what inputs we expect.
@@ -728,123 +979,145 @@ void Compartment::addMolecule(Molecule* molecule) {
 void Compartment::processMoleculeAssignment(SymbolNode* assignmentNode) {
     assignmentNode->assertSymbol(SYMBOL::ASSIGNMENT, "Symbol node other than ASSIGNMENT type passed to processMoleculeAssignment.");
     assignmentNode->getRight()->assertNodeType(NODE::NUMBER_NODE, "Only number nodes supported for molecule assignments at present.");
-    NumberNode* valueNode = dynamic_cast<NumberNode*>(assignmentNode->getRight());
+    NumberNode* valueNode = nodeCast<NumberNode>(assignmentNode->getRight());
     double value = valueNode->getSIValue();
 
     switch (assignmentNode->getLeft()->getNodeType()) {
         case NODE::IDENTIFIER_NODE:
         case NODE::CHEMICAL_NODE: {
-            std::string moleculeName;
-            if (assignmentNode->getLeft()->getNodeType() == NODE::IDENTIFIER_NODE) {
-                IdentifierNode* moleculeIdentifier = dynamic_cast<IdentifierNode*>(assignmentNode->getLeft());
-                moleculeName = moleculeIdentifier->getName();
-            } else {
-                // chemical node
-                ChemicalNode* chemicalNode = dynamic_cast<ChemicalNode*>(assignmentNode->getLeft());
-                moleculeName = chemicalNode->getFormula();
-            }
-
-            if (this->hasMolecule(moleculeName)) {
-                Molecule* molecule = this->getMolecule(moleculeName);
-                molecule->setInitialCount(value);
-            } else {
-                Molecule* molecule = new Molecule(this, moleculeName, molecules.size(), value);
-                this->addMolecule(molecule);
-            }
+            Molecule* molecule = this->findOrAddMolecule(assignmentNode->getLeft());
+            molecule->setInitialCount(value);
+            const std::string& moleculeName = molecule->getName();
             // TODO: wrap behind compiler flags
             std::cout << "Warning: assignment of molecule " << moleculeName << " implicitly refers to initial count. Consider making explicit with " << moleculeName << "[0], or using " << moleculeName << "[:] if molecule is meant to be kept constant." << std::endl;
             break;
         }
         case NODE::INDEX_NODE: {
-            IndexNode* indexNode = dynamic_cast<IndexNode*>(assignmentNode->getLeft());
-
-            std::string moleculeName;
-            if (indexNode->getLeft()->getNodeType() == NODE::IDENTIFIER_NODE) {
-                IdentifierNode* moleculeIdentifier = dynamic_cast<IdentifierNode*>(indexNode->getLeft());
-                moleculeName = moleculeIdentifier->getName();
-            } else {
-                // chemical node
-                ChemicalNode* chemicalNode = dynamic_cast<ChemicalNode*>(indexNode->getLeft());
-                moleculeName = chemicalNode->getFormula();
-            }
-
-            Molecule* molecule = nullptr;
-            if (this->hasMolecule(moleculeName)) {
-                molecule = this->getMolecule(moleculeName);
-            } else {
-                molecule = new Molecule(this, moleculeName, molecules.size());
-                this->addMolecule(molecule);
-            }
-
-            switch (indexNode->getRight()->getNodeType()) {
-                case NODE::NUMBER_NODE: {
-                    NumberNode* timeNode = dynamic_cast<NumberNode*>(indexNode->getRight());
-                    double time = timeNode->getSIValue();
-                    FixedCountHandler::getFixedCountHandler(molecule)->addChangePoint(time, value);
-                    break;
-                }
-                case NODE::SYMBOL_NODE: {
-                    SymbolNode* colon = dynamic_cast<SymbolNode*>(indexNode->getRight());
-                    colon->assertSymbol(SYMBOL::COLON, "Index node has SYMBOL right child, but it's symbol is not a COLON.");
-
-                    double startTime, endTime;
-                    if (colon->getLeft()->getNodeType() == NODE::NUMBER_NODE) {
-                        NumberNode* startTimeNode = dynamic_cast<NumberNode*>(colon->getLeft());
-                        startTime = startTimeNode->getSIValue();
-                    } else {
-                        colon->getLeft()->assertNodeType(NODE::AST_NODE, "Colon node has left child other than AST_NODE or NUMBER_NODE."); // needs to change to evaluate numerical expressions
-                        startTime = 0;
-                    }
-                    if (colon->getRight()->getNodeType() == NODE::NUMBER_NODE) {
-                        NumberNode* endTimeNode = dynamic_cast<NumberNode*>(colon->getRight());
-                        endTime = endTimeNode->getSIValue();
-                    } else {
-                        colon->getRight()->assertNodeType(NODE::AST_NODE, "Colon node has right child other than AST_NODE or NUMBER_NODE."); // needs to change to evaluate numerical expressions
-                        endTime = std::numeric_limits<double>::infinity();
-                    }
-
-                    FixedCountHandler::getFixedCountHandler(molecule)->addInterval(value, startTime, endTime);
-                    break;
-                }
-                default:
-                    error("Index node with right child other than NUMBER or SYMBOL type.");
+            IndexNode* indexNode = nodeCast<IndexNode>(assignmentNode->getLeft());
+            SymbolNode* range = nodeCast<SymbolNode>(indexNode->getRight());
+            bool isArray = (range != nullptr && range->getSymbol() == SYMBOL::RANGE) ||
+                           indexNode->getLeft()->getNodeType() == NODE::INDEX_NODE ||
+                           this->hasSpeciesArray(speciesName(indexNode->getLeft()));
+            if (isArray) {
+                this->processArrayAssignment(indexNode, value);
+                break;
             }
+            Molecule* molecule = this->findOrAddMolecule(indexNode->getLeft());
+            processTimeIndex(molecule, indexNode->getRight(), value);
+            break;
+        }
+        case NODE::KEYWORD_NODE: {
+            // initial count of a complex species, ie. EGFR(lig, Y1:off) = 50
+            KeywordNode* patternNode = nodeCast<KeywordNode>(assignmentNode->getLeft());
+            patternNode->assertKeyword(KEYWORD::COMPLEX, "processMoleculeAssignment ASSIGNMENT node has KEYWORD left child other than COMPLEX.");
+            const std::string& pattern = nodeCast<IdentifierNode>(patternNode->getLeft())->getName();
+            int species = rules.addSpecies(rules.parseSpecies(pattern));
+            Molecule* molecule = this->reachSpecies(species);
+            molecule->setInitialCount(value);
             break;
         }
         default:
-            error("processMoleculeAssignment ASSIGNMENT node has left child other than IDENTIFIER, CHEMICAL or INDEX.");
+            error("processMoleculeAssignment ASSIGNMENT node has left child other than IDENTIFIER, CHEMICAL, INDEX or COMPLEX.");
 
     }
 
 }
 
 const std::vector<Reaction*>& Compartment::getReactions() const {
-    return reactions;
+    return reactions.values();
 }
 
 bool Compartment::hasReaction(const std::string& nameToSearch) const {
-    return reactionNameToIndex.count(nameToSearch) > 0;
+    return reactionNameToHandle.count(nameToSearch) > 0;
 }
 
 Reaction* Compartment::getReaction(const std::string& nameToFind) const {
-    return reactions[reactionNameToIndex.at(nameToFind)];
+    return reactions.get(reactionNameToHandle.at(nameToFind));
 }
 
-void Compartment::addReaction(Reaction* reaction) {
-    reactions.push_back(reaction);
-    reactionNameToIndex[reaction->getName()] = reactions.size() - 1;
+Reaction* Compartment::findReaction(IdentifierNode* reactionNode) const {
+    int nameId = nameIdOf(reactionNode);
+    if (nameId >= 0 && nameId < (int) reactionByNameId.size()) {
+        if (Reaction* const* reaction = reactions.find(reactionByNameId[nameId])) {
+            return *reaction;
+        }
+    }
+    // only reactions added without a name ID need a lookup by name
+    if ((nameId < 0 || unboundReactions > 0) && this->hasReaction(reactionNode->getName())) {
+        return this->getReaction(reactionNode->getName());
+    }
+    return nullptr;
+}
+
+void Compartment::addReaction(Reaction* reaction, int nameId) {
+    SlotHandle handle = reactions.insert(reaction);
+    reactionNameToHandle[reaction->getName()] = handle;
+    if (handle.slot >= reactionSlotNameIds.size()) {
+        reactionSlotNameIds.resize(handle.slot + 1, -1);
+    }
+    reactionSlotNameIds[handle.slot] = nameId;
+    if (nameId >= 0) {
+        if (nameId >= (int) reactionByNameId.size()) {
+            reactionByNameId.resize(nameId + 1);
+        }
+        reactionByNameId[nameId] = handle;
+    } else {
+        unboundReactions++;
+    }
 }
 
+// The handle of a removed reaction goes stale, so reactionByNameId needs no cleanup.
 void Compartment::removeReaction(Reaction* reaction) {
-    int index = reactionNameToIndex[reaction->getName()];
-    reactions.erase(reactions.begin() + index);
-    reactionNameToIndex.erase(reaction->getName());
-    for (int i = index; i < reactions.size(); i++) {
-        reactionNameToIndex[reactions[i]->getName()]--;
+    SlotHandle handle = reactionNameToHandle.at(reaction->getName());
+    if (reactionSlotNameIds[handle.slot] < 0) {
+        unboundReactions--;
     }
+    reactionNameToHandle.erase(reaction->getName());
+    reactions.remove(handle);
+}
+
+void Compartment::replaceReaction(Reaction* oldReaction, Reaction* newReaction) {
+    SlotHandle handle = reactionNameToHandle.at(oldReaction->getName());
+    reactionNameToHandle.erase(oldReaction->getName());
+    reactionNameToHandle[newReaction->getName()] = handle;
+    reactions.replace(handle, newReaction);
 }
 
 
+static bool isComplexPattern(ASTNode* node) {
+    KeywordNode* keyword = nodeCast<KeywordNode>(node);
+    return keyword != nullptr && keyword->getKeyword() == KEYWORD::COMPLEX;
+}
+
+static bool hasComplexPattern(ASTNode* side) {
+    if (SpeciesListNode* speciesList = nodeCast<SpeciesListNode>(side)) {
+        for (size_t i = 0; i < speciesList->size(); i++) {
+            if (isComplexPattern(speciesList->getSpecies(i))) {
+                return true;
+            }
+        }
+        return false;
+    }
+    return isComplexPattern(side);
+}
+
+// true if the equation of the reaction is written over complex patterns
+static bool isRule(KeywordNode* reactionNode) {
+    for (ASTNode* parameter = reactionNode->getRight(); parameter->getNodeType() == NODE::SYMBOL_NODE;
+         parameter = parameter->getNextStatement()) {
+        SymbolNode* assignment = nodeCast<SymbolNode>(parameter);
+        ParamNode* param = nodeCast<ParamNode>(assignment->getLeft());
+        SymbolNode* arrow = nodeCast<SymbolNode>(assignment->getRight());
+        if (param != nullptr && param->getParamType() == PARAM::EQUATION && arrow != nullptr) {
+            return hasComplexPattern(arrow->getLeft()) || hasComplexPattern(arrow->getRight());
+        }
+        if (!parameter->hasNextStatement) {
+            break;
+        }
+    }
+    return false;
+}
+
 /*
  *             INPUT ---->       reactionNode
  *                           /                  \        next statement              next statement
@@ -855,33 +1128,41 @@ void Compartment::removeReaction(Reaction* reaction) {
  *                                   identifier   expression      identifier   expression
  *
  */
-void Compartment::processReaction(KeywordNode* reactionNode, bool isInProtein, const std::string& proteinName) {
-    reactionNode->assertKeyword(KEYWORD::REACTION, "KeywordNode other than REACTION type passed to processReaction (type passed: " + keywordTypeToText[reactionNode->getKeyword()] + ").");
+void Compartment::processReaction(KeywordNode* reactionNode, bool isInProtein, ASTNode* proteinNameNode) {
+    reactionNode->assertKeyword(KEYWORD::REACTION, [&] { return std::string("KeywordNode other than REACTION type passed to processReaction (type passed: ") + keywordToText(reactionNode->getKeyword()) + ")."; });
 
     reactionNode->getLeft()->assertNodeType(NODE::IDENTIFIER_NODE, "Reaction node with left child other than IDENTIFIER type passed to processReaction.");
-    IdentifierNode* reactionIdentifierNode = dynamic_cast<IdentifierNode*>(reactionNode->getLeft());
+    IdentifierNode* reactionIdentifierNode = nodeCast<IdentifierNode>(reactionNode->getLeft());
     std::string reactionName = reactionIdentifierNode->getName();
 
+    if (isRule(reactionNode)) {
+        if (isInProtein) {
+            error("Reaction " + reactionName + " over complexes cannot be declared in a protein.");
+        }
+        this->processRule(reactionNode);
+        return;
+    }
+
     ASTNode* parameterAssignmentNode = reactionNode->getRight();
 
     Reaction* reaction = new Reaction(this, reactionName);
 
-    parameterAssignmentNode->assertNodeType(NODE::AST_NODE, "Syntax error: reaction " + reactionName + " has no parameters.", true);
+    parameterAssignmentNode->assertNodeType(NODE::AST_NODE, [&] { return "Syntax error: reaction " + reactionName + " has no parameters."; }, true);
 
     while (true) {
         parameterAssignmentNode->assertNodeType(NODE::SYMBOL_NODE, "Reaction node with parameter node other than SYMBOL type passed to processReaction.");
-        SymbolNode* parameterAssignment = dynamic_cast<SymbolNode*>(parameterAssignmentNode);
+        SymbolNode* parameterAssignment = nodeCast<SymbolNode>(parameterAssignmentNode);
         parameterAssignment->assertSymbol(SYMBOL::ASSIGNMENT, "Reaction node with parameter symbol node other than ASSIGNMENT type passed to processReaction.");
 
         parameterAssignment->getLeft()->assertNodeType(NODE::PARAM_NODE, "Parameter assignment node with left child other than PARAM type passed to processReaction.");
-        ParamNode* parameterIdentifierNode = dynamic_cast<ParamNode*>(parameterAssignment->getLeft());
+        ParamNode* parameterIdentifierNode = nodeCast<ParamNode>(parameterAssignment->getLeft());
 
         if (parameterIdentifierNode->getParamType() == PARAM::EQUATION) {
             if (reaction->hasParameter(PARAM::EQUATION)) {
                 error("Reaction " + reactionName + " has equation defined more than once.");
             }
             parameterAssignment->getRight()->assertNodeType(NODE::SYMBOL_NODE, "Reaction eq parameter assignment does not have symbol node right child.");
-            SymbolNode* rightArrowOrInhibition = dynamic_cast<SymbolNode*>(parameterAssignment->getRight());
+            SymbolNode* rightArrowOrInhibition = nodeCast<SymbolNode>(parameterAssignment->getRight());
             switch (rightArrowOrInhibition->getSymbol()) {
                 case SYMBOL::FORWARD: {
                     // --> = normal reaction or activation
@@ -906,14 +1187,14 @@ void Compartment::processReaction(KeywordNode* reactionNode, bool isInProtein, c
         } else {
             PARAM parameter = parameterIdentifierNode->getParamType();
 
-            if (validReactionParameters.count(parameter) == 0) {
-                error("Reaction " + reactionName + " has invalid parameter " + paramTypeToText[parameter] + ".");
+            if ((paramBit(parameter) & REACTION_PARAMETERS) == 0) {
+                error("Reaction " + reactionName + " has invalid parameter " + paramToText(parameter) + ".");
             } else if (reaction->hasParameter(parameter)) {
-                error("Reaction " + reactionName + " has parameter " + paramTypeToText[parameter] + " defined more than once.");
+                error("Reaction " + reactionName + " has parameter " + paramToText(parameter) + " defined more than once.");
             }
 
             parameterAssignment->getRight()->assertNodeType(NODE::NUMBER_NODE, "Only number nodes supported for reaction parameter values at present.");
-            NumberNode* numberNode = dynamic_cast<NumberNode*>(parameterAssignment->getRight());
+            NumberNode* numberNode = nodeCast<NumberNode>(parameterAssignment->getRight());
             double value = numberNode->getSIValue();
             reaction->addParameter(parameter, value);
         }
@@ -924,190 +1205,54 @@ void Compartment::processReaction(KeywordNode* reactionNode, bool isInProtein, c
         }
     }
 
-    // TODO: more detailed errors when reaction type inference fails
     if (!isInProtein) {
-        for (REACTION_TYPE possibleType : {REACTION_TYPE::SU}) {
-            if (reaction->canHaveType(possibleType)) {
-                reaction->setType(possibleType);
-                break;
-            }
-        }
-        if (reaction->getType() == REACTION_TYPE::NOT_YET_DETERMINED) {
-            error("Reaction type of reaction " + reaction->getName() + " cannot be determined. It likely has not enough or conflicting parameters.");
-        }
+        reaction->inferType({REACTION_TYPE::SU}, reaction->getName());
     } else {
-        if (this->hasMolecule(proteinName)) {
-            Molecule* protein = this->getMolecule(proteinName);
-            reaction->setProtein(protein);
-        } else {
-            Molecule* protein = new Molecule(this, proteinName, molecules.size());
-            this->addMolecule(protein);
-            reaction->setProtein(protein);
-        }
-        for (REACTION_TYPE possibleType : {REACTION_TYPE::ESU, REACTION_TYPE::MMU}) {
-            if (reaction->canHaveType(possibleType)) {
-                reaction->setType(possibleType);
-                break;
-            }
-        }
-        if (reaction->getType() == REACTION_TYPE::NOT_YET_DETERMINED) {
-            error("Reaction type of reaction " + reaction->getName() + " cannot be determined. It likely has not enough or conflicting parameters.");
-        }
+        reaction->setProtein(this->findOrAddMolecule(proteinNameNode));
+        reaction->inferType({REACTION_TYPE::ESU, REACTION_TYPE::MMU}, reaction->getName());
     }
 
-    this->addReaction(reaction);
+    this->addReaction(reaction, nameIdOf(reactionIdentifierNode));
     std::cout << "Added reaction " << reaction->getName() << " to compartment " << this->getName() << std::endl;
 }
 
 void Compartment::processReactants(ASTNode* equationLHS, Reaction* reaction) {
     // TODO: check that identifiers make sense (i.e. dont refer to random other stuff)
     switch (equationLHS->getNodeType()) {
-        case NODE::IDENTIFIER_NODE: {
-            IdentifierNode* identifierNode = dynamic_cast<IdentifierNode*>(equationLHS);
-            std::string moleculeName = identifierNode->getName();
-            if (this->hasMolecule(moleculeName)) {
-                Molecule* molecule = this->getMolecule(moleculeName);
-                reaction->addReactant(molecule, -1);
-            } else {
-                Molecule* molecule = new Molecule(this, moleculeName, molecules.size());
-                this->addMolecule(molecule);
-                reaction->addReactant(molecule, -1);
-            }
-            break;
-        }
+        case NODE::IDENTIFIER_NODE:
         case NODE::CHEMICAL_NODE: {
-            ChemicalNode* chemicalNode = dynamic_cast<ChemicalNode*>(equationLHS);
-            std::string moleculeName = chemicalNode->getFormula();
-            if (this->hasMolecule(moleculeName)) {
-                Molecule* molecule = this->getMolecule(moleculeName);
-                reaction->addReactant(molecule, -1);
-            } else {
-                Molecule* molecule = new Molecule(this, moleculeName, molecules.size());
-                this->addMolecule(molecule);
-                reaction->addReactant(molecule, -1);
-            }
+            reaction->addReactant(this->findOrAddMolecule(equationLHS), -1);
             break;
         }
-        case NODE::SYMBOL_NODE: {
-            SymbolNode* symbolNode = dynamic_cast<SymbolNode*>(equationLHS);
-            switch (symbolNode->getSymbol()) {
-                case SYMBOL::ADD: {
-                    this->processReactants(symbolNode->getLeft(), reaction);
-                    this->processReactants(symbolNode->getRight(), reaction);
-                    break;
-                }
-                case SYMBOL::MULTIPLY: {
-                    symbolNode->getLeft()->assertNodeType(NODE::NUMBER_NODE, "LHS of reaction " + reaction->getName() + " has multiplication node with left child other than NUMBER type.");
-                    symbolNode->getRight()->assertNodeType({NODE::IDENTIFIER_NODE, NODE::CHEMICAL_NODE}, "LHS of reaction " + reaction->getName() + " has multiplication node with right child other than IDENTIFIER or CHEMICAL type.");
-
-                    NumberNode* coefficientNode = dynamic_cast<NumberNode*>(symbolNode->getLeft());
-
-                    std::string moleculeName;
-                    if (symbolNode->getRight()->getNodeType() == NODE::IDENTIFIER_NODE) {
-                        IdentifierNode* right = dynamic_cast<IdentifierNode*>(symbolNode->getRight());
-                        moleculeName = right->getName();
-                    } else {
-                        // Chemical node
-                        ChemicalNode* right = dynamic_cast<ChemicalNode*>(symbolNode->getRight());
-                        moleculeName = right->getFormula();
-                    }
-
-                    int stoichiometricCoefficient = -1 * (int)std::round(coefficientNode->getNum());
-
-                    if (this->hasMolecule(moleculeName)) {
-                        Molecule* molecule = this->getMolecule(moleculeName);
-                        reaction->addReactant(molecule, stoichiometricCoefficient);
-                    } else {
-                        Molecule* molecule = new Molecule(this, moleculeName, molecules.size());
-                        this->addMolecule(molecule);
-                        reaction->addReactant(molecule, stoichiometricCoefficient);
-                    }
-                    break;
-                }
-                default: {
-                    error("LHS of reaction " + reaction->getName() + " has symbol other than + or *");
-                }
+        case NODE::SPECIES_LIST_NODE: {
+            SpeciesListNode* speciesList = nodeCast<SpeciesListNode>(equationLHS);
+            for (size_t i = 0; i < speciesList->size(); i++) {
+                reaction->addReactant(this->findOrAddMolecule(speciesList->getSpecies(i)), -1 * speciesList->getCoefficient(i));
             }
             break;
         }
         default: {
-            error("LHS of reaction " + reaction->getName() + " has node other than IDENTIFIER, CHEMICAL or SYMBOL.");
+            error("LHS of reaction " + reaction->getName() + " is not a sum of IDENTIFIER or CHEMICAL species with optional coefficients.");
         }
     }
 }
 
 void Compartment::processProducts(ASTNode* equationRHS, Reaction* reaction) {
     switch (equationRHS->getNodeType()) {
-        case NODE::IDENTIFIER_NODE: {
-            IdentifierNode* identifierNode = dynamic_cast<IdentifierNode*>(equationRHS);
-            std::string moleculeName = identifierNode->getName();
-            if (this->hasMolecule(moleculeName)) {
-                Molecule* molecule = this->getMolecule(moleculeName);
-                reaction->addProduct(molecule, 1);
-            } else {
-                Molecule* molecule = new Molecule(this, moleculeName, molecules.size());
-                this->addMolecule(molecule);
-                reaction->addProduct(molecule, 1);
-            }
-            break;
-        }
+        case NODE::IDENTIFIER_NODE:
         case NODE::CHEMICAL_NODE: {
-            ChemicalNode* chemicalNode = dynamic_cast<ChemicalNode*>(equationRHS);
-            std::string moleculeName = chemicalNode->getFormula();
-            if (this->hasMolecule(moleculeName)) {
-                Molecule* molecule = this->getMolecule(moleculeName);
-                reaction->addProduct(molecule, 1);
-            } else {
-                Molecule* molecule = new Molecule(this, moleculeName, molecules.size());
-                this->addMolecule(molecule);
-                reaction->addProduct(molecule, 1);
-            }
+            reaction->addProduct(this->findOrAddMolecule(equationRHS), 1);
             break;
         }
-        case NODE::SYMBOL_NODE: {
-            SymbolNode* symbolNode = dynamic_cast<SymbolNode*>(equationRHS);
-            switch (symbolNode->getSymbol()) {
-                case SYMBOL::ADD: {
-                    this->processProducts(symbolNode->getLeft(), reaction);
-                    this->processProducts(symbolNode->getRight(), reaction);
-                    break;
-                }
-                case SYMBOL::MULTIPLY: {
-                    symbolNode->getLeft()->assertNodeType(NODE::NUMBER_NODE, "RHS of reaction " + reaction->getName() + " has multiplication node with left child other than NUMBER type.");
-                    symbolNode->getRight()->assertNodeType({NODE::IDENTIFIER_NODE, NODE::CHEMICAL_NODE}, "RHS of reaction " + reaction->getName() + " has multiplication node with right child other than IDENTIFIER or CHEMICAL type.");
-
-                    NumberNode* coefficientNode = dynamic_cast<NumberNode*>(symbolNode->getLeft());
-
-                    std::string moleculeName;
-                    if (symbolNode->getRight()->getNodeType() == NODE::IDENTIFIER_NODE) {
-                        IdentifierNode* right = dynamic_cast<IdentifierNode*>(symbolNode->getRight());
-                        moleculeName = right->getName();
-                    } else {
-                        // Chemical node
-                        ChemicalNode* right = dynamic_cast<ChemicalNode*>(symbolNode->getRight());
-                        moleculeName = right->getFormula();
-                    }
-
-                    int stoichiometricCoefficient = (int)std::round(coefficientNode->getNum());
-
-                    if (this->hasMolecule(moleculeName)) {
-                        Molecule* molecule = this->getMolecule(moleculeName);
-                        reaction->addProduct(molecule, stoichiometricCoefficient);
-                    } else {
-                        Molecule* molecule = new Molecule(this, moleculeName, molecules.size());
-                        this->addMolecule(molecule);
-                        reaction->addProduct(molecule, stoichiometricCoefficient);
-                    }
-                    break;
-                }
-                default: {
-                    error("RHS of reaction " + reaction->getName() + " has symbol other than + or *");
-                }
+        case NODE::SPECIES_LIST_NODE: {
+            SpeciesListNode* speciesList = nodeCast<SpeciesListNode>(equationRHS);
+            for (size_t i = 0; i < speciesList->size(); i++) {
+                reaction->addProduct(this->findOrAddMolecule(speciesList->getSpecies(i)), speciesList->getCoefficient(i));
             }
             break;
         }
         default: {
-            error("RHS of reaction " + reaction->getName() + " has node other than IDENTIFIER, CHEMICAL or SYMBOL.");
+            error("RHS of reaction " + reaction->getName() + " is not a sum of IDENTIFIER or CHEMICAL species with optional coefficients.");
         }
     }
 }
@@ -1118,50 +1263,28 @@ bool Compartment::checkForActivation(SymbolNode* rightArrowNode) const {
     } else if (rightArrowNode->getRight()->getNodeType() != NODE::IDENTIFIER_NODE) {
         return false;
     } else {
-        IdentifierNode* rightIdentifier = dynamic_cast<IdentifierNode*>(rightArrowNode->getRight());
+        IdentifierNode* rightIdentifier = nodeCast<IdentifierNode>(rightArrowNode->getRight());
         // TODO: check left identifiers make sense
-        if (this->hasReaction(rightIdentifier->getName())) {
-            return true;
-        } else {
-            return false;
-        }
+        return this->findReaction(rightIdentifier) != nullptr;
     }
 }
 
 // inProgressReaction is the reaction we were building before we discovered it was an activation reaction.
 void Compartment::processActivation(const std::string& activationReactionName, Reaction* inProgressReaction, SymbolNode* equationAssignmentNode) {
-    SymbolNode* rightArrowNode = dynamic_cast<SymbolNode*>(equationAssignmentNode->getRight());
+    SymbolNode* rightArrowNode = nodeCast<SymbolNode>(equationAssignmentNode->getRight());
 
-    IdentifierNode* rightIdentifier = dynamic_cast<IdentifierNode*>(rightArrowNode->getRight());
+    IdentifierNode* rightIdentifier = nodeCast<IdentifierNode>(rightArrowNode->getRight());
 
-    std::string activatedReactionName = rightIdentifier->getName();
-    Reaction* oldReaction = this->getReaction(activatedReactionName);
-    // remove old reaction, which was not of activated type
-    this->removeReaction(oldReaction);
+    Reaction* oldReaction = this->findReaction(rightIdentifier);
 
-    std::string activatorName;
-    if (rightArrowNode->getLeft()->getNodeType() == NODE::IDENTIFIER_NODE) {
-        IdentifierNode* left = dynamic_cast<IdentifierNode*>(rightArrowNode->getLeft());
-        activatorName = left->getName();
-    } else {
-        // Chemical node
-        ChemicalNode* left = dynamic_cast<ChemicalNode*>(rightArrowNode->getLeft());
-        activatorName = left->getFormula();
-    }
-
-    Molecule* activator = nullptr;
-    if (this->hasMolecule(activatorName)) {
-        activator = this->getMolecule(activatorName);
-    } else {
-        Molecule* molecule = new Molecule(this, activatorName, molecules.size());
-        this->addMolecule(molecule);
-        activator = molecule;
-    }
+    Molecule* activator = this->findOrAddMolecule(rightArrowNode->getLeft());
 
     Activation* newReaction = new Activation(oldReaction, activationReactionName, activator);
     for (auto& [parameter, value] : inProgressReaction->getParameters()) {
         newReaction->addActivationParameter(parameter, value);
     }
+    // the old reaction, which was not of activated type, leaves its place to the new one
+    this->replaceReaction(oldReaction, newReaction);
     delete oldReaction;
     delete inProgressReaction;
 
@@ -1170,27 +1293,27 @@ void Compartment::processActivation(const std::string& activationReactionName, R
         ASTNode* parameterAssignmentNode = equationAssignmentNode->getNextStatement();
         while (true) {
             parameterAssignmentNode->assertNodeType(NODE::SYMBOL_NODE, "Reaction node with parameter node other than SYMBOL type passed to processActivation.");
-            SymbolNode* parameterAssignment = dynamic_cast<SymbolNode*>(parameterAssignmentNode);
+            SymbolNode* parameterAssignment = nodeCast<SymbolNode>(parameterAssignmentNode);
             parameterAssignment->assertSymbol(SYMBOL::ASSIGNMENT, "Reaction node with parameter symbol node other than ASSIGNMENT type passed to processActivation.");
 
             parameterAssignment->getLeft()->assertNodeType(NODE::PARAM_NODE, "Parameter assignment node with left child other than PARAM type passed to processActivation.");
-            ParamNode* parameterIdentifierNode = dynamic_cast<ParamNode*>(parameterAssignment->getLeft());
+            ParamNode* parameterIdentifierNode = nodeCast<ParamNode>(parameterAssignment->getLeft());
 
             if (parameterIdentifierNode->getParamType() == PARAM::EQUATION) {
                 error("Reaction " + activationReactionName + " has equation defined more than once.");
             } else {
                 PARAM parameter = parameterIdentifierNode->getParamType();
 
-                if (validReactionParameters.count(parameter) == 0) {
-                    error("Reaction " + activationReactionName + " has invalid parameter " + paramTypeToText[parameter] + ".");
+                if ((paramBit(parameter) & REACTION_PARAMETERS) == 0) {
+                    error("Reaction " + activationReactionName + " has invalid parameter " + paramToText(parameter) + ".");
                 } else if (newReaction->hasActivationParameter(parameter)) {
-                    error("Reaction " + activationReactionName + " has parameter " + paramTypeToText[parameter] +
+                    error("Reaction " + activationReactionName + " has parameter " + paramToText(parameter) +
                           " defined more than once.");
                 }
 
                 parameterAssignment->getRight()->assertNodeType(NODE::NUMBER_NODE,
                                                                 "Only number nodes supported for reaction parameter values at present.");
-                NumberNode* numberNode = dynamic_cast<NumberNode*>(parameterAssignment->getRight());
+                NumberNode* numberNode = nodeCast<NumberNode>(parameterAssignment->getRight());
                 double value = numberNode->getSIValue();
                 newReaction->addActivationParameter(parameter, value);
             }
@@ -1202,59 +1325,31 @@ void Compartment::processActivation(const std::string& activationReactionName, R
         }
     }
 
-    for (REACTION_TYPE possibleType : {REACTION_TYPE::SAA}) {
-        if (newReaction->canHaveType(possibleType)) {
-            newReaction->setType(possibleType);
-            break;
-        }
-    }
-    if (newReaction->getType() == REACTION_TYPE::NOT_YET_DETERMINED) {
-        error("Reaction type of reaction " + newReaction->getActivationReactionName() + " cannot be determined. It likely has not enough or conflicting parameters.");
-    }
-    this->addReaction(newReaction);
+    newReaction->inferType({REACTION_TYPE::SAA}, newReaction->getActivationReactionName());
     std::cout << "Reaction " << newReaction->getActivationReactionName() << " caused reaction " << newReaction->getName() << " to become an activation reaction in compartment " << this->getName() << std::endl;
 }
 
 // inProgressReaction is the reaction we were building before we discovered it was an inhibition reaction.
 void Compartment::processInhibition(const std::string& inhibitionReactionName, Reaction* inProgressReaction,
                                     SymbolNode* equationAssignmentNode) {
-    SymbolNode* inhibitionNode = dynamic_cast<SymbolNode*>(equationAssignmentNode->getRight());
-    inhibitionNode->getLeft()->assertNodeType({NODE::IDENTIFIER_NODE, NODE::CHEMICAL_NODE}, "Inhibition " + inhibitionReactionName + " has left child that is not a CHEMICAL or IDENTIFIER node.");
-    inhibitionNode->getRight()->assertNodeType(NODE::IDENTIFIER_NODE, "Inhibition " + inhibitionReactionName + " has right child that is not an IDENTIFIER node.");
-
-    IdentifierNode* rightIdentifier = dynamic_cast<IdentifierNode*>(inhibitionNode->getRight());
-    std::string inhibitedReactionName = rightIdentifier->getName();
-    if (!this->hasReaction(inhibitedReactionName)) {
-        error("Inhibition " + inhibitionReactionName + " inhibitions reaction " + inhibitedReactionName + ", but this reaction does not exist.");
-    }
-
-    Reaction* oldReaction = this->getReaction(inhibitedReactionName);
-    // remove old reaction, which was not of activated type
-    this->removeReaction(oldReaction);
-
-    std::string inhibitorName;
-    if (inhibitionNode->getLeft()->getNodeType() == NODE::IDENTIFIER_NODE) {
-        IdentifierNode* left = dynamic_cast<IdentifierNode*>(inhibitionNode->getLeft());
-        inhibitorName = left->getName();
-    } else {
-        // Chemical node
-        ChemicalNode* left = dynamic_cast<ChemicalNode*>(inhibitionNode->getLeft());
-        inhibitorName = left->getFormula();
+    SymbolNode* inhibitionNode = nodeCast<SymbolNode>(equationAssignmentNode->getRight());
+    inhibitionNode->getLeft()->assertNodeType({NODE::IDENTIFIER_NODE, NODE::CHEMICAL_NODE}, [&] { return "Inhibition " + inhibitionReactionName + " has left child that is not a CHEMICAL or IDENTIFIER node."; });
+    inhibitionNode->getRight()->assertNodeType(NODE::IDENTIFIER_NODE, [&] { return "Inhibition " + inhibitionReactionName + " has right child that is not an IDENTIFIER node."; });
+
+    IdentifierNode* rightIdentifier = nodeCast<IdentifierNode>(inhibitionNode->getRight());
+    Reaction* oldReaction = this->findReaction(rightIdentifier);
+    if (oldReaction == nullptr) {
+        error("Inhibition " + inhibitionReactionName + " inhibitions reaction " + rightIdentifier->getName() + ", but this reaction does not exist.");
     }
 
-    Molecule* inhibitor = nullptr;
-    if (this->hasMolecule(inhibitorName)) {
-        inhibitor = this->getMolecule(inhibitorName);
-    } else {
-        Molecule* molecule = new Molecule(this, inhibitorName, molecules.size());
-        this->addMolecule(molecule);
-        inhibitor = molecule;
-    }
+    Molecule* inhibitor = this->findOrAddMolecule(inhibitionNode->getLeft());
 
     Inhibition* newReaction = new Inhibition(oldReaction, inhibitionReactionName, inhibitor);
     for (auto& [parameter, value] : inProgressReaction->getParameters()) {
         newReaction->addInhibitionParameter(parameter, value);
     }
+    // the old reaction, which was not of inhibited type, leaves its place to the new one
+    this->replaceReaction(oldReaction, newReaction);
     delete oldReaction;
     delete inProgressReaction;
 
@@ -1263,27 +1358,27 @@ void Compartment::processInhibition(const std::string& inhibitionReactionName, R
         ASTNode* parameterAssignmentNode = equationAssignmentNode->getNextStatement();
         while (true) {
             parameterAssignmentNode->assertNodeType(NODE::SYMBOL_NODE, "Reaction node with parameter node other than SYMBOL type passed to processInhibition.");
-            SymbolNode* parameterAssignment = dynamic_cast<SymbolNode*>(parameterAssignmentNode);
+            SymbolNode* parameterAssignment = nodeCast<SymbolNode>(parameterAssignmentNode);
             parameterAssignment->assertSymbol(SYMBOL::ASSIGNMENT, "Reaction node with parameter symbol node other than ASSIGNMENT type passed to processInhibition.");
 
             parameterAssignment->getLeft()->assertNodeType(NODE::PARAM_NODE, "Parameter assignment node with left child other than PARAM type passed to processInhibition.");
-            ParamNode* parameterIdentifierNode = dynamic_cast<ParamNode*>(parameterAssignment->getLeft());
+            ParamNode* parameterIdentifierNode = nodeCast<ParamNode>(parameterAssignment->getLeft());
 
             if (parameterIdentifierNode->getParamType() == PARAM::EQUATION) {
                 error("Reaction " + inhibitionReactionName + " has equation defined more than once.");
             } else {
                 PARAM parameter = parameterIdentifierNode->getParamType();
 
-                if (validReactionParameters.count(parameter) == 0) {
-                    error("Reaction " + inhibitionReactionName + " has invalid parameter " + paramTypeToText[parameter] + ".");
+                if ((paramBit(parameter) & REACTION_PARAMETERS) == 0) {
+                    error("Reaction " + inhibitionReactionName + " has invalid parameter " + paramToText(parameter) + ".");
                 } else if (newReaction->hasInhibitionParameter(parameter)) {
-                    error("Reaction " + inhibitionReactionName + " has parameter " + paramTypeToText[parameter] +
+                    error("Reaction " + inhibitionReactionName + " has parameter " + paramToText(parameter) +
                           " defined more than once.");
                 }
 
                 parameterAssignment->getRight()->assertNodeType(NODE::NUMBER_NODE,
                                                                 "Only number nodes supported for reaction parameter values at present.");
-                NumberNode* numberNode = dynamic_cast<NumberNode*>(parameterAssignment->getRight());
+                NumberNode* numberNode = nodeCast<NumberNode>(parameterAssignment->getRight());
                 double value = numberNode->getSIValue();
                 newReaction->addInhibitionParameter(parameter, value);
             }
@@ -1295,16 +1390,7 @@ void Compartment::processInhibition(const std::string& inhibitionReactionName, R
         }
     }
 
-    for (REACTION_TYPE possibleType : {REACTION_TYPE::SAI}) {
-        if (newReaction->canHaveType(possibleType)) {
-            newReaction->setType(possibleType);
-            break;
-        }
-    }
-    if (newReaction->getType() == REACTION_TYPE::NOT_YET_DETERMINED) {
-        error("Reaction type of reaction " + newReaction->getInhibitionReactionName() + " cannot be determined. It likely has not enough or conflicting parameters.");
-    }
-    this->addReaction(newReaction);
+    newReaction->inferType({REACTION_TYPE::SAI}, newReaction->getInhibitionReactionName());
     std::cout << "Reaction " << newReaction->getInhibitionReactionName() << " caused reaction " << newReaction->getName() << " to become an inhibition reaction in compartment " << this->getName() << std::endl;
 }
 
@@ -1320,22 +1406,14 @@ void Compartment::processProtein(KeywordNode* proteinNode) {
     proteinNode->assertKeyword(KEYWORD::PROTEIN, "KeywordNode with type other than PROTEIN passed to processProtein.");
 
     proteinNode->getLeft()->assertNodeType({NODE::IDENTIFIER_NODE, NODE::CHEMICAL_NODE}, "Protein node has left child other than IDENTIFIER or CHEMICAL type");
-    std::string proteinName;
-    if (proteinNode->getLeft()->getNodeType() == NODE::IDENTIFIER_NODE) {
-        IdentifierNode* proteinIdentifier = dynamic_cast<IdentifierNode*>(proteinNode->getLeft());
-        proteinName = proteinIdentifier->getName();
-    } else {
-        ChemicalNode* proteinIdentifier = dynamic_cast<ChemicalNode*>(proteinNode->getLeft());
-        proteinName = proteinIdentifier->getFormula();
-    }
 
     ASTNode* nodeToProcess = proteinNode->getRight();
 
     while (true) {
         nodeToProcess->assertNodeType(NODE::KEYWORD_NODE, "Protein statement other than KEYWORD type.");
-        KeywordNode* keywordToProcess = dynamic_cast<KeywordNode*>(nodeToProcess);
+        KeywordNode* keywordToProcess = nodeCast<KeywordNode>(nodeToProcess);
         keywordToProcess->assertKeyword(KEYWORD::REACTION, "Protein KEYWORD statement other than REACTION type.");
-        this->processReaction(keywordToProcess, true, proteinName);
+        this->processReaction(keywordToProcess, true, proteinNode->getLeft());
         if (!nodeToProcess->hasNextStatement) {
             break;
         } else {
@@ -1344,6 +1422,167 @@ void Compartment::processProtein(KeywordNode* proteinNode) {
     }
 }
 
+/*
+ *             INPUT ---->       complexNode
+ *                           /                \
+ *                   complex identifier      DOM      next statement      DOM
+ *                                         /     \   --------------->  /     \    ---> etc.
+ *                                    domain    state --> state        ...
+ *                                  identifier  identifier
+ *
+ */
+void Compartment::processComplex(KeywordNode* complexNode) {
+    complexNode->assertKeyword(KEYWORD::COMPLEX, "KeywordNode with type other than COMPLEX passed to processComplex.");
+
+    ComplexType complexType;
+    complexType.name = nodeCast<IdentifierNode>(complexNode->getLeft())->getName();
+    for (ASTNode* domainNode = complexNode->getRight(); domainNode->getNodeType() == NODE::KEYWORD_NODE;
+         domainNode = domainNode->getNextStatement()) {
+        KeywordNode* domainKeyword = nodeCast<KeywordNode>(domainNode);
+        domainKeyword->assertKeyword(KEYWORD::DOM, "Complex statement other than DOM type.");
+        DomainType domain;
+        domain.name = nodeCast<IdentifierNode>(domainKeyword->getLeft())->getName();
+        for (ASTNode* stateNode = domainKeyword->getRight(); stateNode->getNodeType() == NODE::IDENTIFIER_NODE;
+             stateNode = stateNode->getNextStatement()) {
+            domain.states.push_back(nodeCast<IdentifierNode>(stateNode)->getName());
+            if (!stateNode->hasNextStatement) {
+                break;
+            }
+        }
+        complexType.domains.push_back(std::move(domain));
+        if (!domainNode->hasNextStatement) {
+            break;
+        }
+    }
+    rules.addComplexType(complexType);
+    std::cout << "Added complex " << complexType.name << " to compartment " << this->getName() << std::endl;
+}
+
+// Appends the patterns of one side of a rule, repeated by their coefficients.
+static void collectPatterns(const RuleNetwork& rules, ASTNode* side, const std::string& ruleName,
+                            std::vector<Pattern>& patterns) {
+    std::vector<std::pair<ASTNode*, int>> species;
+    if (SpeciesListNode* speciesList = nodeCast<SpeciesListNode>(side)) {
+        for (size_t i = 0; i < speciesList->size(); i++) {
+            species.push_back({ speciesList->getSpecies(i), speciesList->getCoefficient(i) });
+        }
+    } else {
+        species.push_back({ side, 1 });
+    }
+    for (auto& [node, coefficient] : species) {
+        if (!isComplexPattern(node)) {
+            error("Reaction " + ruleName + " mixes complex patterns with other species.");
+        }
+        Pattern pattern = rules.parsePattern(nodeCast<IdentifierNode>(static_cast<KeywordNode*>(node)->getLeft())->getName());
+        for (int i = 0; i < coefficient; i++) {
+            patterns.push_back(pattern);
+        }
+    }
+}
+
+void Compartment::processRule(KeywordNode* reactionNode) {
+    std::string ruleName = nodeCast<IdentifierNode>(reactionNode->getLeft())->getName();
+    std::vector<Pattern> reactants;
+    std::vector<Pattern> products;
+    std::optional<double> rate;
+    double reverseRate = 0;
+
+    for (ASTNode* parameterNode = reactionNode->getRight(); ; parameterNode = parameterNode->getNextStatement()) {
+        SymbolNode* parameterAssignment = nodeCast<SymbolNode>(parameterNode);
+        PARAM parameter = nodeCast<ParamNode>(parameterAssignment->getLeft())->getParamType();
+        if (parameter == PARAM::EQUATION) {
+            SymbolNode* arrow = nodeCast<SymbolNode>(parameterAssignment->getRight());
+            if (arrow->getSymbol() != SYMBOL::FORWARD) {
+                error("Reaction " + ruleName + " over complexes must be written with -->.");
+            }
+            collectPatterns(rules, arrow->getLeft(), ruleName, reactants);
+            collectPatterns(rules, arrow->getRight(), ruleName, products);
+        } else if (parameter == PARAM::K || parameter == PARAM::KREV) {
+            parameterAssignment->getRight()->assertNodeType(NODE::NUMBER_NODE, "Only number nodes supported for reaction parameter values at present.");
+            double value = nodeCast<NumberNode>(parameterAssignment->getRight())->getSIValue();
+            if (parameter == PARAM::K) {
+                rate = value;
+            } else {
+                reverseRate = value;
+            }
+        } else {
+            error("Reaction " + ruleName + " over complexes has invalid parameter " + paramToText(parameter) + ". Only k and krev can be given.");
+        }
+        if (!parameterNode->hasNextStatement) {
+            break;
+        }
+    }
+    if (!rate.has_value()) {
+        error("Reaction " + ruleName + " over complexes has no rate k.");
+    }
+
+    rules.addRule(ruleName, reactants, products, rate.value());
+    if (reverseRate > 0) {
+        rules.addRule(ruleName + "_rev", products, reactants, reverseRate);
+    }
+    std::cout << "Added rule " << ruleName << " to compartment " << this->getName() << std::endl;
+    this->syncRuleNetwork();
+}
+
+const RuleNetwork& Compartment::getRuleNetwork() const {
+    return rules;
+}
+
+Molecule* Compartment::reachSpecies(int species) {
+    rules.reach(species);
+    this->syncRuleNetwork();
+    return molecules.get(speciesMolecules[species]);
+}
+
+void Compartment::expandRuleNetwork() {
+    // reaching a species only adds species after it
+    for (size_t species = 0; species < rules.speciesCount() && !rules.isTruncated(); species++) {
+        rules.reach(species);
+    }
+    this->syncRuleNetwork();
+}
+
+void Compartment::syncRuleNetwork() {
+    for (size_t species = speciesMolecules.size(); species < rules.speciesCount(); species++) {
+        const std::string& label = rules.getLabel(species);
+        Molecule* molecule = this->hasMolecule(label) ? this->getMolecule(label) : this->addNamedMolecule(label);
+        speciesMolecules.push_back(moleculeNameToHandle.at(molecule->getName()));
+    }
+
+    const std::vector<NetworkReaction>& networkReactions = rules.getReactions();
+    for (; syncedRuleReactions < networkReactions.size(); syncedRuleReactions++) {
+        const NetworkReaction& networkReaction = networkReactions[syncedRuleReactions];
+        Reaction* reaction = new Reaction(this, rules.getRuleName(networkReaction.rule) + "[" +
+                                                std::to_string(syncedRuleReactions) + "]");
+        // A + A is one reactant with coefficient 2
+        std::map<int, int> reactantCounts;
+        std::map<int, int> productCounts;
+        for (int species : networkReaction.reactants) {
+            reactantCounts[species]++;
+        }
+        for (int species : networkReaction.products) {
+            productCounts[species]++;
+        }
+        for (auto& [species, count] : reactantCounts) {
+            reaction->addReactant(molecules.get(speciesMolecules[species]), -count);
+        }
+        for (auto& [species, count] : productCounts) {
+            reaction->addProduct(molecules.get(speciesMolecules[species]), count);
+        }
+        reaction->addParameter(PARAM::K, networkReaction.rate);
+        reaction->addParameter(PARAM::KREV, 0);
+        reaction->setType(REACTION_TYPE::SU);
+        this->addReaction(reaction);
+    }
+
+    if (rules.isTruncated() && !reportedTruncation) {
+        // TODO: wrap behind compiler flags
+        std::cout << "Warning: rule network of compartment " << this->getName() << " reached its limit of " <<
+                     "species or reactions and was not expanded further." << std::endl;
+        reportedTruncation = true;
+    }
+}
+
 Simulation::Simulation(const std::string& newName) :
         name(newName),
         globalCompartment(new Compartment(nullptr, "global", COMPARTMENT_TYPE::NON_SPATIAL, LCC_DEFAULT_VOLUME)) {
@@ -1361,13 +1600,23 @@ Compartment* Simulation::getGlobalCompartment() const {
     return globalCompartment;
 }
 
+void Simulation::expandRuleNetworks() {
+    std::vector<Compartment*> pending = { globalCompartment };
+    while (!pending.empty()) {
+        Compartment* compartment = pending.back();
+        pending.pop_back();
+        compartment->expandRuleNetwork();
+        pending.insert(pending.end(), compartment->getChildren().begin(), compartment->getChildren().end());
+    }
+}
+
 void Simulation::buildContext(ASTNode* node) {
     NODE nodeType = node->getNodeType();
 
     switch (nodeType) {
         // reaction statements
         case NODE::KEYWORD_NODE: {
-            KeywordNode* keyword = dynamic_cast<KeywordNode*>(node);
+            KeywordNode* keyword = nodeCast<KeywordNode>(node);
             switch (keyword->getKeyword()) {
                 case KEYWORD::REACTION:
                     globalCompartment->processReaction(keyword);
@@ -1375,14 +1624,17 @@ void Simulation::buildContext(ASTNode* node) {
                 case KEYWORD::PROTEIN:
                     globalCompartment->processProtein(keyword);
                     break;
+                case KEYWORD::COMPLEX:
+                    globalCompartment->processComplex(keyword);
+                    break;
                 default:
-                    error("KeywordNode other than REACTION or PROTEIN in buildContext.");
+                    error("KeywordNode other than REACTION, PROTEIN or COMPLEX in buildContext.");
             }
             break;
         }
             // assignment statements
         case NODE::SYMBOL_NODE: {
-            SymbolNode* symbol = dynamic_cast<SymbolNode*>(node);
+            SymbolNode* symbol = nodeCast<SymbolNode>(node);
             globalCompartment->processMoleculeAssignment(symbol);
             break;
         }
@@ -1396,25 +1648,35 @@ void Simulation::buildContext(ASTNode* node) {
 
 void Simulation::buildSimulation(ASTNode* tree) {
     std::cout << "Building simulation..." << std::endl;
-    // AST Traversal
-    std::stack<ASTNode*> unvisited;
-    ASTNode* firstStatement = tree;
-    unvisited.push(firstStatement);
-
-    while (!unvisited.empty()) {
-        ASTNode* node = unvisited.top();
-        unvisited.pop();
-        if (!node->visited) {
-            node->visited = true;
-            buildContext(node);
-            if (node->hasNextStatement) {
-                unvisited.push(node->getNextStatement());
-            }
-        }
+    names.resolve(tree);
+    // AST Traversal over top-level statements only
+    ASTWalker().walk(tree, [this](ASTNode* node, int depth, bool fromNextStatement) {
+        buildContext(node);
+        return false;
+    });
+    std::cout << "+ simulation successfully built!" << "\n" << std::endl;
+}
+
+void Simulation::buildSimulation(const FlatAst& flat) {
+    std::cout << "Building simulation (flat)..." << std::endl;
+    std::vector<int> nameIds = names.resolve(flat);
+    AstArena arena;
+    for (FlatNodeView statement = flat.view(flat.getRoot()); !statement.isNull(); statement = statement.getNextStatement()) {
+        buildContext(flat.raise(statement.getIndex(), arena, nameIds));
+        arena.reset();
     }
     std::cout << "+ simulation successfully built!" << "\n" << std::endl;
 }
 
+void Simulation::streamSimulation(Parser* parser) {
+    std::cout << "Building simulation (streaming)..." << std::endl;
+    parser->parseStreaming([this](ASTNode* statement) {
+        names.resolve(statement);
+        buildContext(statement);
+    });
+    std::cout << "+ simulation successfully built!" << "\n" << std::endl;
+}
+
 }
 
 int main(int argc, char* argv[]) {
@@ -1452,7 +1714,7 @@ int main(int argc, char* argv[]) {
     head = masterFile->getFileHead();
     tail = masterFile->getFileTail();
 
-    // Parser* parser = new Parser(head);
+    // Parser* parser = new Parser(head, &collect);
     // ASTNode* tree = parser->parse();  // needs freeing
     // Simulation* simulation = new Simulation("New Simulation");
     // simulation->buildSimulation(tree);
@@ -1,12 +1,21 @@
 #pragma once
 
+#include <cstdint>
+#include <initializer_list>
 #include <string>
 #include <vector>
 #include <set>
 #include <list>
+#include <map>
+#include <optional>
 #include <unordered_map>
 #include "ast.h"
 #include "scope.h"
+#include "resolver.h"
+#include "ruleNetwork.h"
+#include "slotMap.h"
+
+class Parser;
 
 namespace lcc {
 
@@ -25,6 +34,12 @@ enum class REACTION_TYPE {
 
 extern std::unordered_map<REACTION_TYPE, std::string> reactionTypeToAcronym;
 
+// A set of PARAMs as one bit per PARAM, used to match a reaction's parameters against reaction types.
+using ParamMask = uint32_t;
+constexpr ParamMask paramBit(PARAM parameter) {
+    return ParamMask(1) << static_cast<int>(parameter);
+}
+
 enum class COMPARTMENT_TYPE {
     NON_SPATIAL,
     CONTAINER
@@ -36,6 +51,14 @@ class Reaction;
 class Compartment;
 class FixedCountHandler;  // Not exposed to the interface. For implementation only.
 
+/* One step of a molecule's fixed count schedule: from time until the time of the next step, the count of the molecule
+    * is held at count, or is left free if count is empty.
+    * */
+struct FixedCountStep {
+    double time;
+    std::optional<double> count;
+};
+
 class Molecule {
   public:
     /* For all constructors:
@@ -67,6 +90,10 @@ class Molecule {
     std::optional<double> getBaseline() const;
     const std::map<double, double>& getChangePoints() const;
     const std::map<double, std::optional<double>>& getIntervalPoints() const;
+    /* The interval points as a timeline sorted by time for simulators to step through: it starts at time 0 and no two
+        * consecutive steps have the same count.
+        * */
+    const std::vector<FixedCountStep>& getFixedCountTimeline() const;
 
   private:
     Compartment* const compartment;  // Cannot be NULL
@@ -76,6 +103,7 @@ class Molecule {
     std::optional<double> initialCount;
 
     // These are for implementation reasons.
+    friend class Compartment;  // keeps indexInCompartment up to date when molecules are removed
     friend class FixedCountHandler;
     // If developing the implementation and need to access this, see FixedCountHandler declaration in context.cxx.
     FixedCountHandler* fixedCountHandler;
@@ -97,7 +125,12 @@ class Reaction {
         * This could return false for all possible reaction types, for example when a reaction has been
         * given contradictory parameters that don't match with any possible type.
         * */
-    virtual bool canHaveType(REACTION_TYPE reactionType) const;
+    bool canHaveType(REACTION_TYPE reactionType) const;
+    /* Sets the type to the first of candidates that the reaction can have. If it can have none of them, errors
+        * with the parameters that are missing for, or conflict with, the candidate it comes closest to.
+        * displayName is the name of the reaction in that message.
+        * */
+    void inferType(std::initializer_list<REACTION_TYPE> candidates, const std::string& displayName);
     void setType(REACTION_TYPE newType);
 
     const std::vector<Molecule*>& getReactants() const;
@@ -112,6 +145,11 @@ class Reaction {
 
     // Returns 0 for molecules that are not part of the reaction.
     int getStoichiometricCoefficient(Molecule* molecule);
+    /* The coefficients of each side on their own, summed over repeats and positive, so that a molecule on both
+        * sides (ie. 2 A --> A + B) keeps both. getStoichiometricCoefficient() only has the side added last.
+        * */
+    const std::unordered_map<Molecule*, int>& getReactantCoefficients() const;
+    const std::unordered_map<Molecule*, int>& getProductCoefficients() const;
 
     bool hasParameter(PARAM parameter) const;
     // Throws error if reaction does not have the parameter. Check with hasParameter() first.
@@ -121,8 +159,13 @@ class Reaction {
         * Use <map object>.at(key) instead, which throws an error if key is not in the map.
         * */
     const std::unordered_map<PARAM, double>& getParameters() const;
+    ParamMask getParameterMask() const;
     void addParameter(PARAM parameterName, double value);
 
+  protected:
+    // The parameters that decide the reaction's type in canHaveType().
+    virtual ParamMask getTypeParameterMask() const;
+
   private:
     Compartment* const compartment;  // Cannot be NULL
     const std::string name;
@@ -133,7 +176,10 @@ class Reaction {
     std::optional<Molecule*> protein;  // for ESU and MMU reactions
 
     std::unordered_map<Molecule*, int> stoichiometry;
+    std::unordered_map<Molecule*, int> reactantCoefficients;
+    std::unordered_map<Molecule*, int> productCoefficients;
     std::unordered_map<PARAM, double> parameters;
+    ParamMask parameterMask;
 };
 
 class Activation : public Reaction {
@@ -156,15 +202,17 @@ class Activation : public Reaction {
     double getActivationParameterValue(PARAM parameter) const;
     void addActivationParameter(PARAM parameterName, double value);
 
+  protected:
     /* Override which considers only activation parameters instead of normal parameters. Does not re-evaluate the
         * underlying reaction that was passed in to the constructor.
         * */
-    virtual bool canHaveType(REACTION_TYPE reactionType) const override;
+    virtual ParamMask getTypeParameterMask() const override;
 
   private:
     const std::string activationReactionName;
     Molecule* const activator;
     std::unordered_map<PARAM, double> activationParameters;
+    ParamMask activationParameterMask;
 };
 
 class Inhibition : public Reaction {
@@ -187,15 +235,32 @@ class Inhibition : public Reaction {
     double getInhibitionParameterValue(PARAM parameter) const;
     void addInhibitionParameter(PARAM parameterName, double value);
 
+  protected:
     /* Override which considers only inhibition parameters instead of normal parameters. Does not re-evaluate the
         * underlying reaction that was passed in to the constructor.
         * */
-    virtual bool canHaveType(REACTION_TYPE reactionType) const override;
+    virtual ParamMask getTypeParameterMask() const override;
 
   private:
     const std::string inhibitionReactionName;
     Molecule* const inhibitor;
     std::unordered_map<PARAM, double> inhibitionParameters;
+    ParamMask inhibitionParameterMask;
+};
+
+/* A species array, ie. R[0..999], declared by assigning to a range. Its elements are named "R[3]" (see
+    * loopExpander.h) and only get a Molecule once something refers to them, so that large arrays cost one
+    * descriptor instead of one Molecule per element.
+    * An element takes the next molecule index when it is first used, so the elements of a range are not
+    * contiguous in the compartment (or in a CompiledModel) and may be interleaved with other species.
+    * Look an element up by its name (Compartment::getMolecule()), never as first + offset.
+    * */
+struct SpeciesRange {
+    long first;
+    long last;  // inclusive
+    std::optional<double> initialCount;
+
+    bool contains(long index) const { return index >= first && index <= last; }
 };
 
 // See wiki/Simulation Structure Overview/ and wiki/Compiler Context/ for more information.
@@ -230,6 +295,22 @@ class Compartment {
         * Find size with <compartment object>.getMolecules().size().
         * */
     void addMolecule(Molecule* molecule);
+    /* Removes the molecule in O(1), without deallocating it; the last molecule takes its index. The molecule
+        * must not be part of any reaction.
+        * */
+    void removeMolecule(Molecule* molecule);
+    /* Molecule named by an IDENTIFIER or CHEMICAL node. Creates it at the back of the molecules vector if it
+        * does not exist yet. Nodes bound by a NameResolver are found by name ID without hashing the name.
+        * */
+    Molecule* findOrAddMolecule(ASTNode* speciesNode);
+
+    /* Declares base[first..last]. Ranges of the same base may be declared more than once; where they overlap,
+        * the latest declaration gives the initial count. Elements that already have a Molecule are updated.
+        * */
+    void declareSpeciesArray(const std::string& base, long first, long last, std::optional<double> initialCount);
+    bool hasSpeciesArray(const std::string& base) const;
+    // Ranges of every species array by base name, in declaration order.
+    const std::unordered_map<std::string, std::vector<SpeciesRange>>& getSpeciesArrays() const;
     /* Processes a molecule assignment, given a SymbolNode with symbol ASSIGNMENT from the AST that represents
         * a molecule assignment.
         *
@@ -249,8 +330,14 @@ class Compartment {
     bool hasReaction(const std::string& nameToSearch) const;
     // Throws error if compartment does not have the reaction. Check with hasReaction() first.
     Reaction* getReaction(const std::string& nameToFind) const;
-    void addReaction(Reaction* reaction);
+    // Returns the reaction named by an IDENTIFIER node, or nullptr if there is none.
+    Reaction* findReaction(IdentifierNode* reactionNode) const;
+    // nameId is the NameResolver ID of the reaction's name, or -1 if it has none.
+    void addReaction(Reaction* reaction, int nameId = -1);
+    // Removes the reaction in O(1), without deallocating it; the last reaction takes its place in getReactions().
     void removeReaction(Reaction* reaction);
+    // newReaction takes the place and name bindings of oldReaction, in O(1). oldReaction is not deallocated.
+    void replaceReaction(Reaction* oldReaction, Reaction* newReaction);
     /* Processes a reaction, given a KeywordNode with keyword REACTION from the AST that represents a reaction.
         *
         * Throws an error on logically invalid inputs (i.e. invalid inputs as a result of
@@ -258,13 +345,23 @@ class Compartment {
         *
         * If inputs are not well-formed (i.e. AST nodes with children of unexpected types), then behavior is undefined.
         *
-        * Optionally takes a bool isInProtein and string proteinName, which means that this reaction was declared inside a protein,
-        * and should be processed as such.
+        * Optionally takes a bool isInProtein and the protein's IDENTIFIER or CHEMICAL node, which means that this reaction was
+        * declared inside a protein, and should be processed as such.
         * */
-    void processReaction(KeywordNode* reactionNode, bool isInProtein = false, const std::string& proteinName = "NONAME");
+    void processReaction(KeywordNode* reactionNode, bool isInProtein = false, ASTNode* proteinNameNode = nullptr);
 
     void processProtein(KeywordNode* proteinNode);
 
+    // Declares a complex and its domains, given a KeywordNode with keyword COMPLEX (see parser.cxx).
+    void processComplex(KeywordNode* complexNode);
+    const RuleNetwork& getRuleNetwork() const;
+    /* Applies the rules to a species of the rule network, ie. once it first gets a nonzero population, and adds
+        * the reactions (and species) this produces. Returns the molecule of the species.
+        * */
+    Molecule* reachSpecies(int species);
+    // Reaches every species of the rule network, until it is complete or hits its limits.
+    void expandRuleNetwork();
+
   private:
     Compartment* const parent;  // can be NULL
     const std::string name;
@@ -274,11 +371,34 @@ class Compartment {
 
     std::vector<Compartment*> children;
 
-    std::unordered_map<std::string, int> moleculeNameToIndex;
-    std::vector<Molecule*> molecules;
-
-    std::unordered_map<std::string, int> reactionNameToIndex;
-    std::vector<Reaction*> reactions;
+    /* Molecules and reactions are found by handle (see slotMap.h), so removing or replacing one never
+        * renumbers the indices below. A handle to a removed one is stale and found as missing.
+        * */
+    SlotMap<Molecule*> molecules;
+    std::unordered_map<std::string, SlotHandle> moleculeNameToHandle;
+    std::vector<SlotHandle> moleculeByNameId;      // name ID -> molecule
+
+    std::unordered_map<std::string, std::vector<SpeciesRange>> speciesArrays;
+    std::unordered_map<std::string, std::map<long, SlotHandle>> arrayElements;    // base -> element index -> molecule
+
+    SlotMap<Reaction*> reactions;
+    std::unordered_map<std::string, SlotHandle> reactionNameToHandle;
+    std::vector<SlotHandle> reactionByNameId;      // name ID -> reaction
+    std::vector<int> reactionSlotNameIds;          // slot of a reaction -> name ID, -1 if added without one
+    int unboundReactions = 0;                      // reactions only findable by name
+
+    RuleNetwork rules;
+    std::vector<SlotHandle> speciesMolecules;      // rule network species ID -> molecule
+    size_t syncedRuleReactions = 0;         // rule network reactions added as Reactions so far
+    bool reportedTruncation = false;
+
+    // New Molecule named moleculeName, set up as an array element if its name is base[index] of a species array.
+    Molecule* addNamedMolecule(const std::string& moleculeName);
+    void processArrayAssignment(IndexNode* indexNode, double value);
+    // Rule over complex patterns, ie. reaction bind(EGF(rec) + EGFR(lig) --> EGF(rec!1).EGFR(lig!1), k = 1)
+    void processRule(KeywordNode* reactionNode);
+    // Adds the species and reactions of the rule network that have no Molecule or Reaction yet.
+    void syncRuleNetwork();
 
     void processReactants(ASTNode* equationLHS, Reaction* reaction);
     void processProducts(ASTNode* equationRHS, Reaction* reaction);
@@ -298,10 +418,21 @@ class Simulation {
 
     void buildContext(ASTNode* statement);
     void buildSimulation(ASTNode* tree);
+    /* Builds the simulation from a flat tree (see Parser::parseFlat). Names are
+       resolved on the flat arrays; each statement is then raised to pointer
+       nodes on its own for buildContext() and freed right after. */
+    void buildSimulation(const FlatAst& flat);
+    /* Builds the simulation while parsing: every top-level statement is passed to
+       buildContext() as soon as it is parsed and freed right after, so the full
+       tree is never held in memory. */
+    void streamSimulation(Parser* parser);
+    // Expands the rule network of every compartment in full (see Compartment::expandRuleNetwork()), ie. before compiling.
+    void expandRuleNetworks();
 
   private:
     const std::string name;
     Compartment* const globalCompartment;
+    NameResolver names;     // binds species and reaction names before buildContext()
         
 };
 
@@ -94,8 +94,8 @@ void Debugger::debug(Parser* parser, ASTNode* tree) {
         else if (input == "s" || input == "step") {
             if (cur->getNodeType() == NODE::KEYWORD_NODE) {
                 history.push(cur);
-                KeywordNode* keyword = dynamic_cast<KeywordNode*>(cur);
-                IdentifierNode* identifier = dynamic_cast<IdentifierNode*>(keyword->getLeft());
+                KeywordNode* keyword = nodeCast<KeywordNode>(cur);
+                IdentifierNode* identifier = nodeCast<IdentifierNode>(keyword->getLeft());
                 scopeStack.push(curScopeName);
                 curScopeName = identifier->getName();
                 curScope = parser->getScope(curScopeName);
@@ -187,9 +187,7 @@ int main (int argc, char* argv[]) {
     std::string debugModeString(newArgV[0]);
 
     DEBUG_MODE mode;
-    if (debugModeMap.count(debugModeString)) {
-        mode = debugModeMap.at(debugModeString);
-    } else {
+    if (!findText(debugModeTable, debugModeString, &mode)) {
         fprintf(stderr, "ERROR: Debug Mode passed in is invalid.\n");
         fprintf(stderr, "Possible debug modes:\n");
         fprintf(stderr, "\t\t tokens\n");
@@ -220,7 +218,7 @@ int main (int argc, char* argv[]) {
         debugger->debug(tokenizer, head);
     }
     else if (mode == DEBUG_MODE::TREE) {
-        Parser* parser = new Parser(head);
+        Parser* parser = new Parser(head, &collect);
         ASTNode* tree = parser->parse();
         debugger = new Debugger(tree);
         debugger->debug(parser, tree);
@@ -3,6 +3,7 @@
 #include "context.h"
 #include "parser.h"
 #include "scope.h"
+#include "enumText.h"
 
 #include <unordered_map>
 #include <vector>
@@ -15,11 +16,12 @@ enum class DEBUG_MODE {
     SIMULATION
 };
 
-std::unordered_map<std::string, DEBUG_MODE> debugModeMap {
+static constexpr EnumText<DEBUG_MODE> debugModeTable[] = {
+    { "simulation", DEBUG_MODE::SIMULATION },
     { "tokens", DEBUG_MODE::TOKENS },
-    { "tree", DEBUG_MODE::TREE },
-    { "simulation", DEBUG_MODE::SIMULATION }
+    { "tree", DEBUG_MODE::TREE }
 };
+static_assert(isSortedByText(debugModeTable) && hasUniqueValues(debugModeTable));
 
 class Debugger {
   public:
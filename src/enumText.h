@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+/*  Enum <-> Text Tables:
+    --------------------------------------
+    Each table is a constexpr array of { text, value } pairs sorted by text.
+    Text -> enum is a binary search over the table, and enum -> text reads a
+    dense array that invertTable() builds from the same table at compile time,
+    so both directions come from one list and nothing is built at startup.
+
+    Tables are checked when they are compiled:
+        static_assert(isSortedByText(table));
+        static_assert(hasUniqueValues(table));
+*/
+
+template <class Tenum>
+struct EnumText {
+    const char* text;
+    Tenum value;
+};
+
+template <class Tenum, size_t N>
+constexpr bool isSortedByText(const EnumText<Tenum> (&table)[N]) {
+    for (size_t i = 1; i < N; i++) {
+        if (!(std::string_view(table[i - 1].text) < std::string_view(table[i].text))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <class Tenum, size_t N>
+constexpr bool hasUniqueValues(const EnumText<Tenum> (&table)[N]) {
+    for (size_t i = 0; i < N; i++) {
+        for (size_t j = i + 1; j < N; j++) {
+            if (table[i].value == table[j].value) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// one past the largest enum value in table
+template <class Tenum, size_t N>
+constexpr size_t enumSpan(const EnumText<Tenum> (&table)[N]) {
+    size_t span = 0;
+    for (size_t i = 0; i < N; i++) {
+        if (static_cast<size_t>(table[i].value) + 1 > span) {
+            span = static_cast<size_t>(table[i].value) + 1;
+        }
+    }
+    return span;
+}
+
+// enum value -> text; values missing from table map to ""
+template <size_t Nspan, class Tenum, size_t N>
+constexpr std::array<const char*, Nspan> invertTable(const EnumText<Tenum> (&table)[N]) {
+    std::array<const char*, Nspan> texts {};
+    for (size_t i = 0; i < Nspan; i++) {
+        texts[i] = "";
+    }
+    for (size_t i = 0; i < N; i++) {
+        texts[static_cast<size_t>(table[i].value)] = table[i].text;
+    }
+    return texts;
+}
+
+// false if text is not in table; value is left untouched
+template <class Tenum, size_t N>
+constexpr bool findText(const EnumText<Tenum> (&table)[N], std::string_view text, Tenum* value) {
+    size_t low = 0;
+    size_t high = N;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        std::string_view entry(table[mid].text);
+        if (entry < text) {
+            low = mid + 1;
+        } else if (text < entry) {
+            high = mid;
+        } else {
+            *value = table[mid].value;
+            return true;
+        }
+    }
+    return false;
+}
+
+template <class Tenum, size_t Nspan>
+constexpr const char* textOf(const std::array<const char*, Nspan>& texts, Tenum value) {
+    size_t index = static_cast<size_t>(value);
+    return index < Nspan ? texts[index] : "";
+}
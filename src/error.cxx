@@ -1,7 +1,14 @@
 #include "error.h"
+#include "tokenizer.h"
 #include <string>
 
+thread_local ErrorCollector* recoveringCollector = nullptr;
+
 [[noreturn]] void error(std::string message) {
+    if (recoveringCollector != nullptr) {
+        // recorded by the parser, which knows where it is
+        throw SyntaxError(message, false);
+    }
     fprintf(stderr, "%s", message.c_str());
     exit(1);
 }
\ No newline at end of file
@@ -1,5 +1,56 @@
 #pragma once
 
 #include <string>
+#include <stdexcept>
+#include <type_traits>
 
-[[noreturn]] void error(std::string message);
\ No newline at end of file
+class ErrorCollector;
+
+/* Thrown by error() and fail() in place of exiting while a recovering parse is
+   active on the current thread. fail() has already recorded the diagnostic at
+   its token; error() has no token, so the parser that catches it records it at
+   the token it stopped on (see Parser::recordError). */
+class SyntaxError : public std::runtime_error {
+    public:
+        explicit SyntaxError(const std::string& message, bool newRecorded = true) :
+            std::runtime_error(message), recorded(newRecorded) {}
+        bool isRecorded() const { return recorded; }
+    private:
+        bool recorded;
+};
+
+/* Set by the parser while it can recover from errors. When non-null, error()
+   and fail() throw SyntaxError, and their message ends up here. */
+extern thread_local ErrorCollector* recoveringCollector;
+
+/* Message of a diagnostic that is only built if the diagnostic fires. Holds a
+   string literal, an existing string, or a callable returning std::string,
+   without copying or allocating, so passing one on the success path is free:
+
+        node->assertNodeType(NODE::NUMBER_NODE, "Expected a number.");
+        node->assertNodeType(NODE::NUMBER_NODE, [&] { return "Reaction " + name + " has no rate."; });
+
+   A LazyMessage refers to its argument and must not outlive the call it is
+   passed to. */
+class LazyMessage {
+    public:
+        LazyMessage(const char* newText) : text(newText), callable(nullptr), build(nullptr) {}
+        LazyMessage(const std::string& newText) : text(newText.c_str()), callable(nullptr), build(nullptr) {}
+        template<typename Builder,
+                 typename = std::enable_if_t<std::is_invocable_r_v<std::string, const Builder&>>>
+        LazyMessage(const Builder& builder) :
+            text(nullptr),
+            callable(&builder),
+            build([](const void* target) { return std::string((*static_cast<const Builder*>(target))()); }) {}
+
+        std::string str() const {
+            return build != nullptr ? build(callable) : std::string(text);
+        }
+
+    private:
+        const char* text;
+        const void* callable;
+        std::string (*build)(const void*);
+};
+
+[[noreturn]] void error(std::string message);
@@ -0,0 +1,522 @@
+#include "flatAst.h"
+#include "arena.h"
+
+#include <utility>
+
+/* Flat AST constructors + lowering */
+FlatAst::FlatAst() :
+    root(NO_NODE),
+    lastStatement(NO_NODE) {}
+
+void FlatAst::clear() {
+    kinds.clear();
+    subtags.clear();
+    aux.clear();
+    lines.clear();
+    cols.clear();
+    firstChild.clear();
+    childCount.clear();
+    nextStatement.clear();
+    payload.clear();
+    childList.clear();
+    numbers.clear();
+    coefficients.clear();
+    strings.clear();
+    stringIndex.clear();
+    root = NO_NODE;
+    lastStatement = NO_NODE;
+}
+
+size_t FlatAst::size() const {
+    return kinds.size();
+}
+
+size_t FlatAst::stringCount() const {
+    return strings.size();
+}
+
+size_t FlatAst::memoryUsage() const {
+    size_t perNode = sizeof(uint8_t) * 3 + sizeof(uint32_t) * 6;
+    size_t bytes = size() * perNode;
+    bytes += childList.size() * sizeof(FlatIndex);
+    bytes += numbers.size() * sizeof(FlatNumber);
+    bytes += coefficients.size() * sizeof(int32_t);
+    for (const std::string& text : strings) {
+        bytes += sizeof(std::string) + text.capacity();
+    }
+    return bytes;
+}
+
+FlatIndex FlatAst::getRoot() const {
+    return root;
+}
+
+FlatNodeView FlatAst::view(FlatIndex index) const {
+    return FlatNodeView(this, index);
+}
+
+uint32_t FlatAst::internString(const std::string& text) {
+    auto found = stringIndex.find(text);
+    if (found != stringIndex.end()) {
+        return found->second;
+    }
+    uint32_t index = strings.size();
+    strings.push_back(text);
+    stringIndex.emplace(text, index);
+    return index;
+}
+
+/* Appends the scalar fields of node and reserves its child slots. Children
+   are filled in by lower(). */
+FlatIndex FlatAst::addNode(ASTNode* node) {
+    FlatIndex index = kinds.size();
+    NODE nodeType = node->getNodeType();
+    uint8_t subtag = 0;
+    uint8_t extra = 0;
+    uint32_t data = 0;
+    uint32_t slots = 0;
+
+    switch (nodeType) {
+        case NODE::SYMBOL_NODE:
+            subtag = static_cast<uint8_t>(static_cast<SymbolNode*>(node)->getSymbol());
+            break;
+        case NODE::KEYWORD_NODE: {
+            KeywordNode* keyword = static_cast<KeywordNode*>(node);
+            subtag = static_cast<uint8_t>(keyword->getKeyword());
+            extra = keyword->statementsAllowed();
+            break;
+        }
+        case NODE::LOOPING_NODE:
+            subtag = static_cast<uint8_t>(static_cast<LoopingNode*>(node)->getLoopType());
+            break;
+        case NODE::PARAM_NODE:
+            subtag = static_cast<uint8_t>(static_cast<ParamNode*>(node)->getParamType());
+            break;
+        case NODE::IMPORT_NODE:
+            subtag = static_cast<uint8_t>(static_cast<ImportNode*>(node)->getImport());
+            break;
+        case NODE::IDENTIFIER_NODE: {
+            IdentifierNode* identifier = static_cast<IdentifierNode*>(node);
+            subtag = static_cast<uint8_t>(identifier->getType());
+            extra = static_cast<uint8_t>(identifier->getPrimitiveType());
+            data = internString(identifier->getName());
+            break;
+        }
+        case NODE::FUNCTION_NODE: {
+            FunctionNode* function = static_cast<FunctionNode*>(node);
+            subtag = static_cast<uint8_t>(function->getFunctionType());
+            extra = function->hasParams();
+            data = internString(function->getName());
+            break;
+        }
+        case NODE::CHEMICAL_NODE:
+            data = internString(static_cast<ChemicalNode*>(node)->getFormula());
+            break;
+        case NODE::NUMBER_NODE: {
+            NumberNode* number = static_cast<NumberNode*>(node);
+            data = numbers.size();
+            numbers.push_back({ number->getNum(), number->getNumType(), number->getPrefix(), number->getUnit() });
+            break;
+        }
+        case NODE::SPECIES_LIST_NODE: {
+            SpeciesListNode* list = static_cast<SpeciesListNode*>(node);
+            data = coefficients.size();
+            slots = list->size();
+            for (size_t i = 0; i < list->size(); i++) {
+                coefficients.push_back(list->getCoefficient(i));
+            }
+            break;
+        }
+        default:
+            break;
+    }
+
+    if (nodeIsA(nodeType, NODE::TERNARY_NODE)) {
+        slots = 3;
+    } else if (nodeIsA(nodeType, NODE::BINARY_NODE)) {
+        slots = 2;
+    } else if (nodeIsA(nodeType, NODE::UNARY_NODE)) {
+        slots = 1;
+    }
+
+    kinds.push_back(static_cast<uint8_t>(nodeType));
+    subtags.push_back(subtag);
+    aux.push_back(extra);
+    lines.push_back(node->getLine());
+    cols.push_back(node->getCol());
+    firstChild.push_back(childList.size());
+    childCount.push_back(slots);
+    nextStatement.push_back(NO_NODE);
+    payload.push_back(data);
+    childList.insert(childList.end(), slots, NO_NODE);
+    return index;
+}
+
+FlatIndex FlatAst::lower(ASTNode* tree) {
+    if (tree == nullptr) {
+        return NO_NODE;
+    }
+    // iterative so that neither depth nor statement count uses stack frames
+    std::vector<std::pair<ASTNode*, FlatIndex>> pending;
+    FlatIndex treeIndex = addNode(tree);
+    pending.push_back({ tree, treeIndex });
+
+    while (!pending.empty()) {
+        auto [node, index] = pending.back();
+        pending.pop_back();
+
+        ASTNode* children[3] = { nullptr, nullptr, nullptr };
+        if (SpeciesListNode* list = nodeCast<SpeciesListNode>(node)) {
+            for (uint32_t slot = 0; slot < list->size(); slot++) {
+                FlatIndex childIndex = addNode(list->getSpecies(slot));
+                childList[firstChild[index] + slot] = childIndex;
+                pending.push_back({ list->getSpecies(slot), childIndex });
+            }
+        } else if (TernaryNode* ternary = nodeCast<TernaryNode>(node)) {
+            children[0] = ternary->getLeft();
+            children[1] = ternary->getCenter();
+            children[2] = ternary->getRight();
+        } else if (BinaryNode* binary = nodeCast<BinaryNode>(node)) {
+            children[0] = binary->getLeft();
+            children[1] = binary->getRight();
+        } else if (UnaryNode* unary = nodeCast<UnaryNode>(node)) {
+            children[0] = unary->getChild();
+        }
+
+        for (uint32_t slot = 0; slot < childCount[index] && slot < 3; slot++) {
+            if (children[slot] != nullptr) {
+                FlatIndex childIndex = addNode(children[slot]);
+                childList[firstChild[index] + slot] = childIndex;
+                pending.push_back({ children[slot], childIndex });
+            }
+        }
+        if (node->hasNextStatement && node->getNextStatement() != nullptr) {
+            FlatIndex nextIndex = addNode(node->getNextStatement());
+            nextStatement[index] = nextIndex;
+            pending.push_back({ node->getNextStatement(), nextIndex });
+        }
+    }
+
+    if (root == NO_NODE) {
+        root = treeIndex;
+    }
+    return treeIndex;
+}
+
+FlatIndex FlatAst::append(ASTNode* statement) {
+    FlatIndex index = lower(statement);
+    if (index == NO_NODE) {
+        return NO_NODE;
+    }
+    if (lastStatement != NO_NODE) {
+        nextStatement[lastStatement] = index;
+    }
+    lastStatement = index;
+    while (nextStatement[lastStatement] != NO_NODE) {
+        lastStatement = nextStatement[lastStatement];
+    }
+    return index;
+}
+
+/* Allocates the pointer node for index with its scalar fields set. Children
+   are attached by raise(). */
+ASTNode* FlatAst::makeNode(FlatIndex index, AstArena& arena, const std::vector<int>& nameIds) const {
+    ASTNode* node;
+    switch (static_cast<NODE>(kinds[index])) {
+        case NODE::UNARY_NODE:
+            node = arena.make<UnaryNode>();
+            break;
+        case NODE::BINARY_NODE:
+            node = arena.make<BinaryNode>();
+            break;
+        case NODE::TERNARY_NODE:
+            node = arena.make<TernaryNode>();
+            break;
+        case NODE::NUMBER_NODE: {
+            NumberNode* number = arena.make<NumberNode>();
+            const FlatNumber& value = numbers[payload[index]];
+            number->setNum(value.num);
+            number->setNumType(value.numType);
+            number->setPrefix(value.prefix);
+            number->setUnit(value.unit);
+            node = number;
+            break;
+        }
+        case NODE::SYMBOL_NODE: {
+            SymbolNode* symbol = arena.make<SymbolNode>();
+            symbol->setSymbol(static_cast<SYMBOL>(subtags[index]));
+            node = symbol;
+            break;
+        }
+        case NODE::LOOPING_NODE: {
+            LoopingNode* looping = arena.make<LoopingNode>();
+            looping->setLoopType(static_cast<LOOPING>(subtags[index]));
+            node = looping;
+            break;
+        }
+        case NODE::IF_NODE:
+            node = arena.make<IfNode>();
+            break;
+        case NODE::IF_ELSE_NODE:
+            node = arena.make<IfElseNode>();
+            break;
+        case NODE::IDENTIFIER_NODE: {
+            IdentifierNode* identifier = arena.make<IdentifierNode>();
+            identifier->setName(strings[payload[index]]);
+            identifier->setType(static_cast<IDENTIFIER_TYPE>(subtags[index]));
+            identifier->setPrimitiveType(static_cast<PRIMITIVE_TYPE>(aux[index]));
+            if (nameIds[payload[index]] != -1) {
+                identifier->setResolved({ RESOLVED::NAME, nameIds[payload[index]], nullptr });
+            }
+            node = identifier;
+            break;
+        }
+        case NODE::FUNCTION_NODE: {
+            FunctionNode* function = arena.make<FunctionNode>();
+            function->setName(strings[payload[index]]);
+            function->setFunctionType(static_cast<FUNCTION_TYPE>(subtags[index]));
+            function->setHasParams(aux[index] != 0);
+            node = function;
+            break;
+        }
+        case NODE::CHEMICAL_NODE: {
+            ChemicalNode* chemical = arena.make<ChemicalNode>();
+            chemical->setFormula(strings[payload[index]]);
+            if (nameIds[payload[index]] != -1) {
+                chemical->setResolved({ RESOLVED::NAME, nameIds[payload[index]], nullptr });
+            }
+            node = chemical;
+            break;
+        }
+        case NODE::RETURN_NODE:
+            node = arena.make<ReturnNode>();
+            break;
+        case NODE::KEYWORD_NODE: {
+            KeywordNode* keyword = arena.make<KeywordNode>();
+            keyword->setKeyword(static_cast<KEYWORD>(subtags[index]));
+            keyword->setAllowStatements(aux[index] != 0);
+            node = keyword;
+            break;
+        }
+        case NODE::IMPORT_NODE: {
+            ImportNode* import = arena.make<ImportNode>();
+            import->setImport(static_cast<IMPORT_TYPE>(subtags[index]));
+            node = import;
+            break;
+        }
+        case NODE::PARAM_NODE: {
+            ParamNode* param = arena.make<ParamNode>();
+            param->setParamType(static_cast<PARAM>(subtags[index]));
+            node = param;
+            break;
+        }
+        case NODE::INDEX_NODE:
+            node = arena.make<IndexNode>();
+            break;
+        case NODE::SPECIES_LIST_NODE:
+            node = arena.make<SpeciesListNode>();
+            break;
+        default:
+            node = arena.make<ASTNode>();
+            break;
+    }
+    node->setLine(lines[index]);
+    node->setCol(cols[index]);
+    return node;
+}
+
+ASTNode* FlatAst::raise(FlatIndex index, AstArena& arena, const std::vector<int>& nameIds) const {
+    if (index == NO_NODE) {
+        return nullptr;
+    }
+    // iterative, like lower()
+    ASTNode* statement = makeNode(index, arena, nameIds);
+    std::vector<std::pair<FlatIndex, ASTNode*>> pending;
+    pending.push_back({ index, statement });
+
+    while (!pending.empty()) {
+        auto [parentIndex, parent] = pending.back();
+        pending.pop_back();
+
+        for (uint32_t slot = 0; slot < childCount[parentIndex]; slot++) {
+            FlatIndex childIndex = childList[firstChild[parentIndex] + slot];
+            if (childIndex == NO_NODE) {
+                continue;
+            }
+            ASTNode* child = makeNode(childIndex, arena, nameIds);
+            if (SpeciesListNode* list = nodeCast<SpeciesListNode>(parent)) {
+                list->addSpecies(child, coefficients[payload[parentIndex] + slot]);
+            } else if (TernaryNode* ternary = nodeCast<TernaryNode>(parent)) {
+                if (slot == 0) {
+                    ternary->setLeft(child);
+                } else if (slot == 1) {
+                    ternary->setCenter(child);
+                } else {
+                    ternary->setRight(child);
+                }
+            } else if (BinaryNode* binary = nodeCast<BinaryNode>(parent)) {
+                if (slot == 0) {
+                    binary->setLeft(child);
+                } else {
+                    binary->setRight(child);
+                }
+            } else if (UnaryNode* unary = nodeCast<UnaryNode>(parent)) {
+                unary->setChild(child);
+            }
+            pending.push_back({ childIndex, child });
+        }
+        // statements nested in a block keep their chain; the raised statement itself does not
+        if (parent != statement && nextStatement[parentIndex] != NO_NODE) {
+            ASTNode* next = makeNode(nextStatement[parentIndex], arena, nameIds);
+            parent->setNextStatement(next);
+            pending.push_back({ nextStatement[parentIndex], next });
+        }
+    }
+    return statement;
+}
+
+void FlatAst::printNodes() const {
+    std::cout << "+ Flat AST: " << size() << " nodes, " << memoryUsage() << " bytes" << std::endl;
+    for (FlatIndex i = 0; i < size(); i++) {
+        std::cout << i << ": kind " << (int) kinds[i] << ", subtag " << (int) subtags[i];
+        std::cout << " <" << lines[i] << ", " << cols[i] << "> children [";
+        for (uint32_t slot = 0; slot < childCount[i]; slot++) {
+            FlatIndex child = childList[firstChild[i] + slot];
+            std::cout << (slot ? " " : "") << (child == NO_NODE ? -1 : (long) child);
+        }
+        std::cout << "]";
+        if (nextStatement[i] != NO_NODE) {
+            std::cout << " next " << nextStatement[i];
+        }
+        std::cout << std::endl;
+    }
+}
+
+/* Flat node view helper methods */
+FlatNodeView::FlatNodeView(const FlatAst* newAst, FlatIndex newIndex) :
+    ast(newAst),
+    index(newIndex) {}
+
+FlatIndex FlatNodeView::getIndex() const {
+    return index;
+}
+
+bool FlatNodeView::isNull() const {
+    return index == NO_NODE;
+}
+
+NODE FlatNodeView::getNodeType() const {
+    return static_cast<NODE>(ast->kinds[index]);
+}
+
+int FlatNodeView::getLine() const {
+    return ast->lines[index];
+}
+
+ColumnNumber FlatNodeView::getCol() const {
+    return ast->cols[index];
+}
+
+bool FlatNodeView::hasNextStatement() const {
+    return ast->nextStatement[index] != NO_NODE;
+}
+
+FlatNodeView FlatNodeView::getNextStatement() const {
+    return FlatNodeView(ast, ast->nextStatement[index]);
+}
+
+size_t FlatNodeView::getChildCount() const {
+    return ast->childCount[index];
+}
+
+FlatNodeView FlatNodeView::getChildAt(size_t slot) const {
+    if (slot >= ast->childCount[index]) {
+        return FlatNodeView(ast, NO_NODE);
+    }
+    return FlatNodeView(ast, ast->childList[ast->firstChild[index] + slot]);
+}
+
+FlatNodeView FlatNodeView::getChild() const {
+    return getChildAt(0);
+}
+
+FlatNodeView FlatNodeView::getLeft() const {
+    return getChildAt(0);
+}
+
+FlatNodeView FlatNodeView::getCenter() const {
+    return getChildAt(1);
+}
+
+FlatNodeView FlatNodeView::getRight() const {
+    // right is the last slot of both binary and ternary nodes
+    return getChildAt(getChildCount() - 1);
+}
+
+SYMBOL FlatNodeView::getSymbol() const {
+    return static_cast<SYMBOL>(ast->subtags[index]);
+}
+
+KEYWORD FlatNodeView::getKeyword() const {
+    return static_cast<KEYWORD>(ast->subtags[index]);
+}
+
+PARAM FlatNodeView::getParamType() const {
+    return static_cast<PARAM>(ast->subtags[index]);
+}
+
+LOOPING FlatNodeView::getLoopType() const {
+    return static_cast<LOOPING>(ast->subtags[index]);
+}
+
+IMPORT_TYPE FlatNodeView::getImport() const {
+    return static_cast<IMPORT_TYPE>(ast->subtags[index]);
+}
+
+IDENTIFIER_TYPE FlatNodeView::getIdentifierType() const {
+    return static_cast<IDENTIFIER_TYPE>(ast->subtags[index]);
+}
+
+PRIMITIVE_TYPE FlatNodeView::getPrimitiveType() const {
+    return static_cast<PRIMITIVE_TYPE>(ast->aux[index]);
+}
+
+FUNCTION_TYPE FlatNodeView::getFunctionType() const {
+    return static_cast<FUNCTION_TYPE>(ast->subtags[index]);
+}
+
+int FlatNodeView::getCoefficient(size_t slot) const {
+    return ast->coefficients[ast->payload[index] + slot];
+}
+
+bool FlatNodeView::statementsAllowed() const {
+    return ast->aux[index] != 0;
+}
+
+bool FlatNodeView::hasParams() const {
+    return ast->aux[index] != 0;
+}
+
+const std::string& FlatNodeView::getName() const {
+    return ast->strings[ast->payload[index]];
+}
+
+uint32_t FlatNodeView::getNameIndex() const {
+    return ast->payload[index];
+}
+
+double FlatNodeView::getNum() const {
+    return ast->numbers[ast->payload[index]].num;
+}
+
+NUMBER FlatNodeView::getNumType() const {
+    return ast->numbers[ast->payload[index]].numType;
+}
+
+PREFIX FlatNodeView::getPrefix() const {
+    return ast->numbers[ast->payload[index]].prefix;
+}
+
+UNIT FlatNodeView::getUnit() const {
+    return ast->numbers[ast->payload[index]].unit;
+}
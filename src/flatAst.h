@@ -0,0 +1,138 @@
+#pragma once
+
+#include "ast.h"
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/*  Flat AST:
+    --------------------------------------
+    Structure-of-arrays form of a parsed tree. Every node is a 32-bit index
+    into parallel arrays, so a node costs ~24 bytes instead of a heap object
+    with a vtable, a std::string and raw child pointers, and whole-tree passes
+    are linear scans over contiguous memory.
+
+        kinds[i]          NODE tag
+        subtags[i]        SYMBOL / KEYWORD / PARAM / LOOPING / IMPORT /
+                          IDENTIFIER_TYPE / FUNCTION_TYPE of the node
+        aux[i]            PRIMITIVE_TYPE (identifiers), allowStatements
+                          (keywords), hasParams (functions)
+        lines[i], cols[i] source position
+        firstChild[i]     offset into childList; the node's children are
+                          childList[firstChild .. firstChild + childCount)
+        childCount[i]     number of child slots (a slot may be NO_NODE)
+        nextStatement[i]  index of the next statement or NO_NODE
+        payload[i]        index into numbers (NUMBER_NODE), into the
+                          interned strings (identifier, function, chemical)
+                          or of the first coefficient (SPECIES_LIST_NODE)
+
+    Child slots keep the layout of the pointer tree: unary nodes have one,
+    binary nodes two (left, right) and ternary nodes three
+    (left, center, right). A species list has one slot per species, and its
+    coefficients are coefficients[payload .. payload + childCount).
+    A FlatNodeView gives the familiar ASTNode getters over one index.
+
+    append() lowers one statement at a time, so a parser can stream into the
+    flat arrays without ever holding the whole pointer tree; raise() rebuilds
+    a single statement as pointer nodes for code that still walks ASTNodes.
+*/
+
+typedef uint32_t FlatIndex;
+constexpr FlatIndex NO_NODE = std::numeric_limits<FlatIndex>::max();
+
+struct FlatNumber {
+    double num;
+    NUMBER numType;
+    PREFIX prefix;
+    UNIT unit;
+};
+
+class AstArena;
+class FlatAst;
+
+class FlatNodeView {
+    public:
+        FlatNodeView(const FlatAst* newAst, FlatIndex newIndex);
+        FlatIndex getIndex() const;
+        bool isNull() const;
+        NODE getNodeType() const;
+        int getLine() const;
+        ColumnNumber getCol() const;
+        bool hasNextStatement() const;
+        FlatNodeView getNextStatement() const;
+        size_t getChildCount() const;
+        FlatNodeView getChildAt(size_t slot) const;
+
+        // same meaning as on the pointer tree
+        FlatNodeView getChild() const;      // unary
+        FlatNodeView getLeft() const;       // binary + ternary
+        FlatNodeView getCenter() const;     // ternary
+        FlatNodeView getRight() const;      // binary + ternary
+
+        SYMBOL getSymbol() const;
+        KEYWORD getKeyword() const;
+        PARAM getParamType() const;
+        LOOPING getLoopType() const;
+        IMPORT_TYPE getImport() const;
+        IDENTIFIER_TYPE getIdentifierType() const;
+        PRIMITIVE_TYPE getPrimitiveType() const;
+        FUNCTION_TYPE getFunctionType() const;
+        int getCoefficient(size_t slot) const;     // species list
+        bool statementsAllowed() const;
+        bool hasParams() const;
+        const std::string& getName() const;     // identifier, function, chemical formula
+        uint32_t getNameIndex() const;          // index of getName() among the interned strings
+        double getNum() const;
+        NUMBER getNumType() const;
+        PREFIX getPrefix() const;
+        UNIT getUnit() const;
+    private:
+        const FlatAst* ast;
+        FlatIndex index;
+};
+
+class FlatAst {
+    public:
+        FlatAst();
+        // Lowers the statement chain starting at root. Returns the index of root.
+        FlatIndex lower(ASTNode* root);
+        // Lowers the statement chain starting at statement and links it after the last one. Returns its index.
+        FlatIndex append(ASTNode* statement);
+        /* Rebuilds the statement at index (not the statements after it) as
+           pointer nodes in arena. Identifiers and chemicals are bound to the
+           name ID nameIds[getNameIndex()] when it is not -1. */
+        ASTNode* raise(FlatIndex index, AstArena& arena, const std::vector<int>& nameIds) const;
+        void clear();
+        size_t size() const;
+        size_t stringCount() const;
+        size_t memoryUsage() const;
+        FlatIndex getRoot() const;
+        FlatNodeView view(FlatIndex index) const;
+        void printNodes() const;
+
+    private:
+        friend class FlatNodeView;
+
+        FlatIndex addNode(ASTNode* node);
+        ASTNode* makeNode(FlatIndex index, AstArena& arena, const std::vector<int>& nameIds) const;
+        uint32_t internString(const std::string& text);
+
+        std::vector<uint8_t> kinds;
+        std::vector<uint8_t> subtags;
+        std::vector<uint8_t> aux;
+        std::vector<uint32_t> lines;
+        std::vector<uint32_t> cols;
+        std::vector<uint32_t> firstChild;
+        std::vector<uint32_t> childCount;
+        std::vector<FlatIndex> nextStatement;
+        std::vector<uint32_t> payload;
+
+        std::vector<FlatIndex> childList;
+        std::vector<FlatNumber> numbers;
+        std::vector<int32_t> coefficients;
+        std::vector<std::string> strings;
+        std::unordered_map<std::string, uint32_t> stringIndex;
+        FlatIndex root;
+        FlatIndex lastStatement;    // last top-level statement, followed by append()
+};
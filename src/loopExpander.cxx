@@ -0,0 +1,374 @@
+#include "loopExpander.h"
+#include "walker.h"
+#include "error.h"
+
+#include <cmath>
+
+static ASTNode* nextOf(ASTNode* statement) {
+    return statement->hasNextStatement ? statement->getNextStatement() : nullptr;
+}
+
+static bool isArrow(SymbolNode* symbol) {
+    switch (symbol->getSymbol()) {
+        case SYMBOL::FORWARD:
+        case SYMBOL::BACKWARD:
+        case SYMBOL::REVERSIBLE:
+        case SYMBOL::INHIBITION:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// true if a keyword statement (reaction, protein, ...) is nested anywhere in node
+static bool declaresAnything(ASTNode* node) {
+    bool found = false;
+    ASTWalker().walk(node, [&found](ASTNode* visited, int depth, bool fromNextStatement) {
+        found = found || visited->getNodeType() == NODE::KEYWORD_NODE;
+        return !found;
+    });
+    return found;
+}
+
+LoopExpander::LoopExpander(AstArena& newArena, Scope* newScope) :
+    arena(newArena),
+    scope(newScope),
+    first(nullptr),
+    last(nullptr) {}
+
+ASTNode* LoopExpander::expand(ASTNode* statement, ASTNode** lastStatement) {
+    first = nullptr;
+    last = nullptr;
+    if (statement != nullptr) {
+        expandTopLevel(statement);
+    }
+    *lastStatement = last;
+    return first;
+}
+
+ASTNode* LoopExpander::expandAll(ASTNode* statements) {
+    first = nullptr;
+    last = nullptr;
+    while (statements != nullptr) {
+        // emit() relinks the statement, so step past it first
+        ASTNode* next = nextOf(statements);
+        expandTopLevel(statements);
+        statements = next;
+    }
+    return first;
+}
+
+void LoopExpander::expandTopLevel(ASTNode* statement) {
+    LoopingNode* loop = nodeCast<LoopingNode>(statement);
+    if (loop != nullptr && declaresAnything(loop)) {
+        expandLoop(loop);
+    } else {
+        emit(instantiate(statement, false));
+    }
+}
+
+void LoopExpander::expandStatements(ASTNode* statements) {
+    for (; statements != nullptr; statements = nextOf(statements)) {
+        expandStatement(statements);
+    }
+}
+
+/* One statement of a loop body, in the current iteration. */
+void LoopExpander::expandStatement(ASTNode* statement) {
+    if (LoopingNode* loop = nodeCast<LoopingNode>(statement)) {
+        expandLoop(loop);
+    }
+    else if (IfElseNode* ifElse = nodeCast<IfElseNode>(statement)) {
+        expandStatements(condition(ifElse->getLeft()) ? ifElse->getCenter() : ifElse->getRight());
+    }
+    else if (IfNode* ifNode = nodeCast<IfNode>(statement)) {
+        if (condition(ifNode->getLeft())) {
+            expandStatements(ifNode->getRight());
+        }
+    }
+    else if (isPrimitiveAssignment(statement)) {
+        execute(static_cast<SymbolNode*>(statement));
+    }
+    else if (statement->getNodeType() == NODE::AST_NODE) {
+        // <empty block>
+    }
+    else {
+        ASTNode* instance = instantiate(statement, false);
+        // every instance is linked into the statement chain, so none can be shared
+        emit(instance == statement ? copyNode(statement) : instance);
+    }
+}
+
+void LoopExpander::expandLoop(LoopingNode* loop) {
+    ASTNode* test = loop->getLeft();
+    ASTNode* body = loop->getRight();
+    ASTNode* increment = nullptr;
+    if (loop->getLoopType() == LOOPING::FOR) {
+        // for (declaration; condition; increment) is parsed as
+        // declaration + if-else(condition, body, increment)
+        IfElseNode* runOrIncrement = nodeCast<IfElseNode>(loop->getRight());
+        if (runOrIncrement == nullptr) {
+            error("Malformed for loop on line " + std::to_string(loop->getLine()) + ".\n");
+        }
+        expandStatements(loop->getLeft());
+        test = runOrIncrement->getLeft();
+        body = runOrIncrement->getCenter();
+        increment = runOrIncrement->getRight();
+    }
+
+    iterations.push_back(0);
+    while (condition(test)) {
+        expandStatements(body);
+        expandStatements(increment);
+        if (++iterations.back() >= MAX_ITERATIONS) {
+            error("Loop on line " + std::to_string(loop->getLine()) + " did not finish after " +
+                  std::to_string(MAX_ITERATIONS) + " iterations.\n");
+        }
+    }
+    iterations.pop_back();
+}
+
+bool LoopExpander::condition(ASTNode* expression) {
+    return expression->evaluate(scope).num != 0;
+}
+
+bool LoopExpander::isPrimitiveAssignment(ASTNode* statement) {
+    SymbolNode* symbol = nodeCast<SymbolNode>(statement);
+    if (symbol == nullptr || symbol->getSymbol() != SYMBOL::ASSIGNMENT) {
+        return false;
+    }
+    IdentifierNode* identifier = nodeCast<IdentifierNode>(symbol->getLeft());
+    int slot;
+    return identifier != nullptr && primitiveScope(identifier, &slot) != NULL;
+}
+
+void LoopExpander::execute(SymbolNode* assignment) {
+    IdentifierNode* identifier = static_cast<IdentifierNode*>(assignment->getLeft());
+    int slot;
+    Scope* variableScope = primitiveScope(identifier, &slot);
+    variableScope->putVal(variableScope->getSymbolName(slot), assignment->getRight()->evaluate(scope).num);
+}
+
+void LoopExpander::emit(ASTNode* statement) {
+    statement->setNextStatement(nullptr);
+    statement->hasNextStatement = false;
+    if (last == nullptr) {
+        first = statement;
+    } else {
+        last->setNextStatement(statement);
+    }
+    last = statement;
+}
+
+ASTNode* LoopExpander::instantiate(ASTNode* node, bool speciesPosition) {
+    if (node == nullptr) {
+        return nullptr;
+    }
+    switch (node->getNodeType()) {
+        case NODE::IDENTIFIER_NODE: {
+            IdentifierNode* identifier = static_cast<IdentifierNode*>(node);
+            int slot;
+            Scope* variableScope;
+            if (speciesPosition || iterations.empty() ||
+                (variableScope = primitiveScope(identifier, &slot)) == NULL) {
+                return node;
+            }
+            NumberNode* number = arena.make<NumberNode>();
+            double value = std::get<double>(variableScope->getSymbolValue(slot));
+            number->setNum(value);
+            number->setNumType(std::floor(value) == value ? NUMBER::INTEGER : NUMBER::FLOAT);
+            number->setLine(node->getLine());
+            number->setCol(node->getCol());
+            return number;
+        }
+        case NODE::INDEX_NODE: {
+            if (speciesPosition) {
+                return instantiateName(node, false);
+            }
+            // time index of an assignment, ie. A[t] = ...
+            break;
+        }
+        case NODE::KEYWORD_NODE: {
+            KeywordNode* keyword = static_cast<KeywordNode*>(node);
+            // complex declarations and patterns are text, with no names to index
+            if (keyword->getKeyword() == KEYWORD::COMPLEX) {
+                return node;
+            }
+            ASTNode* name = instantiateName(keyword->getLeft(), true);
+            ASTNode* body = instantiateChain(keyword->getRight(), false);
+            if (name == keyword->getLeft() && body == keyword->getRight()) {
+                return node;
+            }
+            KeywordNode* copy = static_cast<KeywordNode*>(copyNode(node));
+            copy->setLeft(name);
+            copy->setRight(body);
+            return copy;
+        }
+        case NODE::SPECIES_LIST_NODE: {
+            SpeciesListNode* list = static_cast<SpeciesListNode*>(node);
+            SpeciesListNode* copy = nullptr;
+            for (size_t i = 0; i < list->size(); i++) {
+                ASTNode* species = instantiate(list->getSpecies(i), true);
+                if (species != list->getSpecies(i)) {
+                    if (copy == nullptr) {
+                        copy = static_cast<SpeciesListNode*>(copyNode(node));
+                    }
+                    copy->setSpecies(i, species);
+                }
+            }
+            return copy != nullptr ? copy : node;
+        }
+        default:
+            break;
+    }
+
+    if (TernaryNode* ternary = nodeCast<TernaryNode>(node)) {
+        ASTNode* left = instantiateChain(ternary->getLeft(), false);
+        ASTNode* center = instantiateChain(ternary->getCenter(), false);
+        ASTNode* right = instantiateChain(ternary->getRight(), false);
+        if (left == ternary->getLeft() && center == ternary->getCenter() && right == ternary->getRight()) {
+            return node;
+        }
+        TernaryNode* copy = static_cast<TernaryNode*>(copyNode(node));
+        copy->setLeft(left);
+        copy->setCenter(center);
+        copy->setRight(right);
+        return copy;
+    }
+    if (BinaryNode* binary = nodeCast<BinaryNode>(node)) {
+        // both sides of a chemical equation are species
+        SymbolNode* symbol = nodeCast<SymbolNode>(node);
+        bool species = symbol != nullptr && isArrow(symbol);
+        ASTNode* left = instantiateChain(binary->getLeft(), species);
+        ASTNode* right = instantiateChain(binary->getRight(), species);
+        if (left == binary->getLeft() && right == binary->getRight()) {
+            return node;
+        }
+        BinaryNode* copy = static_cast<BinaryNode*>(copyNode(node));
+        copy->setLeft(left);
+        copy->setRight(right);
+        return copy;
+    }
+    if (UnaryNode* unary = nodeCast<UnaryNode>(node)) {
+        ASTNode* child = instantiateChain(unary->getChild(), false);
+        if (child == unary->getChild()) {
+            return node;
+        }
+        UnaryNode* copy = static_cast<UnaryNode*>(copyNode(node));
+        copy->setChild(child);
+        return copy;
+    }
+    return node;
+}
+
+/* Children such as parameter lists are statement chains; if any link changes,
+   the links before it are copied too so that the new chain can be relinked. */
+ASTNode* LoopExpander::instantiateChain(ASTNode* node, bool speciesPosition) {
+    if (node == nullptr || nextOf(node) == nullptr) {
+        return instantiate(node, speciesPosition);
+    }
+    std::vector<ASTNode*> originals;
+    std::vector<ASTNode*> instances;
+    bool changed = false;
+    for (ASTNode* link = node; link != nullptr; link = nextOf(link)) {
+        originals.push_back(link);
+        instances.push_back(instantiate(link, speciesPosition));
+        changed = changed || instances.back() != link;
+    }
+    if (!changed) {
+        return node;
+    }
+    for (size_t i = 0; i < instances.size(); i++) {
+        if (instances[i] == originals[i]) {
+            instances[i] = copyNode(originals[i]);
+        }
+        if (i > 0) {
+            instances[i - 1]->setNextStatement(instances[i]);
+        }
+    }
+    return instances.front();
+}
+
+/* R[i] -> R[3] in species and declaration name positions; inside a loop, a
+   declaration name without an index gets the current iterations appended. */
+ASTNode* LoopExpander::instantiateName(ASTNode* name, bool declaration) {
+    std::string newName;
+    ASTNode* base = name;
+    if (IndexNode* index = nodeCast<IndexNode>(name)) {
+        base = index->getLeft();
+        std::string baseName;
+        if (IdentifierNode* identifier = nodeCast<IdentifierNode>(base)) {
+            baseName = identifier->getName();
+        } else if (ChemicalNode* chemical = nodeCast<ChemicalNode>(base)) {
+            baseName = chemical->getFormula();
+        } else {
+            error("Only species and declaration names can be indexed (line " + std::to_string(name->getLine()) + ").\n");
+        }
+        newName = indexedName(baseName, index->getRight());
+    } else if (IdentifierNode* identifier = nodeCast<IdentifierNode>(name);
+               identifier != nullptr && declaration && !iterations.empty()) {
+        newName = identifier->getName();
+        for (long iteration : iterations) {
+            newName += "[" + std::to_string(iteration) + "]";
+        }
+    } else {
+        return name;
+    }
+
+    ASTNode* named = copyNode(base);
+    named->setText(newName);
+    if (IdentifierNode* identifier = nodeCast<IdentifierNode>(named)) {
+        identifier->setName(newName);
+        identifier->setResolved(ResolvedSlot());
+    } else {
+        ChemicalNode* chemical = static_cast<ChemicalNode*>(named);
+        chemical->setFormula(newName);
+        chemical->setResolved(ResolvedSlot());
+    }
+    return named;
+}
+
+std::string LoopExpander::indexedName(const std::string& base, ASTNode* index) {
+    Quantity value = index->evaluate(scope);
+    if (value.unit != UNIT::NO_UNIT || !std::isfinite(value.num) || std::floor(value.num) != value.num) {
+        error("Index of " + base + " on line " + std::to_string(index->getLine()) + " must be a whole number.\n");
+    }
+    return base + "[" + std::to_string(static_cast<long long>(value.num)) + "]";
+}
+
+ASTNode* LoopExpander::copyNode(ASTNode* node) {
+    switch (node->getNodeType()) {
+        case NODE::AST_NODE:            return arena.make<ASTNode>(*node);
+        case NODE::UNARY_NODE:          return arena.make<UnaryNode>(*static_cast<UnaryNode*>(node));
+        case NODE::BINARY_NODE:         return arena.make<BinaryNode>(*static_cast<BinaryNode*>(node));
+        case NODE::TERNARY_NODE:        return arena.make<TernaryNode>(*static_cast<TernaryNode*>(node));
+        case NODE::LOOPING_NODE:        return arena.make<LoopingNode>(*static_cast<LoopingNode*>(node));
+        case NODE::IF_NODE:             return arena.make<IfNode>(*static_cast<IfNode*>(node));
+        case NODE::IF_ELSE_NODE:        return arena.make<IfElseNode>(*static_cast<IfElseNode*>(node));
+        case NODE::NUMBER_NODE:         return arena.make<NumberNode>(*static_cast<NumberNode*>(node));
+        case NODE::SYMBOL_NODE:         return arena.make<SymbolNode>(*static_cast<SymbolNode*>(node));
+        case NODE::IDENTIFIER_NODE:     return arena.make<IdentifierNode>(*static_cast<IdentifierNode*>(node));
+        case NODE::FUNCTION_NODE:       return arena.make<FunctionNode>(*static_cast<FunctionNode*>(node));
+        case NODE::PARAM_NODE:          return arena.make<ParamNode>(*static_cast<ParamNode*>(node));
+        case NODE::RETURN_NODE:         return arena.make<ReturnNode>(*static_cast<ReturnNode*>(node));
+        case NODE::CHEMICAL_NODE:       return arena.make<ChemicalNode>(*static_cast<ChemicalNode*>(node));
+        case NODE::KEYWORD_NODE:        return arena.make<KeywordNode>(*static_cast<KeywordNode*>(node));
+        case NODE::IMPORT_NODE:         return arena.make<ImportNode>(*static_cast<ImportNode*>(node));
+        case NODE::INDEX_NODE:          return arena.make<IndexNode>(*static_cast<IndexNode*>(node));
+        case NODE::SPECIES_LIST_NODE:   return arena.make<SpeciesListNode>(*static_cast<SpeciesListNode*>(node));
+    }
+    error("Cannot copy node " + node->getText() + ".\n");
+}
+
+Scope* LoopExpander::primitiveScope(IdentifierNode* identifier, int* slot) {
+    ResolvedSlot binding = identifier->getResolved();
+    if (binding.kind != RESOLVED::VARIABLE) {
+        binding.scope = scope != NULL ? scope->resolve(identifier->getName(), &binding.index) : NULL;
+    }
+    if (binding.scope == NULL || binding.scope->getSymbolType(binding.index) != Tokenizer::TYPE_PRIMITIVE ||
+        binding.scope->getSymbolValue(binding.index).index() != 0) {
+        return NULL;
+    }
+    *slot = binding.index;
+    return binding.scope;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "ast.h"
+#include "arena.h"
+#include "scope.h"
+
+#include <string>
+#include <vector>
+
+/*  Loop Expander:
+    --------------------------------------
+    Unrolls loops that declare reactions (or any other keyword statement) at
+    compile time, so that
+
+        for (int i = 0; i < 500; i = i + 1) {
+            reaction bind[i](eq = L + R[i] -> C[i], k = 0.1 * i);
+        }
+
+    reaches context building as 500 reaction statements. Loop headers and if
+    conditions are evaluated against the parser's scopes, and each loop
+    variable is stored back into its slot as the loop runs. Every iteration
+    instantiates the loop body:
+        - primitive variables (int i, ...) in expressions become numbers,
+          which foldConstants() folds afterwards
+        - indexed names, R[i], become plain names, "R[3]", in species and
+          declaration name positions
+        - a declaration without an index is named after the iterations it
+          came from: bind -> bind[3] (nested loops: bind[3][1])
+    Assignments to primitives inside the loop run at compile time and are not
+    emitted.
+
+    Instantiation is copy-on-write: a subtree that mentions no variable and
+    no index is shared by all of its instances, and only the nodes on the
+    path to a substitution are copied.
+
+    Loops that declare nothing are protocol logic and are left in place (see
+    vm.h). Statements outside loops only have their constant indexed names
+    rewritten.
+*/
+
+class LoopExpander {
+    public:
+        LoopExpander(AstArena& newArena, Scope* newScope);
+
+        /* Expands one statement; its next statement is ignored. Returns the
+           first statement of the expansion and sets *last to the last one,
+           both nullptr if the statement expands to nothing. */
+        ASTNode* expand(ASTNode* statement, ASTNode** last);
+        // expands every statement of a chain; returns the new first statement
+        ASTNode* expandAll(ASTNode* statements);
+
+        // per loop, so that a wrong condition fails instead of hanging
+        static constexpr long MAX_ITERATIONS = 1 << 24;
+
+    private:
+        void expandTopLevel(ASTNode* statement);
+        void expandStatements(ASTNode* statements);
+        void expandStatement(ASTNode* statement);
+        void expandLoop(LoopingNode* loop);
+        bool condition(ASTNode* expression);
+        // assignment to an int/float/double variable, run now
+        bool isPrimitiveAssignment(ASTNode* statement);
+        void execute(SymbolNode* assignment);
+        void emit(ASTNode* statement);
+
+        // same node if nothing in it changes
+        ASTNode* instantiate(ASTNode* node, bool speciesPosition);
+        ASTNode* instantiateChain(ASTNode* node, bool speciesPosition);
+        ASTNode* instantiateName(ASTNode* name, bool declaration);
+        ASTNode* copyNode(ASTNode* node);
+        std::string indexedName(const std::string& base, ASTNode* index);
+        // scope holding identifier if it is a primitive variable, else NULL
+        Scope* primitiveScope(IdentifierNode* identifier, int* slot);
+
+        AstArena& arena;
+        Scope* scope;
+        ASTNode* first;
+        ASTNode* last;
+        std::vector<long> iterations;       // current iteration of every loop being expanded, outermost first
+};
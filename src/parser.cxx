@@ -1,55 +1,136 @@
 #include "parser.h"
+#include "loopExpander.h"
+#include "units.h"
 
 #define LPP_FILENAME_OFFSET 3
 
-std::unordered_map<UNIT, PARAM> unitToParam {
-    { UNIT::LITER, PARAM::VOLUME },
-    { UNIT::SEC, PARAM::TIME },
-    { UNIT::MIN, PARAM::TIME },
-    { UNIT::HR, PARAM::TIME },
-    { UNIT::GRAM, PARAM::MASS },
-    { UNIT::CELSIUS, PARAM::TEMP },
-    { UNIT::FAHRENHEIT, PARAM::TEMP },
-    { UNIT::KELVIN, PARAM::TEMP },
-    { UNIT::VOLT, PARAM::VOLTAGE },
-    { UNIT::AMPERE, PARAM::VOLTAGE },
-    { UNIT::MOL, PARAM::MOLS },
-    { UNIT::MOLARITY, PARAM::MOLS },
-    { UNIT::MOLALITY, PARAM::MOLS },
-    // { UNIT::CANDELA, PARAM::BRIGHTNESS },
-    { UNIT::RPM, PARAM::SPEED },
-    { UNIT::GFORCE, PARAM::SPEED },
-};
-
-std::unordered_map<KEYWORD, BLOCK_TYPE> keywordToBlock {
-    { KEYWORD::CONTAINER, BLOCK_TYPE::CONTAINER },
-    { KEYWORD::PROTEIN, BLOCK_TYPE::PROTEIN },
-    { KEYWORD::COMPLEX, BLOCK_TYPE::COMPLEX },
-    { KEYWORD::PROTOCOL, BLOCK_TYPE::PROTOCOL },
-    { KEYWORD::REAGENT, BLOCK_TYPE::REAGENT},
-    { KEYWORD::REACTION, BLOCK_TYPE::REACTION },
-    { KEYWORD::MEMBRANE, BLOCK_TYPE::MEMBRANE },
-    { KEYWORD::PATHWAY, BLOCK_TYPE::PATHWAY },
-    { KEYWORD::PLASM, BLOCK_TYPE::PLASM },
-    { KEYWORD::DOM, BLOCK_TYPE::DOM },
-    { KEYWORD::IMPORT, BLOCK_TYPE::GLOBAL },
-    { KEYWORD::UNINITIALIZED, BLOCK_TYPE::GLOBAL }
-};
+BLOCK_TYPE keywordToBlock(KEYWORD keyword) {
+    switch (keyword) {
+        case KEYWORD::CONTAINER:    return BLOCK_TYPE::CONTAINER;
+        case KEYWORD::PROTEIN:      return BLOCK_TYPE::PROTEIN;
+        case KEYWORD::COMPLEX:      return BLOCK_TYPE::COMPLEX;
+        case KEYWORD::PROTOCOL:     return BLOCK_TYPE::PROTOCOL;
+        case KEYWORD::REAGENT:      return BLOCK_TYPE::REAGENT;
+        case KEYWORD::REACTION:     return BLOCK_TYPE::REACTION;
+        case KEYWORD::MEMBRANE:     return BLOCK_TYPE::MEMBRANE;
+        case KEYWORD::PATHWAY:      return BLOCK_TYPE::PATHWAY;
+        case KEYWORD::PLASM:        return BLOCK_TYPE::PLASM;
+        case KEYWORD::DOM:          return BLOCK_TYPE::DOM;
+        case KEYWORD::IMPORT:
+        case KEYWORD::UNINITIALIZED:
+            break;
+    }
+    return BLOCK_TYPE::GLOBAL;
+}
+
+/* Parameters with a physical meaning only take values of their dimension.
+   Plain numbers are taken to be in canonical units already. */
+static void checkParamDimension(PARAM param, const Quantity& value, Tokenizer::Token* token) {
+    Dimension expected;
+    switch (param) {
+        case PARAM::TIME:       expected = dimensions::TIME; break;
+        case PARAM::MASS:       expected = dimensions::MASS; break;
+        case PARAM::VOLUME:     expected = dimensionOf(UNIT::LITER); break;
+        case PARAM::TEMP:       expected = dimensions::TEMPERATURE; break;
+        case PARAM::VOLTAGE:    expected = dimensionOf(UNIT::VOLT); break;
+        default:
+            return;
+    }
+    if (value.unit != UNIT::NO_UNIT && dimensionOf(value.unit) != expected) {
+        fail("The parameter " + std::string(paramToText(param)) + " cannot be given in " +
+             prefixToText(value.prefix) + unitToText(value.unit) + ".", token);
+    }
+}
 
 // Tree constructor + helper methods
 // Class to parse statements, expressions, and generate a tree
 // Returns a vector of tree roots, where each root represents its own
 // AST (an individual statement)
 // ===========================================================
-Parser::Parser() {}
+Parser::Parser() :
+    prevToken(NULL),
+    curToken(NULL),
+    curScope(NULL),
+    curBlockType(BLOCK_TYPE::GLOBAL),
+    unitSeen(UNIT::NO_UNIT),
+    collector(NULL)
+    {}
 Parser::Parser(Tokenizer::Token* tokenListHead) :
     // sets the current token to the head of passed-in token list
     prevToken(NULL),
     curToken(tokenListHead),
+    curScope(NULL),
     curBlockType(BLOCK_TYPE::GLOBAL),
-    unitSeen(UNIT::NO_UNIT)
+    unitSeen(UNIT::NO_UNIT),
+    collector(NULL)
     {}
 
+Parser::Parser(Tokenizer::Token* tokenListHead, ErrorCollector* newCollector) :
+    prevToken(NULL),
+    curToken(tokenListHead),
+    curScope(NULL),
+    curBlockType(BLOCK_TYPE::GLOBAL),
+    unitSeen(UNIT::NO_UNIT),
+    collector(newCollector) {
+    // a recovering parse stops after a screenful of errors unless the collector has its own limit
+    if (collector != NULL && collector->GetMaxErrors() == 0) {
+        collector->SetMaxErrors(RECOVERING_MAX_ERRORS);
+    }
+}
+
+Parser::~Parser() {
+    for (Scope* scope : scopeTree) {
+        delete scope;
+    }
+}
+
+ASTNode* Parser::parseStatementRecovering() {
+    Tokenizer::Token* start = curToken;
+    if (recoveringCollector == nullptr) {
+        return checkProgress(parseStatement(), start);
+    }
+    Scope* scope = curScope;
+    std::string scopeName = curScopeName;
+    BLOCK_TYPE blockType = curBlockType;
+    try {
+        return checkProgress(parseStatement(), start);
+    }
+    catch (const SyntaxError& syntaxError) {
+        recordError(syntaxError, curToken);
+        // scopes the failed statement opened but never closed stay in the
+        // scope tree (and are freed with it) but are no longer current
+        curScope = scope;
+        curScopeName = scopeName;
+        curBlockType = blockType;
+        resetUnitSeen();
+
+        // panic mode: resynchronize after the statement's ';' or '}'
+        Tokenizer::Token* end = findStatementEnd(start);
+        if (end == start->prev) {
+            // statement starts with a stray closer; skip just that token
+            end = start;
+        }
+        prevToken = end;
+        curToken = end->next;
+        return nullptr;
+    }
+}
+
+/* A statement that yields nothing and consumes nothing would be parsed again
+   forever by the statement loops, so it is a syntax error. */
+ASTNode* Parser::checkProgress(ASTNode* statement, Tokenizer::Token* start) {
+    if (statement == nullptr && curToken == start) {
+        fail("Failed to parse statement.", start);
+    }
+    return statement;
+}
+
+void Parser::recordError(const SyntaxError& syntaxError, Tokenizer::Token* token) {
+    if (!syntaxError.isRecorded()) {
+        recoveringCollector->AddError(token->line, token->column, syntaxError.what());
+    }
+}
+
 ASTNode* Parser::parseStatement() {
     if (checkCurType(Tokenizer::TYPE_IF)) {
         // skip open-paren '('
@@ -65,11 +146,11 @@ ASTNode* Parser::parseStatement() {
         // if we consume "else" (else exists)
         if (checkCurType(Tokenizer::TYPE_ELSE)) {
             ASTNode* right = parseBlock();
-            IfElseNode* ifElseNode = new IfElseNode(curToken, 
+            IfElseNode* ifElseNode = arena.make<IfElseNode>(curToken, 
                                                     left, center, right);
             return ifElseNode;
         } else {
-            IfNode* ifNode = new IfNode();
+            IfNode* ifNode = arena.make<IfNode>();
             ifNode->setText("if");
             ifNode->setType(Tokenizer::TYPE_IF);
             ifNode->setLeft(left);
@@ -91,7 +172,7 @@ ASTNode* Parser::parseStatement() {
                 semicolon();
                 next();
                 // consume increment (ie. i = i + 1)
-                ASTNode* increment = parseAssignment(curToken, IDENTIFIER_TYPE::NON_FUNCTION, false);
+                ASTNode* increment = parseAssignment(curToken, IDENTIFIER_TYPE::NON_FUNCTION);
                 ASTNode* codeBlock = parseBlock();
                 
                 /* Following for-loop tree will be created:
@@ -101,9 +182,9 @@ ASTNode* Parser::parseStatement() {
                                  |          |        |
                          condition     code block    i++
                 */
-                IfElseNode* runOrIncrement = new IfElseNode(curToken,
+                IfElseNode* runOrIncrement = arena.make<IfElseNode>(curToken,
                                                             condition, codeBlock, increment);
-                LoopingNode* forLoop = new LoopingNode(curToken, 
+                LoopingNode* forLoop = arena.make<LoopingNode>(curToken, 
                                                        declaration, runOrIncrement, LOOPING::FOR);
                 return forLoop;
             }
@@ -115,7 +196,7 @@ ASTNode* Parser::parseStatement() {
             // right child is code to execute if true
             ASTNode* condition = parseExpression();
             ASTNode* codeToExecute = parseBlock();
-            LoopingNode* whileLoop = new LoopingNode(curToken, 
+            LoopingNode* whileLoop = arena.make<LoopingNode>(curToken, 
                                                      condition, codeToExecute, LOOPING::WHILE);
             return whileLoop;
         }
@@ -128,7 +209,7 @@ ASTNode* Parser::parseStatement() {
         // 1. identifier
         // 2. literal (number, string)
         print("parsing return...");
-        ReturnNode* returnNode = new ReturnNode(curToken);
+        ReturnNode* returnNode = arena.make<ReturnNode>(curToken);
         ASTNode* valueToReturn = parseExpression();
         // sole child should be identifier/literal AST
         returnNode->setChild(valueToReturn);
@@ -140,13 +221,17 @@ ASTNode* Parser::parseStatement() {
         // left is name of identifier
         // right is body AST (everything between {})
         print("found keyword " + curToken->text);
-        KEYWORD key = keywordTextToType.at(curToken->text);
+        KEYWORD key = translateKeywordType(curToken->text);
+
+        if (key == KEYWORD::COMPLEX) {
+            return parseComplex();
+        }
 
         // parses reaction declaration in format WITHOUT curly braces
         // ie. reaction r1(eq = ..., krev = ...);
         if ((checkCurText("reaction") || checkCurText("protein") ||
              checkCurText("reagent") || checkCurText("container")) && 
-            checkNextNextType(Tokenizer::TYPE_SYMBOL_PAREN_OPEN)) {
+            (checkNextNextType(Tokenizer::TYPE_SYMBOL_PAREN_OPEN) || checkNextNextType(Tokenizer::TYPE_SYMBOL_BRACKET_OPEN))) {
             print("in reaction declaration with ()");
             KeywordNode* reaction = parseReaction();
             reaction->setAllowStatements(false);
@@ -154,12 +239,12 @@ ASTNode* Parser::parseStatement() {
         }
 
         if (consume(Tokenizer::TYPE_IDENTIFIER)) {
-            curBlockType = keywordToBlock.at(key);
+            curBlockType = keywordToBlock(key);
             // must have identifier after keyword
             
             // creating + setting identifier node with name
             std::string name = curToken->text;
-            IdentifierNode* identifierNode = new IdentifierNode(curToken, name);
+            IdentifierNode* identifierNode = arena.make<IdentifierNode>(curToken, name);
             print("found identifier " + curToken->text);
 
             
@@ -191,7 +276,7 @@ ASTNode* Parser::parseStatement() {
             }
                 
             ASTNode* block = parseBlock();  // for both cases
-            KeywordNode* keywordNode = new KeywordNode(curToken, 
+            KeywordNode* keywordNode = arena.make<KeywordNode>(curToken, 
                                                        identifierNode, block, key);
             keywordNode->setKeyword(key);
 
@@ -227,14 +312,26 @@ ASTNode* Parser::parseStatement() {
             next();
             return dotNode;
         }
+        else if (checkNextType(Tokenizer::TYPE_SYMBOL_PAREN_OPEN)) {
+            // initial count of a complex species, ie. EGFR(lig, Y1:off) = 50;
+            Tokenizer::Token* identifierToken = curToken;
+            KeywordNode* pattern = parseComplexPattern();
+            SymbolNode* assignmentNode = parseAssignment(identifierToken, IDENTIFIER_TYPE::NON_FUNCTION);
+            assignmentNode->setLeft(pattern);
+            next();
+            return assignmentNode;
+        }
         else if (checkNextType(Tokenizer::TYPE_SYMBOL_BRACKET_OPEN)) {
             Tokenizer::Token* identifierToken = curToken;
             IndexNode* indexNode = parseIndex();
-            SymbolNode* assignmentNode = parseAssignment(identifierToken, IDENTIFIER_TYPE::NON_FUNCTION, false);
+            SymbolNode* assignmentNode = parseAssignment(identifierToken, IDENTIFIER_TYPE::NON_FUNCTION);
             assignmentNode->setLeft(indexNode);
             next();
             return assignmentNode;
         }
+        // ie. zz ++ ;
+        fail("Failed to parse statement.", curToken);
+        return nullptr;
     }
     else if (checkCurType(Tokenizer::TYPE_PRIMITIVE)) {
         print("parsing primitive...");
@@ -264,6 +361,9 @@ ASTNode* Parser::parseStatement() {
         fail("Failed to parse statement.\n", curToken);
         return nullptr;
     }
+    // a branch above that recognized the statement's first token but not the rest
+    fail("Failed to parse statement.", curToken);
+    return nullptr;
 }
 
 ASTNode* Parser::parseExpression() {
@@ -286,17 +386,34 @@ ASTNode* Parser::parse() {
     }
     
     std::cout << "+ Parsing..." << std::endl;
-    bool first = true;
     // open global scope
     openScope("global");
 
-    ASTNode* root = parseStatement();
-    ASTNode* curNode = root;
+    int errorsBefore = 0;
+    if (collector != NULL) {
+        errorsBefore = collector->GetErrorCount();
+        recoveringCollector = collector;
+    }
 
+    ASTNode* root = nullptr;
+    ASTNode* curNode = nullptr;
     while (curToken->type != Tokenizer::TYPE_END) {
-        ASTNode* nextStatement = parseStatement();
-        curNode->setNextStatement(nextStatement);
-        curNode = curNode->getNextStatement();
+        ASTNode* nextStatement = parseStatementRecovering();
+        if (nextStatement == nullptr) {
+            continue;
+        }
+        if (root == nullptr) {
+            root = nextStatement;
+        } else {
+            curNode->setNextStatement(nextStatement);
+        }
+        curNode = nextStatement;
+    }
+
+    recoveringCollector = nullptr;
+    if (collector != NULL && collector->GetErrorCount() > errorsBefore) {
+        collector->PrintSummary();
+        exit(1);
     }
 
     std::cout << "=================================" << std::endl;
@@ -310,12 +427,11 @@ ASTNode* Parser::parse() {
     std::cout << "in the same scope.\n";
     std::cout << "---------------------------------" << std::endl;
 
-    // evaluate number operations
-    // evaluateOperations(root);
-    root->resetVisited();
+    // unroll loops that declare reaction families, then evaluate number operations
+    root = LoopExpander(arena, curScope).expandAll(root);
+    foldConstants(root);
 
-    root->traverse("", "");
-    root->resetVisited();
+    root->traverse();
     // close global scope
     closeScope("global");
     printScopes();
@@ -323,6 +439,318 @@ ASTNode* Parser::parse() {
     return root;
 }
 
+void Parser::parseStreaming(const std::function<void(ASTNode*)>& consumeStatement) {
+    // empty file or all commented out
+    if (curToken->type == Tokenizer::TYPE_END) {
+        print("ERROR: No tokens to parse. Empty file or all code in file is commented out.\n");
+        exit(1);
+    }
+
+    std::cout << "+ Parsing (streaming)..." << std::endl;
+    openScope("global");
+
+    int errorsBefore = 0;
+    if (collector != NULL) {
+        errorsBefore = collector->GetErrorCount();
+    }
+
+    size_t statements = 0;
+    size_t peakNodes = 0;
+    while (curToken->type != Tokenizer::TYPE_END) {
+        recoveringCollector = collector;
+        ASTNode* last = nullptr;
+        ASTNode* statement = nullptr;
+        Tokenizer::Token* start = curToken;
+        try {
+            statement = LoopExpander(arena, curScope).expand(parseStatementRecovering(), &last);
+            foldConstants(statement);
+        }
+        catch (const SyntaxError& syntaxError) {
+            // expanding or folding the statement failed
+            recordError(syntaxError, start);
+            statement = nullptr;
+        }
+        // the consumer's own errors are not syntax errors and stay fatal
+        recoveringCollector = nullptr;
+        peakNodes = std::max(peakNodes, arena.size());
+        // an expanded loop is handed over one statement at a time; nothing is
+        // handed over once an error was found, as parse() would not build either
+        while (statement != nullptr && (collector == NULL || collector->GetErrorCount() == errorsBefore)) {
+            ASTNode* next = statement != last ? statement->getNextStatement() : nullptr;
+            statement->hasNextStatement = false;
+            consumeStatement(statement);
+            statement = next;
+        }
+        // chunks are kept, so peak memory is bounded by the largest statement
+        arena.reset();
+        statements++;
+    }
+
+    if (collector != NULL && collector->GetErrorCount() > errorsBefore) {
+        collector->PrintSummary();
+        exit(1);
+    }
+
+    closeScope("global");
+    std::cout << "+ Streamed " << statements << " statements (largest statement: "
+              << peakNodes << " nodes)" << std::endl;
+}
+
+Tokenizer::Token* Parser::findStatementEnd(Tokenizer::Token* start) {
+    int depth = 0;
+    Tokenizer::Token* cur = start;
+    while (cur->type != Tokenizer::TYPE_END) {
+        switch (cur->type) {
+            case Tokenizer::TYPE_SYMBOL_PAREN_OPEN:
+            case Tokenizer::TYPE_SYMBOL_CURLY_OPEN:
+            case Tokenizer::TYPE_SYMBOL_BRACKET_OPEN:
+                depth++;
+                break;
+            case Tokenizer::TYPE_SYMBOL_PAREN_CLOSED:
+            case Tokenizer::TYPE_SYMBOL_BRACKET_CLOSED:
+            case Tokenizer::TYPE_SYMBOL_CURLY_CLOSED:
+                if (depth == 0) {
+                    // unmatched closer belongs to an enclosing block
+                    return cur->prev;
+                }
+                depth--;
+                // a block closing back to the top level ends the statement,
+                // unless an else branch follows
+                if (depth == 0 && cur->type == Tokenizer::TYPE_SYMBOL_CURLY_CLOSED &&
+                    cur->next->type != Tokenizer::TYPE_ELSE) {
+                    return cur;
+                }
+                break;
+            case Tokenizer::TYPE_SYMBOL_SEMICOLON:
+                if (depth == 0) {
+                    return cur;
+                }
+                break;
+            default:
+                break;
+        }
+        cur = cur->next;
+    }
+    return cur->prev;
+}
+
+/* Moves the scopes a worker closed while parsing one segment into this parser.
+   closedScopes[firstClosed, endClosed) of the worker are the segment's scopes,
+   the last of which is the worker's stand-in global scope. */
+void Parser::mergeSegmentScopes(size_t firstClosed, size_t endClosed, Parser* worker) {
+    Scope* global = curScope;
+    Scope* segmentGlobal = worker->closedScopes[endClosed - 1].second;
+    for (size_t i = firstClosed; i < endClosed - 1; i++) {
+        auto& [name, scope] = worker->closedScopes[i];
+        if (scope->getParentScope() == segmentGlobal) {
+            scope->setParentScope(true, global);
+            global->addChildScope(scope);
+        }
+        adoptScope(scope, worker);
+        scopes.insert({ name, scope });
+        closedScopes.push_back({ name, scope });
+    }
+    global->putAll(segmentGlobal);
+    worker->scopes.erase("global");
+    worker->scopeTree[segmentGlobal->getId()] = NULL;
+    delete segmentGlobal;
+}
+
+/* Takes ownership of a scope from owner and gives it the next ID here. */
+void Parser::adoptScope(Scope* scope, Parser* owner) {
+    owner->scopeTree[scope->getId()] = NULL;
+    scope->setId(scopeTree.size());
+    scopeTree.push_back(scope);
+}
+
+ASTNode* Parser::parseParallel(unsigned numThreads) {
+    // empty file or all commented out
+    if (curToken->type == Tokenizer::TYPE_END) {
+        print("ERROR: No tokens to parse. Empty file or all code in file is commented out.\n");
+        exit(1);
+    }
+    std::cout << "+ Parsing (parallel)..." << std::endl;
+    openScope("global");
+
+    struct Segment {
+        Tokenizer::Token* start;
+        Tokenizer::Token* end;
+        bool independent;
+        ASTNode* statement;
+        ASTNode* last;          // last statement of the segment's loop expansion
+        Parser* worker;
+        size_t firstClosed;
+        size_t endClosed;
+        ErrorCollector errors{ 0, false };      // kept until they can be reported in source order
+    };
+
+    // split the token stream at top-level statement boundaries
+    std::vector<Segment> segments;
+    size_t independentCount = 0;
+    for (Tokenizer::Token* start = curToken; start->type != Tokenizer::TYPE_END; ) {
+        Tokenizer::Token* end = findStatementEnd(start);
+        bool independent = start->type == Tokenizer::TYPE_KEYWORD;
+        independentCount += independent;
+        segments.push_back({ start, end, independent, nullptr, nullptr, nullptr, 0, 0 });
+        start = end->next;
+    }
+    Scope* global = curScope;
+
+    // each worker keeps its own parser
+    numThreads = std::max(1u, std::min<unsigned>(numThreads, independentCount));
+    for (unsigned i = 0; i < numThreads; i++) {
+        workerParsers.push_back(std::make_unique<Parser>(curToken));
+    }
+
+    // failures are thrown back here instead of exiting on a worker thread
+    auto parseSegment = [&](Segment& segment, Parser* worker) {
+        recoveringCollector = &segment.errors;
+        worker->prevToken = segment.start->prev;
+        worker->curToken = segment.start;
+        worker->curBlockType = BLOCK_TYPE::GLOBAL;
+        segment.firstClosed = worker->closedScopes.size();
+        worker->curScope = NULL;
+        worker->openScope("global");
+        Scope* segmentGlobal = worker->curScope;
+        // lookups fall through to the shared global scope, but the worker
+        // never adds itself as one of its children
+        segmentGlobal->setParentScope(true, global);
+        try {
+            segment.statement = LoopExpander(worker->arena, segmentGlobal).expand(worker->parseStatementRecovering(), &segment.last);
+            // folded before the merge deletes the worker's global scope
+            worker->foldConstants(segment.statement);
+            if (worker->curToken != segment.end->next) {
+                fail("Parallel parse found a statement that does not end where expected.", segment.start);
+            }
+        }
+        catch (const SyntaxError& syntaxError) {
+            recordError(syntaxError, segment.start);
+            segment.statement = nullptr;
+            worker->curScope = segmentGlobal;
+            worker->curScopeName = "global";
+            worker->resetUnitSeen();
+        }
+        worker->closeScope("global");
+        worker->curScope = NULL;
+        segment.endClosed = worker->closedScopes.size();
+        segment.worker = worker;
+        recoveringCollector = nullptr;
+    };
+
+    /* Keyword declarations between two other statements are parsed
+       concurrently while this thread waits, so the global scope is read-only
+       and each declaration sees exactly the globals declared before it.
+       Declarations only add their own names, which are not numeric, so
+       one in the same batch cannot change what another evaluates. */
+    std::vector<size_t> batch;
+    auto parseBatch = [&]() {
+        if (batch.empty()) {
+            return;
+        }
+        std::atomic<size_t> nextSegment{0};
+        auto work = [&](Parser* worker) {
+            for (size_t i = nextSegment++; i < batch.size(); i = nextSegment++) {
+                parseSegment(segments[batch[i]], worker);
+            }
+        };
+        ErrorCollector* callerCollector = recoveringCollector;
+        std::vector<std::thread> threads;
+        for (unsigned i = 1; i < std::min<size_t>(numThreads, batch.size()); i++) {
+            threads.emplace_back(work, workerParsers[i].get());
+        }
+        work(workerParsers[0].get());
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        recoveringCollector = callerCollector;
+        for (size_t i : batch) {
+            mergeSegmentScopes(segments[i].firstClosed, segments[i].endClosed, segments[i].worker);
+        }
+        batch.clear();
+    };
+
+    // with a collector, every error is reported in source order; without one, only the first
+    int errorsBefore = collector != NULL ? collector->GetErrorCount() : 0;
+    size_t reported = 0;
+    auto reportErrors = [&](size_t endSegment) {
+        for (; reported < endSegment; reported++) {
+            const ErrorCollector& errors = segments[reported].errors;
+            if (errors.GetErrorCount() == 0) {
+                continue;
+            }
+            if (collector != NULL) {
+                collector->AddAll(errors);
+                continue;
+            }
+            printf("\033[1;31m");    // format color as red
+            printf("error: %s", errors.GetDiagnostics().front().message.c_str());
+            exit(1);
+        }
+    };
+
+    for (size_t i = 0; i < segments.size(); i++) {
+        Segment& segment = segments[i];
+        if (segment.independent) {
+            batch.push_back(i);
+            continue;
+        }
+        parseBatch();
+        reportErrors(i);
+
+        ErrorCollector* callerCollector = recoveringCollector;
+        recoveringCollector = &segment.errors;
+        prevToken = segment.start->prev;
+        curToken = segment.start;
+        try {
+            segment.statement = LoopExpander(arena, curScope).expand(parseStatementRecovering(), &segment.last);
+            foldConstants(segment.statement);
+        }
+        catch (const SyntaxError& syntaxError) {
+            recordError(syntaxError, segment.start);
+            segment.statement = nullptr;
+        }
+        recoveringCollector = callerCollector;
+        reportErrors(i + 1);
+    }
+    parseBatch();
+    reportErrors(segments.size());
+    if (collector != NULL && collector->GetErrorCount() > errorsBefore) {
+        collector->PrintSummary();
+        exit(1);
+    }
+
+    // link statements in source order
+    ASTNode* root = nullptr;
+    ASTNode* curNode = nullptr;
+    for (Segment& segment : segments) {
+        if (segment.statement == nullptr) {
+            // a loop that ran zero times
+            continue;
+        }
+        if (root == nullptr) {
+            root = segment.statement;
+        } else {
+            curNode->setNextStatement(segment.statement);
+        }
+        curNode = segment.last;
+    }
+    curToken = segments.back().end->next;
+
+    std::cout << "+ Tree successfully parsed! (" << segments.size() << " statements, "
+              << independentCount << " in parallel on " << numThreads << " threads)" << std::endl;
+    closeScope("global");
+    return root;
+}
+
+FlatAst Parser::parseFlat() {
+    FlatAst flat;
+    // each statement is lowered before its nodes are reclaimed, so the pointer tree never exists whole
+    parseStreaming([&flat](ASTNode* statement) {
+        flat.append(statement);
+    });
+    return flat;
+}
+
 bool Parser::checkCur(Tokenizer::TokenType type, std::string text) {
     return curToken->type == type && 
            curToken->text == text;
@@ -455,6 +883,11 @@ ASTNode* Parser::parseTopLevelExpression() {
         ASTNode* parenExp = parseParen();
         return parenExp;
     }
+    else if ((checkNextType(Tokenizer::TYPE_IDENTIFIER) || checkNextType(Tokenizer::TYPE_CHEMICAL)) &&
+             checkNextNextType(Tokenizer::TYPE_SYMBOL_PAREN_OPEN)) {
+        next();
+        return parseComplexPattern();
+    }
     else if (checkNextType(Tokenizer::TYPE_IDENTIFIER)) {
         print("found identifier");
         IdentifierNode* identifier = parseIdentifier();
@@ -482,6 +915,17 @@ ASTNode* Parser::parseTopLevelExpression() {
 ASTNode* Parser::parseBracket() {
     ASTNode* op = parseTopLevelExpression();
     print("brackets");
+    // indexed species, ie. R[i] (R[3] once loops are expanded)
+    bool indexable = op->getNodeType() == NODE::IDENTIFIER_NODE || op->getNodeType() == NODE::CHEMICAL_NODE;
+    if (indexable && consume(Tokenizer::TYPE_SYMBOL_BRACKET_OPEN)) {
+        IndexNode* indexNode = arena.make<IndexNode>(curToken);
+        indexNode->setLeft(op);
+        indexNode->setRight(parseExpression());
+        if (!consume(Tokenizer::TYPE_SYMBOL_BRACKET_CLOSED)) {
+            fail("Closing square bracket not found.", curToken);
+        }
+        return indexNode;
+    }
     return op;
 }
 
@@ -501,7 +945,7 @@ ASTNode* Parser::parseMulDivMod() {
                        checkNextType(Tokenizer::TYPE_SYMBOL_PERCENT);
     
     if (mulDivOrMod) {
-        SymbolNode* symbolNode = new SymbolNode(curToken);
+        SymbolNode* symbolNode = arena.make<SymbolNode>(curToken);
         if (consume(Tokenizer::TYPE_SYMBOL_MULTIPLY)) {
             symbolNode->setSymbol(SYMBOL::MULTIPLY);
         }
@@ -532,7 +976,7 @@ ASTNode* Parser::parseAddSub() {
 
     print("checking add or sub");
     if (addOrSub) {
-        SymbolNode* symbolNode = new SymbolNode(curToken);
+        SymbolNode* symbolNode = arena.make<SymbolNode>(curToken);
         if (consume(Tokenizer::TYPE_SYMBOL_ADD)) {
             print("adding...");
             symbolNode->setSymbol(SYMBOL::ADD);
@@ -570,7 +1014,7 @@ ASTNode* Parser::parseArrow() {
                       checkNextNextType(Tokenizer::TYPE_SYMBOL_SUBTRACT) &&
                       checkNextNextNextType(Tokenizer::TYPE_SYMBOL_OR);
 
-    SymbolNode* arrow = new SymbolNode();
+    SymbolNode* arrow = arena.make<SymbolNode>();
     if (forward) {
         print("forward");
         consume(Tokenizer::TYPE_SYMBOL_SUBTRACT);
@@ -600,33 +1044,69 @@ ASTNode* Parser::parseArrow() {
         arrow->setSymbol(SYMBOL::INHIBITION);
     }
     else {
-        print("deleting arrow..");
-        delete arrow;
         return op;
     }
 
-    arrow->setLeft(op);
-    arrow->setRight(parseAddSub());
+    arrow->setLeft(flattenSpecies(op));
+    arrow->setRight(flattenSpecies(parseAddSub()));
     return arrow;
 }
 
+static bool isSpecies(ASTNode* node) {
+    NODE nodeType = node->getNodeType();
+    if (KeywordNode* keyword = nodeCast<KeywordNode>(node)) {
+        return keyword->getKeyword() == KEYWORD::COMPLEX;
+    }
+    return nodeType == NODE::IDENTIFIER_NODE || nodeType == NODE::CHEMICAL_NODE || nodeType == NODE::INDEX_NODE;
+}
+
+ASTNode* Parser::flattenSpecies(ASTNode* side) {
+    if (isSpecies(side)) {
+        return side;
+    }
+    SpeciesListNode* list = arena.make<SpeciesListNode>();
+    list->setLine(side->getLine());
+    list->setCol(side->getCol());
+
+    // terms of the sum, left to right, without recursing
+    std::vector<ASTNode*> pending = { side };
+    while (!pending.empty()) {
+        ASTNode* term = pending.back();
+        pending.pop_back();
+        SymbolNode* symbol = nodeCast<SymbolNode>(term);
+        if (symbol != nullptr && symbol->getSymbol() == SYMBOL::ADD) {
+            pending.push_back(symbol->getRight());
+            pending.push_back(symbol->getLeft());
+        } else if (symbol != nullptr && symbol->getSymbol() == SYMBOL::MULTIPLY &&
+                   symbol->getLeft()->getNodeType() == NODE::NUMBER_NODE && isSpecies(symbol->getRight())) {
+            NumberNode* coefficient = nodeCast<NumberNode>(symbol->getLeft());
+            list->addSpecies(symbol->getRight(), (int) std::round(coefficient->getNum()));
+        } else if (isSpecies(term)) {
+            list->addSpecies(term, 1);
+        } else {
+            // not a sum of species; left for context building to report
+            return side;
+        }
+    }
+    return list;
+}
+
 ASTNode* Parser::parseSlice() {
     print("slicing...");
-    SymbolNode* slice = new SymbolNode(curToken);
+    SymbolNode* slice = arena.make<SymbolNode>(curToken);
     slice->setSymbol(SYMBOL::COLON);
     ASTNode* op;
-    NumberNode* firstIndex;
 
     // case 1: slice in format [:]
     if (checkNextType(Tokenizer::TYPE_SYMBOL_COLON)) {
         consume(Tokenizer::TYPE_SYMBOL_COLON);
         if (checkNextType(Tokenizer::TYPE_SYMBOL_BRACKET_CLOSED)) {
-            slice->setLeft(new ASTNode());
-            slice->setRight(new ASTNode());
+            slice->setLeft(arena.make<ASTNode>());
+            slice->setRight(arena.make<ASTNode>());
             return slice;
         }
         else {
-            slice->setLeft(new ASTNode());
+            slice->setLeft(arena.make<ASTNode>());
             slice->setRight(parseArrow());
             return slice;
         }
@@ -634,29 +1114,36 @@ ASTNode* Parser::parseSlice() {
     else {
         op = parseArrow();
     }
+
+    // range of a species array, ie. R[0..999]
+    if (consume(Tokenizer::TYPE_SYMBOL_RANGE)) {
+        SymbolNode* range = arena.make<SymbolNode>(curToken);
+        range->setSymbol(SYMBOL::RANGE);
+        range->setLeft(op);
+        range->setRight(parseArrow());
+        return range;
+    }
     
     // case 2: slice in format [0:]
     if (checkNextType(Tokenizer::TYPE_SYMBOL_COLON)) {
         consume(Tokenizer::TYPE_SYMBOL_COLON);
-        
-        firstIndex = op->evaluate(curScope);
+        // evaluated here only to check the index; foldConstants() replaces it later
+        op->evaluate(curScope);
+        slice->setLeft(op);
 
         if (checkNextType(Tokenizer::TYPE_SYMBOL_BRACKET_CLOSED)) {
-            firstIndex = op->evaluate(curScope);
-            slice->setLeft(firstIndex);
-            slice->setRight(new ASTNode());
+            slice->setRight(arena.make<ASTNode>());
             return slice;
         }
         // case 3 (general): slice in format [0:1]
         else {
-            slice->setLeft(firstIndex);
-            NumberNode* secondIndex = parseArrow()->evaluate(curScope);
+            ASTNode* secondIndex = parseArrow();
+            secondIndex->evaluate(curScope);
             slice->setRight(secondIndex);
             return slice;
         }
     }
     else {
-        delete slice;
         return op;
     }
 }
@@ -670,7 +1157,7 @@ ASTNode* Parser::parseLesserGreater() {
                            checkNextType(Tokenizer::TYPE_SYMBOL_GT) ||
                            checkNextType(Tokenizer::TYPE_SYMBOL_LT);
     if (lesserOrGreater) {
-        SymbolNode* symbolNode = new SymbolNode(curToken);
+        SymbolNode* symbolNode = arena.make<SymbolNode>(curToken);
         if (consume(Tokenizer::TYPE_SYMBOL_LEQ)) {
             symbolNode->setSymbol(SYMBOL::LEQ);
         }
@@ -703,7 +1190,7 @@ ASTNode* Parser::parseEq() {
 
 
     if (eq || neq) {
-        SymbolNode* symbolNode = new SymbolNode(curToken);
+        SymbolNode* symbolNode = arena.make<SymbolNode>(curToken);
         if (consume(Tokenizer::TYPE_SYMBOL_EQUAL) && 
             consume(Tokenizer::TYPE_SYMBOL_EQUAL)) {
                 symbolNode->setSymbol(SYMBOL::EQUALS);
@@ -729,7 +1216,7 @@ ASTNode* Parser::parseBitAnd() {
 
 
     if (bitAnd) {
-        SymbolNode* symbolNode = new SymbolNode(curToken);
+        SymbolNode* symbolNode = arena.make<SymbolNode>(curToken);
         if (consume(Tokenizer::TYPE_SYMBOL_EQUAL)) {
             symbolNode->setSymbol(SYMBOL::BIT_AND);
         }
@@ -749,7 +1236,7 @@ ASTNode* Parser::parseBitOr() {
                   !checkNextNextType(Tokenizer::TYPE_SYMBOL_OR);
 
     if (bitOr) {
-        SymbolNode* symbolNode = new SymbolNode(curToken);
+        SymbolNode* symbolNode = arena.make<SymbolNode>(curToken);
         if (consume(Tokenizer::TYPE_SYMBOL_OR)) {
             symbolNode->setSymbol(SYMBOL::BIT_OR);
         }
@@ -769,7 +1256,7 @@ ASTNode* Parser::parseLogiAnd() {
                    checkNextNextType(Tokenizer::TYPE_SYMBOL_AND);
 
     if (logiAnd) {
-        SymbolNode* symbolNode = new SymbolNode(curToken);
+        SymbolNode* symbolNode = arena.make<SymbolNode>(curToken);
         if (consume(Tokenizer::TYPE_SYMBOL_AND) && 
             consume(Tokenizer::TYPE_SYMBOL_AND)) {
             symbolNode->setSymbol(SYMBOL::LOGI_AND);
@@ -790,7 +1277,7 @@ ASTNode* Parser::parseLogiOr() {
                    checkNextNextType(Tokenizer::TYPE_SYMBOL_OR);
 
     if (logiOr) {
-        SymbolNode* symbolNode = new SymbolNode(curToken);
+        SymbolNode* symbolNode = arena.make<SymbolNode>(curToken);
         if (consume(Tokenizer::TYPE_SYMBOL_OR) && 
             consume(Tokenizer::TYPE_SYMBOL_OR)) {
             symbolNode->setSymbol(SYMBOL::LOGI_OR);
@@ -817,17 +1304,24 @@ ASTNode* Parser::parseBlock() {
     next();
     bool first = true;
     // instantiated for if block is empty. 
-    ASTNode* blockStatement = new ASTNode();
+    ASTNode* blockStatement = arena.make<ASTNode>();
     blockStatement->setText("<empty block>");
     ASTNode* curStatement;
     while (!checkCurType(Tokenizer::TYPE_SYMBOL_CURLY_CLOSED)) {
+        if (checkCurType(Tokenizer::TYPE_END)) {
+            fail("Missing closing curly brace '}' at end of block.\n", curToken);
+        }
+        ASTNode* statement = parseStatementRecovering();
+        if (statement == nullptr) {
+            continue;
+        }
         if (first) {
-            blockStatement = parseStatement();
+            blockStatement = statement;
             curStatement = blockStatement; 
             first = false;
         }
         else {
-            curStatement->setNextStatement(parseStatement());
+            curStatement->setNextStatement(statement);
             curStatement = curStatement->getNextStatement();
         }
     }
@@ -842,22 +1336,22 @@ SymbolNode* Parser::inferParam() {
     ASTNode* value = parseExpression();
     PARAM inferredParam = inferUnit(unitSeen);
     
-    ParamNode* param = new ParamNode(curToken, inferredParam);
+    ParamNode* param = arena.make<ParamNode>(curToken, inferredParam);
     if (foundChemical) {
         param->setParamType(PARAM::EQUATION);
         curScope->put("eq", Tokenizer::TYPE_PARAM, "eq");
     } else {
-        curScope->put(paramTypeToText.at(inferredParam), Tokenizer::TYPE_PARAM, value->evaluate(curScope)->getNum());
+        const char* paramName = paramToText(inferredParam);
+        if (*paramName == '\0') {
+            fail("Parameter inferred from its unit cannot be assigned here.", nullptr);
+        }
+        curScope->put(paramName, Tokenizer::TYPE_PARAM, value->evaluate(curScope).num);
     }
 
-    SymbolNode* assignment = new SymbolNode();
+    SymbolNode* assignment = arena.make<SymbolNode>();
     assignment->setSymbol(SYMBOL::ASSIGNMENT);
     assignment->setLeft(param);
-    if (param->getParamType() == PARAM::EQUATION) {
-        assignment->setRight(value);
-    } else {
-        assignment->setRight(value->evaluate(curScope));
-    }
+    assignment->setRight(value);
     
     parseNextParam(assignment);
     resetUnitSeen();
@@ -885,29 +1379,27 @@ SymbolNode* Parser::parseParam() {
             checkNextType(Tokenizer::TYPE_IDENTIFIER) ||
             (checkNextType(Tokenizer::TYPE_INTEGER) && checkNextNextType(Tokenizer::TYPE_IDENTIFIER))) {
             // eliminating need for 'eq' in reactions
-            paramNode = new ParamNode(curToken, PARAM::EQUATION);
+            paramNode = arena.make<ParamNode>(curToken, PARAM::EQUATION);
             paramName = "eq";
         }
         else if (consume(Tokenizer::TYPE_SYMBOL_EQUAL)) {
             consume(Tokenizer::TYPE_SYMBOL_EQUAL);
-            paramNode = new ParamNode(curToken, translateParamType(paramName));   
+            paramNode = arena.make<ParamNode>(curToken, translateParamType(paramName));   
         }
 
         ASTNode* expressionTree = parseExpression();
         if (paramName == "eq") {
             curScope->put(paramName, Tokenizer::TYPE_PARAM, "eq");  
         } else {
-            curScope->put(paramName, Tokenizer::TYPE_PARAM, expressionTree->evaluate(curScope)->getNum());  
+            Quantity value = expressionTree->evaluate(curScope);
+            checkParamDimension(paramNode->getParamType(), value, curToken);
+            curScope->put(paramName, Tokenizer::TYPE_PARAM, value.num);
         }
         
-        SymbolNode* assignmentNode = new SymbolNode(curToken);
+        SymbolNode* assignmentNode = arena.make<SymbolNode>(curToken);
         assignmentNode->setSymbol(SYMBOL::ASSIGNMENT);
         assignmentNode->setLeft(paramNode);
-        if (paramNode->getParamType() == PARAM::EQUATION) {
-            assignmentNode->setRight(expressionTree);
-        } else {
-            assignmentNode->setRight(expressionTree->evaluate(curScope));
-        }
+        assignmentNode->setRight(expressionTree);
         
         parseNextParam(assignmentNode);
 
@@ -945,35 +1437,25 @@ void Parser::parseNextParam(SymbolNode* curParam) {
     }
 }
 
-SymbolNode* Parser::parseAssignment(Tokenizer::Token* identifierToken, IDENTIFIER_TYPE type, bool evaluate, PRIMITIVE_TYPE primitive) {
+SymbolNode* Parser::parseAssignment(Tokenizer::Token* identifierToken, IDENTIFIER_TYPE type, PRIMITIVE_TYPE primitive) {
     // create identifier node + set name variable to curToken text
-    IdentifierNode* identifierNode = new IdentifierNode(identifierToken, identifierToken->text);
+    IdentifierNode* identifierNode = arena.make<IdentifierNode>(identifierToken, identifierToken->text);
     identifierNode->setType(type);
     
     if (consume(Tokenizer::TYPE_SYMBOL_EQUAL)) {
         ASTNode* expressionTree = parseExpression();
-        NumberNode* parsedExpression = expressionTree->evaluate(curScope);
-        SymbolNode* assignmentNode = new SymbolNode();
+        Quantity parsedExpression = expressionTree->evaluate(curScope);
+        SymbolNode* assignmentNode = arena.make<SymbolNode>();
         assignmentNode->setSymbol(SYMBOL::ASSIGNMENT);
         assignmentNode->setLeft(identifierNode);
-
-        if (evaluate) {
-            assignmentNode->setRight(parsedExpression);
-            if (type == IDENTIFIER_TYPE::PRIMITIVE) {
-                identifierNode->setPrimitiveType(primitive);
-                curScope->put(identifierNode->getName(), Tokenizer::TYPE_PRIMITIVE, parsedExpression->getNum());
-            } else {
-                curScope->put(identifierNode->getName(), Tokenizer::TYPE_IDENTIFIER, parsedExpression->getNum());
-            }
-        } else {
-            assignmentNode->setRight(expressionTree);
-        }
+        // the expression stays in the tree until foldConstants() runs
+        assignmentNode->setRight(expressionTree);
 
         if (type == IDENTIFIER_TYPE::PRIMITIVE) {
             identifierNode->setPrimitiveType(primitive);
-            curScope->put(identifierNode->getName(), Tokenizer::TYPE_PRIMITIVE, parsedExpression->getNum());
+            curScope->put(identifierNode->getName(), Tokenizer::TYPE_PRIMITIVE, parsedExpression.num);
         } else {
-            curScope->put(identifierNode->getName(), Tokenizer::TYPE_IDENTIFIER, parsedExpression->getNum());
+            curScope->put(identifierNode->getName(), Tokenizer::TYPE_IDENTIFIER, parsedExpression.num);
         }
         
         if (checkNextType(Tokenizer::TYPE_SYMBOL_PAREN_CLOSED)) {
@@ -1004,11 +1486,11 @@ SymbolNode* Parser::parseFunction() {
             // consume function
             std::string functionName = curToken->text;
             print("consumed function " + functionName);
-            IdentifierNode* identifierNode = new IdentifierNode(curToken, identifierName);
+            IdentifierNode* identifierNode = arena.make<IdentifierNode>(curToken, identifierName);
             identifierNode->setType(IDENTIFIER_TYPE::FUNCTION);
-            SymbolNode* dotNode = new SymbolNode(curToken);
+            SymbolNode* dotNode = arena.make<SymbolNode>(curToken);
             dotNode->setSymbol(SYMBOL::DOT);
-            FunctionNode* functionNode = new FunctionNode(curToken, 
+            FunctionNode* functionNode = arena.make<FunctionNode>(curToken, 
                                                           functionName, FUNCTION_TYPE::INSTANCE);
             
             // functionNode->setReturnType();   // have to determine if void or return
@@ -1021,9 +1503,6 @@ SymbolNode* Parser::parseFunction() {
                 return dotNode;
             }
             else {
-                delete identifierNode;
-                delete dotNode;
-                delete functionNode;
                 fail("Parentheses invalid or not found after function call.\n", curToken);
                 return nullptr;
             }
@@ -1060,7 +1539,7 @@ SymbolNode* Parser::parsePrimitive() {
     PRIMITIVE_TYPE primitive = translatePrimitiveType(curToken->text);
 
     if (consume(Tokenizer::TYPE_IDENTIFIER)) {
-        SymbolNode* assignment = parseAssignment(curToken, IDENTIFIER_TYPE::PRIMITIVE, true, primitive);
+        SymbolNode* assignment = parseAssignment(curToken, IDENTIFIER_TYPE::PRIMITIVE, primitive);
         return assignment; 
     }
     else {
@@ -1083,7 +1562,7 @@ ASTNode* Parser::parseParen() {
 IdentifierNode* Parser::parseIdentifier() {
     if (consume(Tokenizer::TYPE_IDENTIFIER)) {
         std::string name = curToken->text;
-        IdentifierNode* identiferNode = new IdentifierNode(curToken, name);
+        IdentifierNode* identiferNode = arena.make<IdentifierNode>(curToken, name);
         print("Parsed Identifier: " + name);
         // curScope->put(name, Tokenizer::TYPE_IDENTIFIER, 0.0);
         return identiferNode;
@@ -1096,7 +1575,7 @@ ChemicalNode* Parser::parseChemical() {
     if (consume(Tokenizer::TYPE_CHEMICAL)) {
         // curToken is chemical type token
         std::string formula = curToken->text;
-        ChemicalNode* chemicalNode = new ChemicalNode(curToken, formula);
+        ChemicalNode* chemicalNode = arena.make<ChemicalNode>(curToken, formula);
         curScope->put(curToken->text, Tokenizer::TYPE_CHEMICAL, "chemical");
         return chemicalNode;
     }
@@ -1107,12 +1586,12 @@ ChemicalNode* Parser::parseChemical() {
 ASTNode* Parser::parseLiteral() {
     if (consume(Tokenizer::TYPE_INTEGER) ||
         consume(Tokenizer::TYPE_FLOAT)) {
-            /* std::stof - parses str interpreting its content as a floating-point 
-            number, which is returned as a value of type float. */
-            float stringToFloat = std::stof(curToken->text);
-            NumberNode* numNode = new NumberNode(curToken);
-            numNode->setNum(stringToFloat);
-            NUMBER numType = isInteger(stringToFloat) ? NUMBER::INTEGER : NUMBER::FLOAT;
+            /* std::stod - parses str interpreting its content as a floating-point 
+            number, which is returned as a value of type double. */
+            double stringToDouble = std::stod(curToken->text);
+            NumberNode* numNode = arena.make<NumberNode>(curToken);
+            numNode->setNum(stringToDouble);
+            NUMBER numType = isInteger(stringToDouble) ? NUMBER::INTEGER : NUMBER::FLOAT;
             numNode->setNumType(numType);
             
             if (consume(Tokenizer::TYPE_UNIT)) {
@@ -1123,7 +1602,7 @@ ASTNode* Parser::parseLiteral() {
                 print("parsing chemical with coefficient");
                 numNode->setPrefix(PREFIX::NO_PREFIX);
                 numNode->setUnit(UNIT::NO_UNIT);
-                SymbolNode* symbolNode = new SymbolNode(curToken);
+                SymbolNode* symbolNode = arena.make<SymbolNode>(curToken);
                 symbolNode->setSymbol(SYMBOL::MULTIPLY);
                 symbolNode->setLeft(numNode);
                 symbolNode->setRight(parseChemical());
@@ -1149,7 +1628,7 @@ void Parser::parseUnit(NumberNode* precedingNumber) {
     UNIT unit;
 
     // text contains unit WITH prefix
-    if (!unitTextToType.count(text)) {
+    if (!findUnit(text, &unit)) {
         if (text[1] == 'a') {
             // edge case for deca
             // check works becase no unit is 'a'. only ampere is 'A'.
@@ -1167,8 +1646,8 @@ void Parser::parseUnit(NumberNode* precedingNumber) {
         // entire text only contains unit (WITHOUT prefix)
         // this case should only cover the need for "m" and "G", for now.
         // possibly "M" for molarity in the future. molarity = MOLAR for now.
+        // unit was already set by findUnit()
         precedingNumber->setPrefix(PREFIX::NO_PREFIX);
-        unit = translateUnitType(text);
     }
     unitSeen = unit;
     precedingNumber->setUnit(unit);
@@ -1179,7 +1658,7 @@ ImportNode* Parser::parseImport() {
         // must have valid import type (ie. Centrifuge) after keyword 'import'
         std::string importName = curToken->text;
         IMPORT_TYPE import = translateImportType(importName);
-        ImportNode* importNode = new ImportNode(curToken, import);
+        ImportNode* importNode = arena.make<ImportNode>(curToken, import);
         curScope->put(importName, Tokenizer::TYPE_IMPORT, "import");
         return importNode;
     }
@@ -1189,18 +1668,29 @@ ImportNode* Parser::parseImport() {
 
 KeywordNode* Parser::parseReaction() {
     if (consume(Tokenizer::TYPE_IDENTIFIER)) {
-        KeywordNode* reaction = new KeywordNode(curToken);
+        KeywordNode* reaction = arena.make<KeywordNode>(curToken);
         reaction->setKeyword(KEYWORD::REACTION);
         std::string name = curToken->text;
         curScope->put(name, Tokenizer::TYPE_IDENTIFIER, "reaction");
         openScope(name);
-        IdentifierNode* reactionName = new IdentifierNode(curToken, name);
+        IdentifierNode* reactionName = arena.make<IdentifierNode>(curToken, name);
         reactionName->setType(IDENTIFIER_TYPE::NON_FUNCTION);
+        ASTNode* nameNode = reactionName;
+        // indexed reaction family member, ie. reaction bind[i](...)
+        if (consume(Tokenizer::TYPE_SYMBOL_BRACKET_OPEN)) {
+            IndexNode* indexNode = arena.make<IndexNode>(curToken);
+            indexNode->setLeft(reactionName);
+            indexNode->setRight(parseExpression());
+            if (!consume(Tokenizer::TYPE_SYMBOL_BRACKET_CLOSED)) {
+                fail("Closing square bracket not found after reaction index.", curToken);
+            }
+            nameNode = indexNode;
+        }
         consume(Tokenizer::TYPE_SYMBOL_PAREN_OPEN);
         // no need to next --> rid of param name "eq"
         ASTNode* reactionParams = parseParam();
         // consume(Tokenizer::TYPE_SYMBOL_PAREN_OPEN);
-        reaction->setLeft(reactionName);
+        reaction->setLeft(nameNode);
         reaction->setRight(reactionParams);
         next(); // move onto first character of next statement
         closeScope(name);
@@ -1210,21 +1700,126 @@ KeywordNode* Parser::parseReaction() {
     return nullptr;
 }
 
+static bool isName(Tokenizer::Token* token) {
+    return !token->text.empty() && std::isalpha(static_cast<unsigned char>(token->text[0]));
+}
+
+/* complex EGFR {
+       domain lig;
+       domain Y1(off, on);
+   }
+   becomes a COMPLEX KeywordNode with the name on the left and a chain of DOM KeywordNodes on the right, each
+   with its name on the left and a chain of state names on the right (see ruleNetwork.h). */
+KeywordNode* Parser::parseComplex() {
+    Tokenizer::Token* keywordToken = curToken;
+    next();
+    if (!isName(curToken)) {
+        fail("Complex must be named.", curToken);
+    }
+    std::string name = curToken->text;
+    IdentifierNode* complexName = arena.make<IdentifierNode>(curToken, name, IDENTIFIER_TYPE::NON_FUNCTION);
+    curScope->put(name, Tokenizer::TYPE_IDENTIFIER, "complex");
+    if (!consume(Tokenizer::TYPE_SYMBOL_CURLY_OPEN)) {
+        fail("Expected { after complex " + name + ".", curToken);
+    }
+
+    ASTNode* domains = arena.make<ASTNode>();
+    ASTNode* lastDomain = nullptr;
+    while (!consume(Tokenizer::TYPE_SYMBOL_CURLY_CLOSED)) {
+        next();
+        if (!checkCurText("domain")) {
+            fail("Only domains can be declared in complex " + name + ".", curToken);
+        }
+        Tokenizer::Token* domainToken = curToken;
+        next();
+        if (!isName(curToken)) {
+            fail("Domain of complex " + name + " must be named.", curToken);
+        }
+        std::string domainName = curToken->text;
+        IdentifierNode* domainIdentifier = arena.make<IdentifierNode>(curToken, domainName, IDENTIFIER_TYPE::NON_FUNCTION);
+
+        ASTNode* states = arena.make<ASTNode>();
+        if (consume(Tokenizer::TYPE_SYMBOL_PAREN_OPEN)) {
+            ASTNode* lastState = nullptr;
+            do {
+                next();
+                if (!isName(curToken)) {
+                    fail("Expected a state of domain " + domainName + ".", curToken);
+                }
+                IdentifierNode* state = arena.make<IdentifierNode>(curToken, curToken->text, IDENTIFIER_TYPE::NON_FUNCTION);
+                if (lastState == nullptr) {
+                    states = state;
+                } else {
+                    lastState->setNextStatement(state);
+                }
+                lastState = state;
+            } while (consume(Tokenizer::TYPE_SYMBOL_COMMA));
+            if (!consume(Tokenizer::TYPE_SYMBOL_PAREN_CLOSED)) {
+                fail("Closing parenthesis not found after the states of domain " + domainName + ".", curToken);
+            }
+        }
+        semicolon();
+
+        KeywordNode* domain = arena.make<KeywordNode>(domainToken, domainIdentifier, states, KEYWORD::DOM);
+        if (lastDomain == nullptr) {
+            domains = domain;
+        } else {
+            lastDomain->setNextStatement(domain);
+        }
+        lastDomain = domain;
+    }
+    next(); // move onto first character of next statement
+    return arena.make<KeywordNode>(keywordToken, complexName, domains, KEYWORD::COMPLEX);
+}
+
+/* Complex pattern starting at curToken, ie. EGF(rec!1).EGFR(lig!1). The pattern is kept as written, as the name
+   on the left of a COMPLEX KeywordNode, and parsed by RuleNetwork::parsePattern() when building the context. */
+KeywordNode* Parser::parseComplexPattern() {
+    Tokenizer::Token* start = curToken;
+    std::string pattern;
+    while (true) {
+        std::string complexName = curToken->text;
+        if (!consume(Tokenizer::TYPE_SYMBOL_PAREN_OPEN)) {
+            fail("Expected ( after complex " + complexName + ".", curToken);
+        }
+        pattern += complexName + "(";
+        while (!consume(Tokenizer::TYPE_SYMBOL_PAREN_CLOSED)) {
+            if (checkNextType(Tokenizer::TYPE_END) || checkNextType(Tokenizer::TYPE_SYMBOL_SEMICOLON) ||
+                checkNextType(Tokenizer::TYPE_SYMBOL_PAREN_OPEN)) {
+                fail("Closing parenthesis not found in complex pattern " + pattern + ".", curToken);
+            }
+            next();
+            pattern += curToken->text;
+        }
+        pattern += ")";
+        // the complexes of one species are joined by '.'
+        if (!consume(Tokenizer::TYPE_SYMBOL_DOT)) {
+            break;
+        }
+        next();
+        pattern += ".";
+    }
+    IdentifierNode* patternName = arena.make<IdentifierNode>(start, pattern, IDENTIFIER_TYPE::NON_FUNCTION);
+    return arena.make<KeywordNode>(start, patternName, arena.make<ASTNode>(), KEYWORD::COMPLEX);
+}
+
 IndexNode* Parser::parseIndex() {
-    IdentifierNode* identifier = new IdentifierNode(curToken,     
+    IdentifierNode* identifier = arena.make<IdentifierNode>(curToken,     
                                                     curToken->text, IDENTIFIER_TYPE::NON_FUNCTION);
-    consume(Tokenizer::TYPE_SYMBOL_BRACKET_OPEN);
-    ASTNode* index = parseExpression();
-    if (consume(Tokenizer::TYPE_SYMBOL_BRACKET_CLOSED)) {
-        IndexNode* indexNode = new IndexNode();
-        indexNode->setLeft(identifier);
+    ASTNode* indexed = identifier;
+    // an element of a species array is indexed again for time, ie. R[3][2 s]
+    while (consume(Tokenizer::TYPE_SYMBOL_BRACKET_OPEN)) {
+        ASTNode* index = parseExpression();
+        if (!consume(Tokenizer::TYPE_SYMBOL_BRACKET_CLOSED)) {
+            fail("Closing square bracket not found.", curToken);
+            return nullptr;
+        }
+        IndexNode* indexNode = arena.make<IndexNode>();
+        indexNode->setLeft(indexed);
         indexNode->setRight(index);
-        return indexNode;
+        indexed = indexNode;
     }
-    delete identifier;
-    delete index;
-    fail("Closing square bracket not found.", curToken);
-    return nullptr;
+    return static_cast<IndexNode*>(indexed);
 } 
 
 Scope* Parser::getScope(std::string newScopeName) {
@@ -1239,123 +1834,123 @@ Scope* Parser::getScope(std::string newScopeName) {
 }
 
 void Parser::openScope(std::string newScopeName) {
-    Scope* scope = new Scope();
+    Scope* parent = curScope;
+    Scope* scope = new Scope(scopeTree.size(), newScopeName, parent);
+    if (parent != NULL) {
+        parent->addChildScope(scope);
+    }
+    scopeTree.push_back(scope);
     curScope = scope;
     curScopeName = newScopeName;
-    spaghetti.push(scope);
 }
 
 void Parser::closeScope(std::string name) {
     print("closing " + name + " scope...");
-    Scope* scope = spaghetti.top();
-    spaghetti.pop();
-    if (!spaghetti.empty()) {
-        Scope* parent = spaghetti.top();
-        scope->setParentScope(true, parent);
-        parent->setChildScope(true, scope);
-        curScope = parent;
-    } else {
-        scope->setParentScope(false, NULL);
+    Scope* scope = curScope;
+    if (scope->hasParentScope()) {
+        curScope = scope->getParentScope();
+        curScopeName = curScope->getName();
     }
     scopes.insert(std::pair<std::string, Scope*>(name, scope));
+    closedScopes.push_back({ name, scope });
 }
 
 void Parser::printScopes() {
     print("+ Printing all scopes' symbol tables... \n");
-    int scopeCount = 1;
-    std::unordered_map<Scope*, std::string> reverseScopes;
-    for (auto const& scope: scopes) {
-        reverseScopes.insert(std::pair<Scope*, std::string>(scope.second, scope.first));
-    }
-    
-    for (auto const& scope : scopes) {
-        std::string parentScopeName;
-        std::string childScopeName;
-
-        Scope* parent = scope.second->getParentScope();
-        Scope* child = scope.second->getChildScope();
-        if (reverseScopes.count(parent)) {
-            parentScopeName = reverseScopes.at(parent);
-        } else {
-            parentScopeName = "NONE";
+    for (Scope* scope : scopeTree) {
+        if (scope == NULL) {
+            continue;
         }
-        
-        if (reverseScopes.count(child)) {
-            childScopeName = reverseScopes.at(child);
-        } else {
-            childScopeName = "NONE";
+        std::string parentScopeName = "NONE";
+        if (scope->hasParentScope()) {
+            parentScopeName = scope->getParentScope()->getName();
+        }
+        std::string childScopeNames;
+        for (Scope* child : scope->getChildScopes()) {
+            childScopeNames += (childScopeNames.empty() ? "" : ", ") + child->getName();
+        }
+        if (childScopeNames.empty()) {
+            childScopeNames = "NONE";
         }
 
-        std::cout << scope.first << " scope " << ":\n";
+        std::cout << scope->getName() << " scope " << "(#" << scope->getId() << "):\n";
         std::cout << "\tparent = " << parentScopeName << std::endl;
-        std::cout << "\tchild = " << childScopeName << std::endl;
-        scope.second->printSymbolTable();
+        std::cout << "\tchildren = " << childScopeNames << std::endl;
+        scope->printSymbolTable();
         print("\n");
-        scopeCount++;
     }
 }
 
-void Parser::evaluateOperations(ASTNode* root) {
-    ASTNode* cur = root;
-    // have to visit every single node possible to find all assignment nodes
-    // bfs to find all stuff
-    
-    std::queue<ASTNode*> queue;
-    std::vector<ASTNode*> children;
-    queue.push(cur);
-
-    while (!queue.empty()) {
-        cur = queue.front();
-        queue.pop();
-        std::cout << cur->visited;
-        if (!cur->visited) {
-            cur->visited = true;
-            if (cur->getNodeType() == NODE::SYMBOL_NODE) {
-                SymbolNode* symbol = dynamic_cast<SymbolNode*>(cur);
-                if (symbol->getSymbol() == SYMBOL::ASSIGNMENT) {
-                    if (symbol->getLeft()->getNodeType() == NODE::IDENTIFIER_NODE) {
-                        IdentifierNode* identifier = dynamic_cast<IdentifierNode*>(symbol->getLeft());
-                        NumberNode* result = symbol->getRight()->evaluate(curScope);
-                        symbol->setRight(result);
-                        std::cout << "PRINTING SCOPES for identifier\n";
-                        printScopes();
-                        std::cout << identifier->getName();
-                        // scopes.at(identifier->getName())->printSymbolTable();
-                        // scopes.at(identifier->getName())->putVal(identifier->getName(), result->getNum());
-                    }
-                    else if (dynamic_cast<ParamNode*>(symbol->getLeft())->getParamType() != PARAM::EQUATION) {
-                        ParamNode* param = dynamic_cast<ParamNode*>(symbol->getLeft());
-                        NumberNode* result = symbol->getRight()->evaluate(curScope);
-                        symbol->setRight(result);
-                        std::cout << "PRINTING SCOPES for param\n";
-                        printScopes();
-                        std::cout << paramTypeToText.at(param->getParamType()) << std::endl;
-                    }
-
-                }
-            } else {
-                // push all children
-                // push next statement
-                children = cur->getChildren();
-                for (ASTNode* child : children) {
-                    queue.push(child);
-                }
-            }
-            if (cur->hasNextStatement) {
-                queue.push(cur->getNextStatement());  
-            }
+/* Replaces every constant subtree under root, and under the statements that
+   follow it, with one NumberNode holding its value, so later phases only see
+   literals. Runs once per statement after parsing, while the scopes its
+   identifiers were bound to are still alive. Loops are left as written since
+   their variables change from one iteration to the next. */
+void Parser::foldConstants(ASTNode* root) {
+    std::vector<ASTNode*> pending;
+    if (root != nullptr) {
+        pending.push_back(root);
+    }
+    auto fold = [&](ASTNode* node) -> ASTNode* {
+        if (node == nullptr || node->getNodeType() == NODE::NUMBER_NODE) {
+            return node;
+        }
+        if (!node->isConstant()) {
+            pending.push_back(node);
+            return node;
+        }
+        NumberNode* literal = arena.make<NumberNode>();
+        literal->setQuantity(node->evaluate(curScope));
+        literal->setLine(node->getLine());
+        literal->setCol(node->getCol());
+        return literal;
+    };
+
+    while (!pending.empty()) {
+        ASTNode* node = pending.back();
+        pending.pop_back();
+        if (node->hasNextStatement && node->getNextStatement() != nullptr) {
+            pending.push_back(node->getNextStatement());
+        }
+        if (nodeIsA(node->getNodeType(), NODE::LOOPING_NODE)) {
+            continue;
+        }
+        if (TernaryNode* ternary = nodeCast<TernaryNode>(node)) {
+            ternary->setLeft(fold(ternary->getLeft()));
+            ternary->setCenter(fold(ternary->getCenter()));
+            ternary->setRight(fold(ternary->getRight()));
+        } else if (BinaryNode* binary = nodeCast<BinaryNode>(node)) {
+            binary->setLeft(fold(binary->getLeft()));
+            binary->setRight(fold(binary->getRight()));
+        } else if (UnaryNode* unary = nodeCast<UnaryNode>(node)) {
+            unary->setChild(fold(unary->getChild()));
         }
     }
 }
 
 PARAM Parser::inferUnit(UNIT unitToInfer) {
-    PARAM inferred;
-    try {
-        inferred = unitToParam.at(unitToInfer);
-    } catch (const std::out_of_range& oor) {
-        fail("Unit was not or cannot be inferred successfully.", nullptr);
-    }
-    return inferred;
+    switch (unitToInfer) {
+        case UNIT::LITER:       return PARAM::VOLUME;
+        case UNIT::SEC:
+        case UNIT::MIN:
+        case UNIT::HR:          return PARAM::TIME;
+        case UNIT::GRAM:        return PARAM::MASS;
+        case UNIT::CELSIUS:
+        case UNIT::FAHRENHEIT:
+        case UNIT::KELVIN:      return PARAM::TEMP;
+        case UNIT::VOLT:
+        case UNIT::AMPERE:      return PARAM::VOLTAGE;
+        case UNIT::MOL:
+        case UNIT::MOLARITY:
+        case UNIT::MOLALITY:    return PARAM::MOLS;
+        case UNIT::RPM:
+        case UNIT::GFORCE:      return PARAM::SPEED;
+        case UNIT::CANDELA:     // no brightness parameter yet
+        case UNIT::NO_UNIT:
+            break;
+    }
+    fail("Unit was not or cannot be inferred successfully.", nullptr);
+    return PARAM::UNINITIALIZED;
 }
 
 void Parser::resetUnitSeen() {
@@ -1,12 +1,18 @@
 #pragma once
 
 #include "ast.h"
+#include "arena.h"
+#include "flatAst.h"
+#include "walker.h"
 #include "scope.h"
 
 #include <vector>
 #include <queue>
-
-extern std::unordered_map<UNIT, PARAM> unitToParam;
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <memory>
 
 enum class BLOCK_TYPE {
     GLOBAL,
@@ -24,14 +30,44 @@ enum class BLOCK_TYPE {
     PLASM
 };
 
-extern std::unordered_map<KEYWORD, BLOCK_TYPE> keywordToBlock;
+BLOCK_TYPE keywordToBlock(KEYWORD keyword);
+
+// errors a recovering parse reports before it gives up, if its collector has no limit
+constexpr int RECOVERING_MAX_ERRORS = 20;
 
 class Parser {
   public:
     Parser();
     Parser(Tokenizer::Token* tokenList);
+    // With a collector, every parse mode records syntax errors, skips to the next statement and continues.
+    Parser(Tokenizer::Token* tokenList, ErrorCollector* newCollector);
+    ~Parser();
     ASTNode* parse();
+    FlatAst parseFlat();    // parseStreaming() that lowers every statement into a flat AST
+    /* Parses one top-level statement at a time and hands it to consumeStatement.
+       A loop that declares reactions is expanded first and its statements are
+       handed over one by one (see loopExpander.h). The statement's nodes are
+       reclaimed as soon as the last of them has been consumed, so
+       consumeStatement must not keep pointers into the tree. No statement is
+       handed over after a syntax error. */
+    void parseStreaming(const std::function<void(ASTNode*)>& consumeStatement);
+    /* Parses top-level keyword declarations (reaction, protein, container, ...)
+       concurrently on numThreads workers, each with its own arena and scope
+       tree. Other top-level statements are parsed in order on this parser;
+       the declarations between two of them run while this parser waits, so
+       they read the global scope as parse() would at their position. Results,
+       scopes and errors are linked, merged and reported in source order, and
+       workers never exit: each buffers its errors for this thread to report. */
+    ASTNode* parseParallel(unsigned numThreads = std::thread::hardware_concurrency());
+    // Returns the last token of the top-level statement starting at start.
+    static Tokenizer::Token* findStatementEnd(Tokenizer::Token* start);
     ASTNode* parseStatement();
+    // parseStatement() that skips to the end of a malformed statement and returns nullptr
+    ASTNode* parseStatementRecovering();
+    // statement unless it is nullptr and curToken has not moved past start, which fails
+    ASTNode* checkProgress(ASTNode* statement, Tokenizer::Token* start);
+    // adds a caught error() to recoveringCollector at token; fail() errors are already recorded
+    static void recordError(const SyntaxError& syntaxError, Tokenizer::Token* token);
     ASTNode* parseExpression();
     bool checkCur(Tokenizer::TokenType type, std::string text);
     bool checkCurType(Tokenizer::TokenType type);
@@ -82,12 +118,16 @@ class Parser {
     void parseUnit(NumberNode* precedingNumber);
     SymbolNode* parseParam();
     void parseNextParam(SymbolNode* curParam);
-    SymbolNode* parseAssignment(Tokenizer::Token* identifierToken, IDENTIFIER_TYPE type, bool evaluate = true, PRIMITIVE_TYPE = PRIMITIVE_TYPE::NON_PRIMITIVE);  // =
+    SymbolNode* parseAssignment(Tokenizer::Token* identifierToken, IDENTIFIER_TYPE type, PRIMITIVE_TYPE = PRIMITIVE_TYPE::NON_PRIMITIVE);  // =
     SymbolNode* parseFunction();
     SymbolNode* parsePrimitive();
     SymbolNode* parseChemEq();
     KeywordNode* parseReaction();
+    KeywordNode* parseComplex();
+    KeywordNode* parseComplexPattern();
     IndexNode* parseIndex();
+    // one side of a chemical equation as a SpeciesListNode, or side itself if it is a single species or not a sum of species
+    ASTNode* flattenSpecies(ASTNode* side);
 
     /* helper function to parse function call parentheses: 
             1. Default - ()
@@ -107,34 +147,37 @@ class Parser {
     Tokenizer::Token* prevToken;
     Tokenizer::Token* curToken; 
     ASTNode* root;                  // current root
-    std::stack<Scope*> spaghetti;      // spaghetti stack / parent-pointer tree
-    std::unordered_map<std::string, Scope*> scopes;      // scopes
+    AstArena arena;                 // owns every node of the parsed tree
+    std::vector<Scope*> scopeTree;      // every scope this parser owns, indexed by scope ID
+    std::unordered_map<std::string, Scope*> scopes;      // closed scopes by name
+    std::vector<std::pair<std::string, Scope*>> closedScopes;    // scopes in the order they were closed
+    std::vector<std::unique_ptr<Parser>> workerParsers;         // own the nodes of parseParallel() segments
     Scope* curScope; 
     std::string curScopeName;
     BLOCK_TYPE curBlockType;
     UNIT unitSeen;
+    ErrorCollector* collector;      // NULL: stop at the first error
 
     Scope* getScope(std::string scopeName);
     void openScope(std::string scopeName);
     void closeScope(std::string scopeName);     
     void printScopes();
+    void mergeSegmentScopes(size_t firstClosed, size_t endClosed, Parser* worker);
+    void adoptScope(Scope* scope, Parser* owner);
 
-    void evaluateOperations(ASTNode* root);
+    void foldConstants(ASTNode* root);
 };
 
 
 // Node helper methods for parsing each supported type.
 // ===========================================================
-static bool isInteger(float num) {
+static bool isInteger(double num) {
     return ((int) num) == num;
 }
 
 static PREFIX translatePrefixType(std::string prefixText) {
     PREFIX translated;
-    try {
-        translated = prefixTextToType.at(prefixText);
-    }
-    catch (const std::out_of_range& oor) {
+    if (!findPrefix(prefixText, &translated)) {
         fail("The prefix found in " + prefixText + " is invalid." \
             "L++ supports all prefixes within the range of yocto(y) and yotta (Y).", nullptr);
     }
@@ -143,10 +186,7 @@ static PREFIX translatePrefixType(std::string prefixText) {
 
 static UNIT translateUnitType(std::string unitText) {
     UNIT translated;
-    try {
-        translated = unitTextToType.at(unitText);
-    }
-    catch (const std::out_of_range& oor) {
+    if (!findUnit(unitText, &translated)) {
         fail("The unit " + unitText + " is invalid." \
             "L++ supports all SI units and further. See supported units in documentation.", nullptr);
     }
@@ -155,10 +195,7 @@ static UNIT translateUnitType(std::string unitText) {
 
 static KEYWORD translateKeywordType(std::string keywordText) {
     KEYWORD translated;
-    try {
-        translated = keywordTextToType.at(keywordText);
-    }
-    catch (const std::out_of_range& oor) {
+    if (!findKeyword(keywordText, &translated)) {
         fail("The keyword " + keywordText + " is invalid." \
             "Keyword not supported. See supported keywords in documentation.", nullptr);
     }
@@ -167,10 +204,7 @@ static KEYWORD translateKeywordType(std::string keywordText) {
 
 static PARAM translateParamType(std::string paramText) {
     PARAM translated;
-    try {
-        translated = paramTextToType.at(paramText);
-    }
-    catch (const std::out_of_range& oor) {
+    if (!findParam(paramText, &translated)) {
         fail("The parameter " + paramText + " is invalid." \
             "Parameter not supported. See supported parameters in documentation.", nullptr);
     }
@@ -179,22 +213,16 @@ static PARAM translateParamType(std::string paramText) {
 
 static IMPORT_TYPE translateImportType(std::string importText) {
     IMPORT_TYPE translated;
-    try {
-        translated = importTextToType.at(importText); 
-    }
-    catch (const std::out_of_range& oor) {
+    if (!findImport(importText, &translated)) {
         fail("The import " + importText + " is invalid." \
-            "Import not supported. See supported imports in documentation.", nullptr);        
+            "Import not supported. See supported imports in documentation.", nullptr);
     }
     return translated;
 }
 
 static PRIMITIVE_TYPE translatePrimitiveType(std::string primitiveText) {
     PRIMITIVE_TYPE translated;
-    try {
-        translated = primitiveTextToType.at(primitiveText);
-    }
-    catch (const std::out_of_range& oor) {
+    if (!findPrimitive(primitiveText, &translated)) {
         fail("The primitive " + primitiveText + " is invalid." \
             "Primitive not supported. See supported primitives in documentation.", nullptr);
     }
@@ -0,0 +1,217 @@
+#include "reducedModel.h"
+#include "error.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+namespace lcc {
+
+// sparse row, increasing column order, no zeros
+typedef std::vector<std::pair<int, int64_t>> SparseRow;
+
+static int64_t checkedMultiplyAdd(int64_t a, int64_t x, int64_t b, int64_t y) {
+    int64_t ax, by, sum;
+    if (__builtin_mul_overflow(a, x, &ax) || __builtin_mul_overflow(b, y, &by) || __builtin_add_overflow(ax, by, &sum)) {
+        error("Coefficients of a conservation law overflow 64 bits.");
+    }
+    return sum;
+}
+
+// a * x + b * y
+static SparseRow combine(int64_t a, const SparseRow& x, int64_t b, const SparseRow& y) {
+    SparseRow result;
+    result.reserve(x.size() + y.size());
+    size_t i = 0;
+    size_t j = 0;
+    while (i < x.size() || j < y.size()) {
+        int64_t value;
+        int column;
+        if (j == y.size() || (i < x.size() && x[i].first < y[j].first)) {
+            column = x[i].first;
+            value = checkedMultiplyAdd(a, x[i++].second, 0, 0);
+        } else if (i == x.size() || y[j].first < x[i].first) {
+            column = y[j].first;
+            value = checkedMultiplyAdd(0, 0, b, y[j++].second);
+        } else {
+            column = x[i].first;
+            value = checkedMultiplyAdd(a, x[i++].second, b, y[j++].second);
+        }
+        if (value != 0) {
+            result.emplace_back(column, value);
+        }
+    }
+    return result;
+}
+
+static int64_t content(const SparseRow& row, int64_t divisor) {
+    for (auto& [column, value] : row) {
+        divisor = std::gcd(divisor, value);
+    }
+    return divisor;
+}
+
+static void divide(SparseRow& row, int64_t divisor) {
+    for (auto& [column, value] : row) {
+        value /= divisor;
+    }
+}
+
+ReducedModel::ReducedModel(const CompiledModel& model) {
+    size_t species = model.speciesCount();
+    const CsrMatrix& stoichiometry = model.getStoichiometry();
+
+    // the stoichiometry by species, reactions in increasing order
+    std::vector<SparseRow> reactionRows(species);
+    for (size_t reaction = 0; reaction < stoichiometry.rows(); reaction++) {
+        for (int entry = stoichiometry.offsets[reaction]; entry < stoichiometry.offsets[reaction + 1]; entry++) {
+            reactionRows[stoichiometry.columns[entry]].emplace_back(reaction, stoichiometry.values[entry]);
+        }
+    }
+
+    /* Each row is kept as a combination of species rows: reactionRow = combination . N. A row whose first
+       reaction is not the first reaction of a pivot becomes a pivot, so pivot combinations only involve pivot
+       species; a row that cancels out completely is a conservation law. */
+    std::vector<int> pivotOfReaction(stoichiometry.rows(), -1);
+    std::vector<SparseRow> pivotRows;
+    std::vector<SparseRow> pivotCombinations;
+    conservationLaws.offsets.push_back(0);
+    for (size_t current = 0; current < species; current++) {
+        SparseRow row = std::move(reactionRows[current]);
+        SparseRow combination = { { static_cast<int>(current), 1 } };
+        while (!row.empty() && pivotOfReaction[row.front().first] >= 0) {
+            int pivot = pivotOfReaction[row.front().first];
+            int64_t divisor = std::gcd(pivotRows[pivot].front().second, row.front().second);
+            int64_t a = pivotRows[pivot].front().second / divisor;
+            int64_t b = row.front().second / divisor;
+            row = combine(a, row, -b, pivotRows[pivot]);
+            combination = combine(a, combination, -b, pivotCombinations[pivot]);
+
+            divisor = content(combination, content(row, 0));
+            // keeps the coefficient of the current species positive
+            for (auto& [column, value] : combination) {
+                if (column == (int) current && value < 0) {
+                    divisor = -divisor;
+                }
+            }
+            divide(row, divisor);
+            divide(combination, divisor);
+        }
+
+        if (!row.empty()) {
+            pivotOfReaction[row.front().first] = pivotRows.size();
+            pivotRows.push_back(std::move(row));
+            pivotCombinations.push_back(std::move(combination));
+            continue;
+        }
+        dependentSpecies.push_back(current);
+        for (auto& [column, value] : combination) {
+            if (value > std::numeric_limits<int>::max() || value < std::numeric_limits<int>::min()) {
+                error("Conservation law of species " + model.getSpeciesName(current) + " has a coefficient that does not fit an int.");
+            }
+            conservationLaws.columns.push_back(column);
+            conservationLaws.values.push_back(value);
+        }
+        conservationLaws.offsets.push_back(conservationLaws.columns.size());
+    }
+
+    const std::vector<double>& initialState = model.getInitialState();
+    for (size_t law = 0; law < conservationLaws.rows(); law++) {
+        double total = 0;
+        for (int entry = conservationLaws.offsets[law]; entry < conservationLaws.offsets[law + 1]; entry++) {
+            total += conservationLaws.values[entry] * initialState[conservationLaws.columns[entry]];
+        }
+        totals.push_back(total);
+    }
+
+    reducedIndices.assign(species, 0);
+    for (int dependent : dependentSpecies) {
+        reducedIndices[dependent] = -1;
+    }
+    for (size_t current = 0; current < species; current++) {
+        if (reducedIndices[current] != -1) {
+            reducedIndices[current] = independentSpecies.size();
+            independentSpecies.push_back(current);
+            reducedInitialState.push_back(initialState[current]);
+        }
+    }
+
+    reducedStoichiometry.offsets.push_back(0);
+    for (size_t reaction = 0; reaction < stoichiometry.rows(); reaction++) {
+        for (int entry = stoichiometry.offsets[reaction]; entry < stoichiometry.offsets[reaction + 1]; entry++) {
+            int reduced = reducedIndices[stoichiometry.columns[entry]];
+            if (reduced >= 0) {
+                reducedStoichiometry.columns.push_back(reduced);
+                reducedStoichiometry.values.push_back(stoichiometry.values[entry]);
+            }
+        }
+        reducedStoichiometry.offsets.push_back(reducedStoichiometry.columns.size());
+    }
+}
+
+const CsrMatrix& ReducedModel::getConservationLaws() const {
+    return conservationLaws;
+}
+
+const std::vector<int>& ReducedModel::getDependentSpecies() const {
+    return dependentSpecies;
+}
+
+const std::vector<double>& ReducedModel::getTotals() const {
+    return totals;
+}
+
+const std::vector<int>& ReducedModel::getIndependentSpecies() const {
+    return independentSpecies;
+}
+
+int ReducedModel::getReducedIndex(int species) const {
+    return reducedIndices[species];
+}
+
+size_t ReducedModel::reducedSize() const {
+    return independentSpecies.size();
+}
+
+const std::vector<double>& ReducedModel::getReducedInitialState() const {
+    return reducedInitialState;
+}
+
+const CsrMatrix& ReducedModel::getReducedStoichiometry() const {
+    return reducedStoichiometry;
+}
+
+std::vector<double> ReducedModel::reduce(const std::vector<double>& state) const {
+    std::vector<double> reducedState;
+    reducedState.reserve(independentSpecies.size());
+    for (int species : independentSpecies) {
+        reducedState.push_back(state[species]);
+    }
+    return reducedState;
+}
+
+std::vector<double> ReducedModel::expand(const std::vector<double>& reducedState) const {
+    std::vector<double> state(reducedIndices.size());
+    for (size_t reduced = 0; reduced < independentSpecies.size(); reduced++) {
+        state[independentSpecies[reduced]] = reducedState[reduced];
+    }
+    // a law only involves independent species besides its own dependent one
+    for (size_t law = 0; law < dependentSpecies.size(); law++) {
+        int dependent = dependentSpecies[law];
+        double rest = totals[law];
+        int coefficient = 0;
+        for (int entry = conservationLaws.offsets[law]; entry < conservationLaws.offsets[law + 1]; entry++) {
+            if (conservationLaws.columns[entry] == dependent) {
+                coefficient = conservationLaws.values[entry];
+            } else {
+                rest -= conservationLaws.values[entry] * state[conservationLaws.columns[entry]];
+            }
+        }
+        state[dependent] = rest / coefficient;
+    }
+    return state;
+}
+
+}
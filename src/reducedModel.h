@@ -0,0 +1,65 @@
+#pragma once
+
+#include "compiledModel.h"
+
+#include <vector>
+
+namespace lcc {
+
+/*  Reduced Model:
+    --------------------------------------
+    A CompiledModel without the species that conservation laws make
+    redundant, for solvers that need a non-singular Jacobian.
+
+    A conservation law is an integer vector c over the species with
+    c . N = 0 for the stoichiometry N of every reaction, so c . x stays at
+    its initial total (ie. E + ES of an enzyme). The laws are a basis of the
+    integer left null space of the stoichiometry (species x reactions),
+    found by sparse fraction-free elimination over the species in order:
+    a species whose row is a combination of those of earlier species is
+    dependent, and the combination is its law. Each law therefore involves
+    its dependent species and independent species only, so that
+
+        x[d] = (total - sum of c[j] x[j] over the other j) / c[d]
+
+    recovers a dependent species from the reduced state, and
+    dx[d]/dx[j] = -c[j] / c[d] links the Jacobians. Species that take part
+    in no reaction are dependent on nothing and keep their initial count.
+*/
+
+class ReducedModel {
+    public:
+        explicit ReducedModel(const CompiledModel& model);
+
+        // rows are the laws, columns species of the full model
+        const CsrMatrix& getConservationLaws() const;
+        // the species each law eliminates, by law
+        const std::vector<int>& getDependentSpecies() const;
+        // c . x of each law at the initial state
+        const std::vector<double>& getTotals() const;
+
+        // species of the full model kept in the reduced state, in increasing order
+        const std::vector<int>& getIndependentSpecies() const;
+        // position in the reduced state, -1 for a dependent species
+        int getReducedIndex(int species) const;
+        size_t reducedSize() const;
+        const std::vector<double>& getReducedInitialState() const;
+        // stoichiometry of the full model's reactions over the reduced state
+        const CsrMatrix& getReducedStoichiometry() const;
+
+        std::vector<double> reduce(const std::vector<double>& state) const;
+        // the full state, dependent species recovered from the totals
+        std::vector<double> expand(const std::vector<double>& reducedState) const;
+
+    private:
+        CsrMatrix conservationLaws;
+        std::vector<int> dependentSpecies;
+        std::vector<double> totals;
+
+        std::vector<int> independentSpecies;
+        std::vector<int> reducedIndices;
+        std::vector<double> reducedInitialState;
+        CsrMatrix reducedStoichiometry;
+};
+
+}
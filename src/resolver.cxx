@@ -0,0 +1,67 @@
+#include "resolver.h"
+#include "walker.h"
+
+void NameResolver::resolve(ASTNode* tree) {
+    ASTWalker().walk(tree, [this](ASTNode* node, int depth, bool fromNextStatement) {
+        resolveNode(node);
+        return true;
+    });
+}
+
+std::vector<int> NameResolver::resolve(const FlatAst& flat) {
+    std::vector<int> nameIds(flat.stringCount(), -1);
+    for (FlatIndex index = 0; index < flat.size(); index++) {
+        FlatNodeView node = flat.view(index);
+        NODE nodeType = node.getNodeType();
+        if ((nodeType == NODE::IDENTIFIER_NODE || nodeType == NODE::CHEMICAL_NODE) && nameIds[node.getNameIndex()] == -1) {
+            nameIds[node.getNameIndex()] = intern(node.getName());
+        }
+    }
+    return nameIds;
+}
+
+int NameResolver::resolveNode(ASTNode* node) {
+    if (IdentifierNode* identifier = nodeCast<IdentifierNode>(node)) {
+        ResolvedSlot binding = identifier->getResolved();
+        if (binding.kind == RESOLVED::UNRESOLVED) {
+            binding.kind = RESOLVED::NAME;
+            binding.index = intern(identifier->getName());
+            identifier->setResolved(binding);
+        }
+        return binding.kind == RESOLVED::NAME ? binding.index : -1;
+    }
+    if (ChemicalNode* chemical = nodeCast<ChemicalNode>(node)) {
+        ResolvedSlot binding = chemical->getResolved();
+        if (binding.kind == RESOLVED::UNRESOLVED) {
+            binding.kind = RESOLVED::NAME;
+            binding.index = intern(chemical->getFormula());
+            chemical->setResolved(binding);
+        }
+        return binding.kind == RESOLVED::NAME ? binding.index : -1;
+    }
+    return -1;
+}
+
+size_t NameResolver::size() const {
+    return names.size();
+}
+
+const std::string& NameResolver::getName(int nameId) const {
+    return names[nameId];
+}
+
+int NameResolver::findName(const std::string& name) const {
+    auto found = nameIds.find(name);
+    if (found == nameIds.end()) {
+        return -1;
+    }
+    return found->second;
+}
+
+int NameResolver::intern(const std::string& name) {
+    auto [entry, inserted] = nameIds.emplace(name, names.size());
+    if (inserted) {
+        names.push_back(name);
+    }
+    return entry->second;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "ast.h"
+#include "flatAst.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*  Name Resolver:
+    --------------------------------------
+    Runs over parsed statements before context building and binds every
+    IdentifierNode and ChemicalNode that is not a parser variable to a dense
+    name ID (RESOLVED::NAME). Every distinct molecule or reaction name gets
+    one ID, handed out in order of first appearance, and the same name always
+    gets the same ID, so IDs stay stable across statements.
+
+    A Compartment keeps molecule and reaction tables indexed by name ID, so
+    after this pass the context builder finds a species by indexing a vector
+    and never hashes its name. The name is hashed once here, when it is first
+    seen.
+*/
+
+class NameResolver {
+    public:
+        NameResolver() {}
+
+        // binds the statement chain starting at tree, including nested statements
+        void resolve(ASTNode* tree);
+        /* binds every identifier and chemical of a flat tree in one linear scan;
+           returns the name ID of each interned string, -1 if it is not a name
+           (see FlatAst::raise) */
+        std::vector<int> resolve(const FlatAst& flat);
+        // binds one node; returns its name ID or -1 if it is not a name
+        int resolveNode(ASTNode* node);
+
+        size_t size() const;
+        const std::string& getName(int nameId) const;
+        // -1 if name has not been seen
+        int findName(const std::string& name) const;
+
+    private:
+        int intern(const std::string& name);
+
+        std::vector<std::string> names;                     // name ID -> name
+        std::unordered_map<std::string, int> nameIds;
+};
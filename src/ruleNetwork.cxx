@@ -0,0 +1,706 @@
+#include "ruleNetwork.h"
+#include "error.h"
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+
+namespace lcc {
+
+int ComplexType::findDomain(const std::string& domainName) const {
+    for (size_t i = 0; i < domains.size(); i++) {
+        if (domains[i].name == domainName) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void RuleNetwork::addComplexType(const ComplexType& type) {
+    if (typeIds.count(type.name) > 0) {
+        error("Complex " + type.name + " is declared more than once.");
+    }
+    for (size_t i = 0; i < type.domains.size(); i++) {
+        if (type.findDomain(type.domains[i].name) != (int) i) {
+            error("Complex " + type.name + " declares domain " + type.domains[i].name + " more than once.");
+        }
+    }
+    typeIds[type.name] = types.size();
+    types.push_back(type);
+}
+
+int RuleNetwork::findComplexType(const std::string& name) const {
+    auto found = typeIds.find(name);
+    return found == typeIds.end() ? -1 : found->second;
+}
+
+const ComplexType& RuleNetwork::getComplexType(int type) const {
+    return types[type];
+}
+
+/* pattern := agent ('.' agent)*
+   agent   := complex '(' [site (',' site)*] ')'
+   site    := domain [':' state] ['!' (label | '+' | '?')] */
+Pattern RuleNetwork::parsePattern(const std::string& text) const {
+    Pattern pattern;
+    size_t pos = 0;
+    auto fail = [&text](const std::string& message) {
+        error("Complex pattern " + text + ": " + message + ".");
+    };
+    auto consume = [&text, &pos](char c) {
+        if (pos < text.size() && text[pos] == c) {
+            pos++;
+            return true;
+        }
+        return false;
+    };
+    auto name = [&]() {
+        size_t start = pos;
+        while (pos < text.size() && (std::isalnum(static_cast<unsigned char>(text[pos])) || text[pos] == '_')) {
+            pos++;
+        }
+        if (start == pos) {
+            fail("expected a name at \"" + text.substr(pos) + "\"");
+        }
+        return text.substr(start, pos - start);
+    };
+
+    std::unordered_map<int, int> labelCounts;
+    do {
+        std::string typeName = name();
+        AgentPattern agent;
+        agent.type = findComplexType(typeName);
+        if (agent.type < 0) {
+            fail(typeName + " is not a complex");
+        }
+        const ComplexType& type = types[agent.type];
+        if (!consume('(')) {
+            fail("expected ( after " + typeName);
+        }
+        while (!consume(')')) {
+            if (!agent.sites.empty() && !consume(',')) {
+                fail("expected , or ) in " + typeName);
+            }
+            std::string domainName = name();
+            SitePattern site;
+            site.domain = type.findDomain(domainName);
+            if (site.domain < 0) {
+                fail(typeName + " has no domain " + domainName);
+            }
+            for (const SitePattern& other : agent.sites) {
+                if (other.domain == site.domain) {
+                    fail("domain " + domainName + " of " + typeName + " is given more than once");
+                }
+            }
+            if (consume(':')) {
+                const std::vector<std::string>& states = type.domains[site.domain].states;
+                std::string stateName = name();
+                auto state = std::find(states.begin(), states.end(), stateName);
+                if (state == states.end()) {
+                    fail("domain " + domainName + " of " + typeName + " has no state " + stateName);
+                }
+                site.state = state - states.begin();
+            }
+            site.bond = BOND::FREE;
+            if (consume('!')) {
+                if (consume('+')) {
+                    site.bond = BOND::BOUND;
+                } else if (consume('?')) {
+                    site.bond = BOND::ANY;
+                } else {
+                    size_t start = pos;
+                    while (pos < text.size() && std::isdigit(static_cast<unsigned char>(text[pos]))) {
+                        pos++;
+                    }
+                    if (start == pos) {
+                        fail("expected a bond label, + or ? after " + domainName + "!");
+                    }
+                    site.bond = BOND::LABEL;
+                    site.label = std::stoi(text.substr(start, pos - start));
+                    labelCounts[site.label]++;
+                }
+            }
+            agent.sites.push_back(site);
+        }
+        pattern.agents.push_back(agent);
+    } while (consume('.'));
+
+    if (pos != text.size()) {
+        fail("unexpected \"" + text.substr(pos) + "\"");
+    }
+    for (const auto& [bondLabel, count] : labelCounts) {
+        if (count != 2) {
+            fail("bond label " + std::to_string(bondLabel) + " must join exactly two domains");
+        }
+    }
+    return pattern;
+}
+
+SpeciesGraph RuleNetwork::parseSpecies(const std::string& text) const {
+    Pattern pattern = parsePattern(text);
+    SpeciesGraph graph;
+    std::unordered_map<int, std::pair<int, int>> openBonds;     // label -> first agent and domain
+    for (size_t i = 0; i < pattern.agents.size(); i++) {
+        const AgentPattern& agentPattern = pattern.agents[i];
+        const ComplexType& type = types[agentPattern.type];
+        Agent agent;
+        agent.type = agentPattern.type;
+        agent.sites.resize(type.domains.size());
+        for (size_t d = 0; d < type.domains.size(); d++) {
+            agent.sites[d].state = type.domains[d].states.empty() ? -1 : 0;
+        }
+        for (const SitePattern& site : agentPattern.sites) {
+            if (site.state >= 0) {
+                agent.sites[site.domain].state = site.state;
+            }
+            if (site.bond == BOND::ANY || site.bond == BOND::BOUND) {
+                error("Species " + text + " must label its bonds; !+ and !? only match.");
+            }
+            if (site.bond == BOND::LABEL) {
+                auto open = openBonds.find(site.label);
+                if (open == openBonds.end()) {
+                    openBonds[site.label] = { i, site.domain };
+                } else {
+                    auto [partner, partnerDomain] = open->second;
+                    agent.sites[site.domain].agent = partner;
+                    agent.sites[site.domain].domain = partnerDomain;
+                    // the partner is either an earlier agent or this one
+                    Site& partnerSite = (partner == (int) i ? agent : graph.agents[partner]).sites[partnerDomain];
+                    partnerSite.agent = i;
+                    partnerSite.domain = site.domain;
+                }
+            }
+        }
+        graph.agents.push_back(agent);
+    }
+    return graph;
+}
+
+static bool samePattern(const Pattern& first, const Pattern& second) {
+    if (first.agents.size() != second.agents.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < first.agents.size(); i++) {
+        const AgentPattern& a = first.agents[i];
+        const AgentPattern& b = second.agents[i];
+        if (a.type != b.type || a.sites.size() != b.sites.size()) {
+            return false;
+        }
+        for (size_t j = 0; j < a.sites.size(); j++) {
+            if (a.sites[j].domain != b.sites[j].domain || a.sites[j].state != b.sites[j].state ||
+                a.sites[j].bond != b.sites[j].bond || a.sites[j].label != b.sites[j].label) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static const SitePattern* findSite(const AgentPattern& agent, int domain) {
+    for (const SitePattern& site : agent.sites) {
+        if (site.domain == domain) {
+            return &site;
+        }
+    }
+    return nullptr;
+}
+
+void RuleNetwork::addRule(const std::string& name, const std::vector<Pattern>& reactants,
+                          const std::vector<Pattern>& products, double rate) {
+    if (reactants.empty() || reactants.size() > 2) {
+        error("Rule " + name + " has " + std::to_string(reactants.size()) +
+              " reactants; only uni- and bimolecular rules are supported.");
+    }
+    Rule rule;
+    rule.name = name;
+    rule.reactants = reactants;
+    rule.rate = rate;
+    rule.symmetric = reactants.size() == 2 && samePattern(reactants[0], reactants[1]);
+    compileRule(rule, products);
+    rules.push_back(rule);
+
+    // species reached before the rule was declared
+    int ruleId = rules.size() - 1;
+    for (size_t i = 0; i < reachedOrder.size(); i++) {
+        applyRule(ruleId, reachedOrder[i], i + 1);
+    }
+}
+
+const std::string& RuleNetwork::getRuleName(int rule) const {
+    return rules[rule].name;
+}
+
+size_t RuleNetwork::ruleCount() const {
+    return rules.size();
+}
+
+const RuleNetwork::Rule& RuleNetwork::getRule(int rule) const {
+    return rules[rule];
+}
+
+size_t RuleNetwork::complexTypeCount() const {
+    return types.size();
+}
+
+/* Flattens the agents of both sides in order of appearance and records what the rule changes: states, bonds
+   that are no longer there (or are made free), and bonds that are new. */
+void RuleNetwork::compileRule(Rule& rule, const std::vector<Pattern>& products) const {
+    std::vector<const AgentPattern*> left;
+    std::vector<const AgentPattern*> right;
+    for (const Pattern& pattern : rule.reactants) {
+        rule.offsets.push_back(left.size());
+        for (const AgentPattern& agent : pattern.agents) {
+            left.push_back(&agent);
+        }
+    }
+    for (const Pattern& pattern : products) {
+        for (const AgentPattern& agent : pattern.agents) {
+            right.push_back(&agent);
+        }
+    }
+    bool sameAgents = left.size() == right.size();
+    for (size_t i = 0; sameAgents && i < left.size(); i++) {
+        sameAgents = left[i]->type == right[i]->type;
+    }
+    if (!sameAgents) {
+        error("Rule " + rule.name + " must keep its complexes: both sides list the same complexes in the same order.");
+    }
+
+    auto bondsOf = [](const std::vector<Pattern>& side) {
+        std::vector<Bond> bonds;
+        int offset = 0;
+        for (const Pattern& pattern : side) {
+            std::unordered_map<int, RuleSite> open;
+            for (size_t i = 0; i < pattern.agents.size(); i++) {
+                for (const SitePattern& site : pattern.agents[i].sites) {
+                    if (site.bond != BOND::LABEL) {
+                        continue;
+                    }
+                    RuleSite ruleSite = { offset + (int) i, site.domain };
+                    auto first = open.find(site.label);
+                    if (first == open.end()) {
+                        open[site.label] = ruleSite;
+                    } else {
+                        bonds.push_back({ first->second, ruleSite });
+                    }
+                }
+            }
+            offset += pattern.agents.size();
+        }
+        return bonds;
+    };
+    auto sameSite = [](const RuleSite& a, const RuleSite& b) {
+        return a.agent == b.agent && a.domain == b.domain;
+    };
+    auto contains = [&sameSite](const std::vector<Bond>& bonds, const Bond& bond) {
+        return std::any_of(bonds.begin(), bonds.end(), [&](const Bond& other) {
+            return (sameSite(other.first, bond.first) && sameSite(other.second, bond.second)) ||
+                   (sameSite(other.first, bond.second) && sameSite(other.second, bond.first));
+        });
+    };
+    std::vector<Bond> reactantBonds = bondsOf(rule.reactants);
+    std::vector<Bond> productBonds = bondsOf(products);
+
+    for (size_t i = 0; i < right.size(); i++) {
+        for (const SitePattern& site : right[i]->sites) {
+            const SitePattern* before = findSite(*left[i], site.domain);
+            if (site.state >= 0 && (before == nullptr || before->state != site.state)) {
+                rule.stateChanges.push_back({ { (int) i, site.domain }, site.state });
+            }
+            if (site.bond == BOND::FREE && (before == nullptr || before->bond != BOND::FREE)) {
+                rule.breaks.push_back({ (int) i, site.domain });
+            }
+        }
+    }
+    for (const Bond& bond : reactantBonds) {
+        if (!contains(productBonds, bond)) {
+            rule.breaks.push_back(bond.first);
+        }
+    }
+    for (const Bond& bond : productBonds) {
+        if (!contains(reactantBonds, bond)) {
+            rule.bonds.push_back(bond);
+        }
+    }
+}
+
+int RuleNetwork::addSpecies(SpeciesGraph graph) {
+    std::string text = canonicalize(graph);
+    return addCanonical(text, std::move(graph));
+}
+
+int RuleNetwork::addCanonical(const std::string& text, SpeciesGraph graph) {
+    auto found = speciesIds.find(text);
+    if (found != speciesIds.end()) {
+        return found->second;
+    }
+    int id = species.size();
+    speciesIds[text] = id;
+    species.push_back(std::move(graph));
+    labels.push_back(text);
+    reached.push_back(false);
+    return id;
+}
+
+size_t RuleNetwork::speciesCount() const {
+    return species.size();
+}
+
+const SpeciesGraph& RuleNetwork::getSpecies(int speciesId) const {
+    return species[speciesId];
+}
+
+const std::string& RuleNetwork::getLabel(int speciesId) const {
+    return labels[speciesId];
+}
+
+int RuleNetwork::findSpecies(const std::string& text) const {
+    auto found = speciesIds.find(text);
+    return found == speciesIds.end() ? -1 : found->second;
+}
+
+bool RuleNetwork::isReached(int speciesId) const {
+    return reached[speciesId];
+}
+
+size_t RuleNetwork::reach(int speciesId) {
+    if (reached[speciesId]) {
+        return 0;
+    }
+    size_t before = reactions.size();
+    reached[speciesId] = true;
+    reachedOrder.push_back(speciesId);
+    for (size_t rule = 0; rule < rules.size(); rule++) {
+        applyRule(rule, speciesId, reachedOrder.size());
+    }
+    return reactions.size() - before;
+}
+
+const std::vector<NetworkReaction>& RuleNetwork::getReactions() const {
+    return reactions;
+}
+
+void RuleNetwork::setLimits(size_t newMaxSpecies, size_t newMaxReactions) {
+    maxSpecies = newMaxSpecies;
+    maxReactions = newMaxReactions;
+}
+
+bool RuleNetwork::isTruncated() const {
+    return truncated;
+}
+
+/* Applies rule to speciesId, and for bimolecular rules to speciesId together with each of the first partners
+   reached species. Every reaction of a set of reactant species is found by one call, so its rate is final. */
+void RuleNetwork::applyRule(int rule, int speciesId, size_t partners) {
+    if (rules[rule].reactants.size() == 1) {
+        for (const std::vector<int>& embedding : match(rules[rule].reactants[0], species[speciesId])) {
+            applyTo(rule, { speciesId }, { &embedding }, 1);
+        }
+        return;
+    }
+    for (size_t i = 0; i < partners; i++) {
+        int partner = reachedOrder[i];
+        std::vector<std::pair<int, int>> orders = { { speciesId, partner } };
+        if (partner != speciesId && !rules[rule].symmetric) {
+            orders.push_back({ partner, speciesId });
+        }
+        for (auto [first, second] : orders) {
+            std::vector<std::vector<int>> firstEmbeddings = match(rules[rule].reactants[0], species[first]);
+            std::vector<std::vector<int>> secondEmbeddings = match(rules[rule].reactants[1], species[second]);
+            // A + A on two copies of one species finds every pair twice
+            double multiplicity = rules[rule].symmetric && first == second ? 0.5 : 1;
+            for (const std::vector<int>& firstEmbedding : firstEmbeddings) {
+                for (const std::vector<int>& secondEmbedding : secondEmbeddings) {
+                    applyTo(rule, { first, second }, { &firstEmbedding, &secondEmbedding }, multiplicity);
+                }
+            }
+        }
+    }
+}
+
+void RuleNetwork::applyTo(int ruleId, const std::vector<int>& reactantIds,
+                          const std::vector<const std::vector<int>*>& embeddings, double multiplicity) {
+    if (truncated) {
+        return;
+    }
+    const Rule& rule = rules[ruleId];
+
+    // copies of the reactants side by side; rule agent -> agent of the copy
+    SpeciesGraph combined;
+    std::vector<int> ruleAgents;
+    for (size_t i = 0; i < reactantIds.size(); i++) {
+        int offset = combined.agents.size();
+        for (Agent agent : species[reactantIds[i]].agents) {
+            for (Site& site : agent.sites) {
+                if (site.agent >= 0) {
+                    site.agent += offset;
+                }
+            }
+            combined.agents.push_back(agent);
+        }
+        for (int agent : *embeddings[i]) {
+            ruleAgents.push_back(offset + agent);
+        }
+    }
+    auto siteOf = [&](const RuleSite& ruleSite) -> Site& {
+        return combined.agents[ruleAgents[ruleSite.agent]].sites[ruleSite.domain];
+    };
+
+    for (const StateChange& change : rule.stateChanges) {
+        siteOf(change.site).state = change.state;
+    }
+    for (const RuleSite& ruleSite : rule.breaks) {
+        Site& site = siteOf(ruleSite);
+        if (site.agent >= 0) {
+            Site& partner = combined.agents[site.agent].sites[site.domain];
+            partner.agent = partner.domain = -1;
+            site.agent = site.domain = -1;
+        }
+    }
+    for (const Bond& bond : rule.bonds) {
+        Site& first = siteOf(bond.first);
+        Site& second = siteOf(bond.second);
+        if (first.agent >= 0 || second.agent >= 0) {
+            // the domain is taken in this species; the rule does not apply here
+            return;
+        }
+        first.agent = ruleAgents[bond.second.agent];
+        first.domain = bond.second.domain;
+        second.agent = ruleAgents[bond.first.agent];
+        second.domain = bond.first.domain;
+    }
+
+    // the products are the connected parts of the result
+    std::vector<int> productIds;
+    std::vector<int> component(combined.agents.size(), -1);
+    for (size_t start = 0; start < combined.agents.size(); start++) {
+        if (component[start] >= 0) {
+            continue;
+        }
+        std::vector<int> members = { (int) start };
+        component[start] = start;
+        for (size_t i = 0; i < members.size(); i++) {
+            for (const Site& site : combined.agents[members[i]].sites) {
+                if (site.agent >= 0 && component[site.agent] < 0) {
+                    component[site.agent] = start;
+                    members.push_back(site.agent);
+                }
+            }
+        }
+        std::unordered_map<int, int> index;
+        for (size_t i = 0; i < members.size(); i++) {
+            index[members[i]] = i;
+        }
+        SpeciesGraph product;
+        for (int member : members) {
+            Agent agent = combined.agents[member];
+            for (Site& site : agent.sites) {
+                if (site.agent >= 0) {
+                    site.agent = index[site.agent];
+                }
+            }
+            product.agents.push_back(agent);
+        }
+        std::string text = canonicalize(product);
+        int productId = findSpecies(text);
+        if (productId < 0) {
+            if (species.size() >= maxSpecies) {
+                truncated = true;
+                return;
+            }
+            productId = addCanonical(text, std::move(product));
+        }
+        productIds.push_back(productId);
+    }
+
+    std::vector<int> sortedReactants = reactantIds;
+    std::sort(sortedReactants.begin(), sortedReactants.end());
+    std::sort(productIds.begin(), productIds.end());
+    if (sortedReactants == productIds) {
+        return;
+    }
+    addReaction(ruleId, sortedReactants, productIds, rule.rate * multiplicity);
+}
+
+void RuleNetwork::addReaction(int rule, std::vector<int> reactantIds, std::vector<int> productIds, double rate) {
+    std::string key = std::to_string(rule) + ":";
+    for (int reactant : reactantIds) {
+        key += std::to_string(reactant) + ",";
+    }
+    key += ">";
+    for (int product : productIds) {
+        key += std::to_string(product) + ",";
+    }
+    auto found = reactionIds.find(key);
+    if (found != reactionIds.end()) {
+        reactions[found->second].rate += rate;
+        return;
+    }
+    if (reactions.size() >= maxReactions) {
+        truncated = true;
+        return;
+    }
+    reactionIds[key] = reactions.size();
+    reactions.push_back({ rule, std::move(reactantIds), std::move(productIds), rate });
+}
+
+std::vector<std::vector<int>> RuleNetwork::match(const Pattern& pattern, const SpeciesGraph& graph) const {
+    std::vector<std::vector<int>> embeddings;
+    std::vector<int> mapped(pattern.agents.size(), -1);
+    std::vector<bool> used(graph.agents.size(), false);
+    std::function<void(size_t)> extend = [&](size_t next) {
+        if (next == pattern.agents.size()) {
+            embeddings.push_back(mapped);
+            return;
+        }
+        for (size_t agent = 0; agent < graph.agents.size(); agent++) {
+            if (used[agent] || !matchAgent(pattern, next, graph, agent, mapped)) {
+                continue;
+            }
+            mapped[next] = agent;
+            used[agent] = true;
+            extend(next + 1);
+            used[agent] = false;
+            mapped[next] = -1;
+        }
+    };
+    extend(0);
+    return embeddings;
+}
+
+// Bonds to pattern agents that are not mapped yet are checked when their other end is mapped.
+bool RuleNetwork::matchAgent(const Pattern& pattern, int patternAgent, const SpeciesGraph& graph, int agent,
+                             const std::vector<int>& mapped) const {
+    const AgentPattern& agentPattern = pattern.agents[patternAgent];
+    const Agent& candidate = graph.agents[agent];
+    if (candidate.type != agentPattern.type) {
+        return false;
+    }
+    for (const SitePattern& sitePattern : agentPattern.sites) {
+        const Site& site = candidate.sites[sitePattern.domain];
+        if (sitePattern.state >= 0 && site.state != sitePattern.state) {
+            return false;
+        }
+        switch (sitePattern.bond) {
+            case BOND::ANY:
+                break;
+            case BOND::FREE:
+                if (site.agent >= 0) {
+                    return false;
+                }
+                break;
+            case BOND::BOUND:
+                if (site.agent < 0) {
+                    return false;
+                }
+                break;
+            case BOND::LABEL: {
+                if (site.agent < 0) {
+                    return false;
+                }
+                for (size_t other = 0; other < pattern.agents.size(); other++) {
+                    for (const SitePattern& end : pattern.agents[other].sites) {
+                        bool isPartner = end.bond == BOND::LABEL && end.label == sitePattern.label &&
+                                         !((int) other == patternAgent && end.domain == sitePattern.domain);
+                        if (!isPartner) {
+                            continue;
+                        }
+                        int partnerAgent = (int) other == patternAgent ? agent : mapped[other];
+                        if (partnerAgent >= 0 && (site.agent != partnerAgent || site.domain != end.domain)) {
+                            return false;
+                        }
+                    }
+                }
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+/* Every root gives one depth-first order of the agents (domains are ordered, and each is bound at most once),
+   and so one label. The smallest label over all roots only depends on the graph. */
+std::string RuleNetwork::canonicalize(SpeciesGraph& graph) const {
+    std::string best;
+    std::vector<int> bestOrder;
+    std::vector<int> order;
+    for (size_t root = 0; root < graph.agents.size(); root++) {
+        std::string text = label(graph, root, &order);
+        if (order.size() != graph.agents.size()) {
+            error("Species " + text + " is not connected; bind its complexes to each other.");
+        }
+        if (root == 0 || text < best) {
+            best = text;
+            bestOrder = order;
+        }
+    }
+    std::vector<int> position(graph.agents.size());
+    for (size_t i = 0; i < bestOrder.size(); i++) {
+        position[bestOrder[i]] = i;
+    }
+    SpeciesGraph ordered;
+    for (int agentIndex : bestOrder) {
+        Agent agent = graph.agents[agentIndex];
+        for (Site& site : agent.sites) {
+            if (site.agent >= 0) {
+                site.agent = position[site.agent];
+            }
+        }
+        ordered.agents.push_back(agent);
+    }
+    graph = std::move(ordered);
+    return best;
+}
+
+std::string RuleNetwork::label(const SpeciesGraph& graph, int root, std::vector<int>* order) const {
+    std::vector<bool> visited(graph.agents.size(), false);
+    std::vector<std::pair<int, size_t>> stack = { { root, 0 } };    // agent, next domain
+    order->assign(1, root);
+    visited[root] = true;
+    while (!stack.empty()) {
+        auto [agent, domain] = stack.back();
+        if (domain == graph.agents[agent].sites.size()) {
+            stack.pop_back();
+            continue;
+        }
+        stack.back().second++;
+        int partner = graph.agents[agent].sites[domain].agent;
+        if (partner >= 0 && !visited[partner]) {
+            visited[partner] = true;
+            order->push_back(partner);
+            stack.push_back({ partner, 0 });
+        }
+    }
+
+    std::string text;
+    std::vector<std::vector<int>> bondLabels(graph.agents.size());
+    int nextLabel = 1;
+    for (size_t i = 0; i < order->size(); i++) {
+        int agentIndex = (*order)[i];
+        const Agent& agent = graph.agents[agentIndex];
+        const ComplexType& type = types[agent.type];
+        bondLabels[agentIndex].resize(agent.sites.size(), 0);
+        text += (i > 0 ? "." : "") + type.name + "(";
+        for (size_t d = 0; d < agent.sites.size(); d++) {
+            const Site& site = agent.sites[d];
+            text += (d > 0 ? "," : "") + type.domains[d].name;
+            if (site.state >= 0) {
+                text += ":" + type.domains[d].states[site.state];
+            }
+            if (site.agent >= 0) {
+                int& bondLabel = bondLabels[agentIndex][d];
+                if (bondLabel == 0) {
+                    bondLabel = nextLabel++;
+                    std::vector<int>& partnerLabels = bondLabels[site.agent];
+                    partnerLabels.resize(graph.agents[site.agent].sites.size(), 0);
+                    partnerLabels[site.domain] = bondLabel;
+                }
+                text += "!" + std::to_string(bondLabel);
+            }
+        }
+        text += ")";
+    }
+    return text;
+}
+
+}
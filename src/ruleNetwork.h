@@ -0,0 +1,210 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lcc {
+
+/*  Rule Network:
+    --------------------------------------
+    Rule-based models over complexes with domains:
+
+        complex EGF { domain rec; }
+        complex EGFR {
+            domain lig;
+            domain Y1(off, on);
+        }
+        reaction bind(EGF(rec) + EGFR(lig) --> EGF(rec!1).EGFR(lig!1), k = 1, krev = 0.1);
+        reaction phos(EGFR(lig!+, Y1:off) --> EGFR(lig!+, Y1:on), k = 0.5);
+        EGF(rec) = 100;
+        EGFR(lig, Y1:off) = 50;
+
+    A species is a connected graph of agents, one per complex in it, whose
+    domains carry a state and are bound in pairs. A pattern describes part of
+    a species, domain by domain:
+        lig         free
+        lig!1       bound to the domain labelled 1 in the same pattern
+        lig!+       bound to anything
+        lig!?       bound or free (same as leaving lig out)
+        Y1:on       in state on
+    A rule rewrites the agents of its reactant patterns into the agents of its
+    product patterns, in order of appearance. It may change states and make or
+    break bonds, but not create or destroy agents.
+
+    The network is generated lazily. A species is known as soon as a reaction
+    produces it, but rules are only applied to it once it is reached (reach()),
+    ie. once a simulation first gives it a nonzero population. Species are
+    deduplicated by a canonical label, so a model whose full network is far
+    too large to enumerate only costs the part a simulation visits, and the
+    limits stop the expansion in any case.
+*/
+
+struct DomainType {
+    std::string name;
+    std::vector<std::string> states;    // empty if the domain has no state
+};
+
+struct ComplexType {
+    std::string name;
+    std::vector<DomainType> domains;
+
+    // -1 if the complex has no such domain
+    int findDomain(const std::string& domainName) const;
+};
+
+// One domain of an agent in a species
+struct Site {
+    int state = -1;         // index in DomainType::states, -1 if the domain has none
+    int agent = -1;         // bound partner, -1 if free
+    int domain = -1;
+};
+
+struct Agent {
+    int type;
+    std::vector<Site> sites;    // one per domain of the type, in declaration order
+};
+
+// Connected graph of agents. Species are kept in canonical agent order.
+struct SpeciesGraph {
+    std::vector<Agent> agents;
+};
+
+enum class BOND {
+    ANY,        // lig!? or lig left out
+    FREE,       // lig
+    BOUND,      // lig!+
+    LABEL       // lig!1
+};
+
+struct SitePattern {
+    int domain;
+    int state = -1;         // -1 matches any state
+    BOND bond = BOND::ANY;
+    int label = -1;         // BOND::LABEL only
+};
+
+struct AgentPattern {
+    int type;
+    std::vector<SitePattern> sites;     // the domains the pattern mentions
+};
+
+// One complex pattern, ie. EGF(rec!1).EGFR(lig!1)
+struct Pattern {
+    std::vector<AgentPattern> agents;
+};
+
+struct NetworkReaction {
+    int rule;
+    std::vector<int> reactants;     // species IDs, with repeats for A + A
+    std::vector<int> products;
+    double rate;                    // rate of the rule times the number of ways it applies
+};
+
+class RuleNetwork {
+    public:
+        RuleNetwork() {}
+
+        static constexpr size_t DEFAULT_MAX_SPECIES = 1 << 20;
+        static constexpr size_t DEFAULT_MAX_REACTIONS = 1 << 24;
+
+        void addComplexType(const ComplexType& type);
+        // -1 if there is no complex named name
+        int findComplexType(const std::string& name) const;
+        const ComplexType& getComplexType(int type) const;
+        size_t complexTypeCount() const;
+
+        Pattern parsePattern(const std::string& text) const;
+        /* Species written as a pattern, ie. a seed: domains left out are free and in their
+           first state, and bonds must be labelled. */
+        SpeciesGraph parseSpecies(const std::string& text) const;
+
+        /* Adds the rule reactants --> products and applies it to every species reached so far.
+           Only uni- and bimolecular rules are supported. */
+        void addRule(const std::string& name, const std::vector<Pattern>& reactants,
+                     const std::vector<Pattern>& products, double rate);
+        const std::string& getRuleName(int rule) const;
+
+        // ID of the species, added if it is new; graph must be connected
+        int addSpecies(SpeciesGraph graph);
+        size_t speciesCount() const;
+        const SpeciesGraph& getSpecies(int species) const;
+        const std::string& getLabel(int species) const;
+        // -1 if no species has the label
+        int findSpecies(const std::string& label) const;
+
+        bool isReached(int species) const;
+        /* Applies every rule to species, alone and together with every species reached before.
+           Returns the number of reactions added (the last ones in getReactions()). */
+        size_t reach(int species);
+        const std::vector<NetworkReaction>& getReactions() const;
+
+        // expansion stops at whichever is hit first
+        void setLimits(size_t newMaxSpecies, size_t newMaxReactions);
+        // true once a limit has stopped the expansion
+        bool isTruncated() const;
+
+        // every embedding of pattern in species, as pattern agent -> species agent
+        std::vector<std::vector<int>> match(const Pattern& pattern, const SpeciesGraph& species) const;
+        // canonical label of a connected graph; reorders its agents into canonical order
+        std::string canonicalize(SpeciesGraph& graph) const;
+
+        // a domain of the agents of a rule's reactants (and products), flattened in order
+        struct RuleSite {
+            int agent;
+            int domain;
+        };
+        struct StateChange {
+            RuleSite site;
+            int state;
+        };
+        struct Bond {
+            RuleSite first;
+            RuleSite second;
+        };
+        struct Rule {
+            std::string name;
+            std::vector<Pattern> reactants;
+            std::vector<int> offsets;           // first flattened agent of each reactant
+            double rate;
+            bool symmetric;                     // A + A: each pair of species is counted once
+            std::vector<StateChange> stateChanges;
+            std::vector<RuleSite> breaks;
+            std::vector<Bond> bonds;
+        };
+
+        size_t ruleCount() const;
+        // compiled rule, for engines that apply rules to agents directly (see agentSimulator.h)
+        const Rule& getRule(int rule) const;
+
+    private:
+        void compileRule(Rule& rule, const std::vector<Pattern>& products) const;
+        int addCanonical(const std::string& text, SpeciesGraph graph);
+        void applyRule(int rule, int species, size_t partners);
+        void applyTo(int rule, const std::vector<int>& species, const std::vector<const std::vector<int>*>& embeddings,
+                     double multiplicity);
+        void addReaction(int rule, std::vector<int> reactants, std::vector<int> products, double rate);
+        bool matchAgent(const Pattern& pattern, int patternAgent, const SpeciesGraph& species, int agent,
+                        const std::vector<int>& mapped) const;
+        std::string label(const SpeciesGraph& graph, int root, std::vector<int>* order) const;
+
+        std::vector<ComplexType> types;
+        std::unordered_map<std::string, int> typeIds;
+        std::vector<Rule> rules;
+
+        std::vector<SpeciesGraph> species;
+        std::vector<std::string> labels;
+        std::unordered_map<std::string, int> speciesIds;
+        std::vector<bool> reached;
+        std::vector<int> reachedOrder;
+
+        std::vector<NetworkReaction> reactions;
+        std::unordered_map<std::string, size_t> reactionIds;   // rule + reactants + products -> index in reactions
+
+        size_t maxSpecies = DEFAULT_MAX_SPECIES;
+        size_t maxReactions = DEFAULT_MAX_REACTIONS;
+        bool truncated = false;
+};
+
+}
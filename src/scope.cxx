@@ -1,34 +1,147 @@
 #include "scope.h"
-#include <stdexcept>
+#include "error.h"
+#include <functional>
 #include <iomanip>
 
 // Scope Class
 Scope::Scope() :
+    id(0),
     hasParent(false),
     parent(NULL)
     {}
 
-Scope::~Scope() {
-    std::cout << "Scope destructed" << std::endl;
+Scope::Scope(int newId, std::string newName, Scope* newParent) :
+    id(newId),
+    name(newName),
+    hasParent(newParent != NULL),
+    parent(newParent)
+    {}
+
+Scope::~Scope() {}
+
+int Scope::getId() {
+    return id;
+}
+
+void Scope::setId(int newId) {
+    id = newId;
+}
+
+const std::string& Scope::getName() {
+    return name;
+}
+
+/* Returns the hash slot holding symbol, or the empty slot where it would go.
+   The table is never more than half full, so an empty slot always exists. */
+size_t Scope::probe(const std::string& symbol, size_t hash) {
+    size_t mask = index.size() - 1;
+    size_t slot = hash & mask;
+    while (index[slot] != NO_SLOT) {
+        const Symbol& entry = symbols[index[slot]];
+        if (entry.hash == hash && entry.name == symbol) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+void Scope::grow() {
+    std::vector<int32_t> oldIndex;
+    oldIndex.swap(index);
+    index.assign(oldIndex.empty() ? 16 : oldIndex.size() * 2, NO_SLOT);
+    size_t mask = index.size() - 1;
+    for (size_t i = 0; i < symbols.size(); i++) {
+        size_t slot = symbols[i].hash & mask;
+        while (index[slot] != NO_SLOT) {
+            slot = (slot + 1) & mask;
+        }
+        index[slot] = i;
+    }
+}
+
+int Scope::insert(const std::string& newSymbol, size_t hash, Tokenizer::TokenType newType, SymbolValue newValue) {
+    if ((symbols.size() + 1) * 2 > index.size()) {
+        grow();
+    }
+    size_t slot = probe(newSymbol, hash);
+    if (index[slot] == NO_SLOT) {
+        index[slot] = symbols.size();
+        symbols.push_back({ newSymbol, newType, std::move(newValue), hash });
+    }
+    return index[slot];
+}
+
+int Scope::findSlot(const std::string& symbol) {
+    if (symbols.empty()) {
+        return NO_SLOT;
+    }
+    return index[probe(symbol, std::hash<std::string>{}(symbol))];
+}
+
+bool Scope::hasSymbol(const std::string& symbol) {
+    return findSlot(symbol) != NO_SLOT;
+}
+
+Tokenizer::TokenType Scope::getSymbolType(const std::string& symbol) {
+    int slot = findSlot(symbol);
+    if (slot == NO_SLOT) {
+        error("Symbol '" + symbol + "' doesn't exist in symbol table.\n");
+    }
+    return symbols[slot].type;
 }
 
-bool Scope::hasSymbol(std::string symbol) {
-    return symbolTable.count(symbol);
+SymbolValue Scope::getSymbolValue(const std::string& symbol) {
+    int slot = findSlot(symbol);
+    if (slot == NO_SLOT) {
+        error("Symbol '" + symbol + "' doesn't exist in symbol table.\n");
+    }
+    return symbols[slot].value;
 }
 
-Tokenizer::TokenType Scope::getSymbolType(std::string symbol) {
-    try {
-        return symbolTable.at(symbol).first;
-    } catch (const std::out_of_range& oor) {
-        fprintf(stderr, "Symbol doesn't exist in symbol table.\n");
+Scope* Scope::resolve(const std::string& symbol, int* slot) {
+    // hashed once for the whole walk up the tree
+    size_t hash = std::hash<std::string>{}(symbol);
+    for (Scope* scope = this; scope != NULL; scope = scope->parent) {
+        if (!scope->symbols.empty()) {
+            int found = scope->index[scope->probe(symbol, hash)];
+            if (found != NO_SLOT) {
+                *slot = found;
+                return scope;
+            }
+        }
     }
+    *slot = NO_SLOT;
+    return NULL;
 }
-std::variant<double, std::string> Scope::getSymbolValue(std::string symbol) {
-    try {
-        return symbolTable.at(symbol).second;
-    } catch (const std::out_of_range& oor) {
-        fprintf(stderr, "Symbol doesn't exist in symbol table.\n");
+
+const Scope::Symbol* Scope::lookup(const std::string& symbol) {
+    int slot;
+    Scope* scope = resolve(symbol, &slot);
+    if (scope == NULL) {
+        return NULL;
     }
+    return &scope->symbols[slot];
+}
+
+size_t Scope::size() {
+    return symbols.size();
+}
+
+const Scope::Symbol& Scope::getSymbol(int slot) {
+    return symbols[slot];
+}
+
+const std::string& Scope::getSymbolName(int slot) {
+    return symbols[slot].name;
+}
+
+Tokenizer::TokenType Scope::getSymbolType(int slot) {
+    return symbols[slot].type;
+}
+
+const SymbolValue& Scope::getSymbolValue(int slot) {
+    return symbols[slot].value;
 }
 
 bool Scope::hasParentScope() {
@@ -39,29 +152,32 @@ Scope* Scope::getParentScope() {
     return parent;
 }
 
+const std::vector<Scope*>& Scope::getChildScopes() {
+    return children;
+}
+
 Scope* Scope::getChildScope() {
-    return child;
-}
-
-void Scope::put(std::string newSymbol, Tokenizer::TokenType newType, std::variant<double, std::string> newValue) {
-    std::pair typeValue = { newType, newValue };
-    std::pair newPair = { newSymbol, typeValue };
-    symbolTable.insert(newPair);
-}
-
-void Scope::putVal(std::string newSymbol, std::variant<double, std::string> newValue) {
-    try {
-        std::cout << "\nputting val rn\n";
-        exit(1);
-        std::cout << "newsymbol: " << newSymbol << std::endl;
-        if (newValue.index() == 0)
-            std::cout << "newValue: " << std::get<double>(newValue) << std::endl;
-        else 
-            std::cout << "newValue: " << std::get<std::string>(newValue) << std::endl;
-        symbolTable.at(newSymbol).second = newValue;
-    } catch (const std::out_of_range& oor) {
-        std::string failMsg = "Cannot putVal() b/c symbol \'" + newSymbol + "\' doesn't exist in table.\n";
-        fprintf(stderr, failMsg.c_str());
+    if (children.empty()) {
+        return NULL;
+    }
+    return children.back();
+}
+
+int Scope::put(const std::string& newSymbol, Tokenizer::TokenType newType, SymbolValue newValue) {
+    return insert(newSymbol, std::hash<std::string>{}(newSymbol), newType, std::move(newValue));
+}
+
+void Scope::putVal(const std::string& newSymbol, SymbolValue newValue) {
+    int slot = findSlot(newSymbol);
+    if (slot == NO_SLOT) {
+        error("Cannot putVal() b/c symbol \'" + newSymbol + "\' doesn't exist in table.\n");
+    }
+    symbols[slot].value = std::move(newValue);
+}
+
+void Scope::putAll(Scope* other) {
+    for (const Symbol& entry : other->symbols) {
+        insert(entry.name, entry.hash, entry.type, entry.value);
     }
 }
 
@@ -70,23 +186,22 @@ void Scope::setParentScope(bool newHasParent, Scope* newParent) {
     parent = newParent;
 }
 
-void Scope::setChildScope(bool newHasChild, Scope* newChild) {
-    hasChild = newHasChild;
-    child = newChild;
+void Scope::addChildScope(Scope* newChild) {
+    children.push_back(newChild);
 }
 
 void Scope::printSymbolTable() {
     std::cout << std::left << "Key\t\t Type\t\t Value" << std::endl;
     std::cout << std::left << "-----\t\t -----\t\t -----" << std::endl;
-    for (auto const& entry : symbolTable) {
-        std::cout << std::left << entry.first << "\t\t " << Tokenizer::translateTokenType(entry.second.first) <<  "\t\t ";
-        if (entry.second.second.index() == 0) {
-            std::cout << std::get<double>(entry.second.second);
+    for (const Symbol& entry : symbols) {
+        std::cout << std::left << entry.name << "\t\t " << Tokenizer::translateTokenType(entry.type) <<  "\t\t ";
+        if (entry.value.index() == 0) {
+            std::cout << std::get<double>(entry.value);
         }
         else {
-            std::cout << std::get<std::string>(entry.second.second);
+            std::cout << std::get<std::string>(entry.value);
         }
-        
+
         std::cout << std::endl;
     }
-}
\ No newline at end of file
+}
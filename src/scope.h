@@ -1,30 +1,88 @@
 #pragma once
 
 #include "tokenizer.h"
-#include <unordered_map>
+#include <cstdint>
+#include <string>
 #include <variant>
+#include <vector>
 
+/*  Scope:
+    --------------------------------------
+    One node of the parser's scope tree. Every scope has an ID (its index in
+    the parser's scope table), a parent and any number of children.
+
+    Symbols are kept densely in declaration order and indexed by an
+    open-addressing hash table (linear probing, power-of-two capacity, at most
+    half full), so a symbol's slot stays valid for the lifetime of the scope
+    and lookups never allocate or throw.
+
+    Lookups are local (hasSymbol, findSlot) or walk up through the parents
+    (resolve, lookup).
+*/
+
+typedef std::variant<double, std::string> SymbolValue;
 
 class Scope {
       public:
+            static constexpr int NO_SLOT = -1;
+
+            struct Symbol {
+                  std::string name;
+                  Tokenizer::TokenType type;
+                  SymbolValue value;
+                  size_t hash;
+            };
+
             Scope();
+            Scope(int newId, std::string newName, Scope* newParent);
             ~Scope();
-            bool hasSymbol(std::string symbol);
-            Tokenizer::TokenType getSymbolType(std::string symbol);
-            std::variant<double, std::string> getSymbolValue(std::string symbol);
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+            int getId();
+            void setId(int newId);
+            const std::string& getName();
+
+            // local to this scope
+            bool hasSymbol(const std::string& symbol);
+            int findSlot(const std::string& symbol);
+            Tokenizer::TokenType getSymbolType(const std::string& symbol);
+            SymbolValue getSymbolValue(const std::string& symbol);
+
+            // this scope, then each parent in turn. NULL / NO_SLOT on a miss
+            Scope* resolve(const std::string& symbol, int* slot);
+            const Symbol* lookup(const std::string& symbol);
+
+            // slot accessors; slots are stable and numbered in declaration order
+            size_t size();
+            const Symbol& getSymbol(int slot);
+            const std::string& getSymbolName(int slot);
+            Tokenizer::TokenType getSymbolType(int slot);
+            const SymbolValue& getSymbolValue(int slot);
+
             bool hasParentScope();
             Scope* getParentScope();
-            Scope* getChildScope();
-            void put(std::string newSymbol, Tokenizer::TokenType newType, std::variant<double, std::string> newValue);
-            void putVal(std::string newSymbol, std::variant<double, std::string> newValue);
+            const std::vector<Scope*>& getChildScopes();
+            Scope* getChildScope();         // most recently added child
+
+            // returns the slot of newSymbol; an existing symbol keeps its value
+            int put(const std::string& newSymbol, Tokenizer::TokenType newType, SymbolValue newValue);
+            void putVal(const std::string& newSymbol, SymbolValue newValue);
+            // puts every symbol of other that is not yet in this scope
+            void putAll(Scope* other);
             void setParentScope(bool newHasParent, Scope* newParent);
-            void setChildScope(bool newHasChild, Scope* newChild);
+            void addChildScope(Scope* newChild);
             void printSymbolTable();
       private:
-            // std::unordered_map<std::string, Tokenizer::TokenType> symbolTable;
-            std::unordered_map<std::string, std::pair<Tokenizer::TokenType, std::variant<double, std::string>>> symbolTable;
+            size_t probe(const std::string& symbol, size_t hash);
+            int insert(const std::string& newSymbol, size_t hash, Tokenizer::TokenType newType, SymbolValue newValue);
+            void grow();
+
+            int id;
+            std::string name;
+            std::vector<Symbol> symbols;        // dense, in declaration order
+            std::vector<int32_t> index;         // hash slot -> symbols index, NO_SLOT if empty
             bool hasParent;
-            bool hasChild;
             Scope* parent;
-            Scope* child;
-};
\ No newline at end of file
+            std::vector<Scope*> children;
+};
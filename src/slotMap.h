@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/*  Slot Map:
+    --------------------------------------
+    Values addressed by stable handles, with O(1) insert, remove and replace.
+    The values themselves are kept densely in one vector (values()), so they
+    can be iterated like any other vector; removing a value moves the last one
+    into its place.
+
+    A handle names a slot, and a slot remembers where its value is in the
+    dense vector. Each slot also counts how many times it has been reused, and
+    a handle carries the count it was issued with, so a handle to a removed
+    value is detected (find() returns nullptr) instead of silently naming
+    whatever value took the slot over.
+*/
+
+struct SlotHandle {
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    uint32_t slot = NONE;
+    uint32_t generation = 0;
+
+    bool isNone() const { return slot == NONE; }
+    bool operator==(const SlotHandle& other) const { return slot == other.slot && generation == other.generation; }
+    bool operator!=(const SlotHandle& other) const { return !(*this == other); }
+};
+
+template<typename T>
+class SlotMap {
+    public:
+        SlotHandle insert(T value) {
+            uint32_t slot;
+            if (freeHead != SlotHandle::NONE) {
+                slot = freeHead;
+                freeHead = slots[slot].position;
+            } else {
+                slot = slots.size();
+                slots.push_back({ 0, 0 });
+            }
+            slots[slot].position = dense.size();
+            dense.push_back(std::move(value));
+            denseSlots.push_back(slot);
+            return { slot, slots[slot].generation };
+        }
+
+        // false for a handle whose value was removed
+        bool contains(SlotHandle handle) const {
+            // removing a value retires its slot's generation, so a free slot matches no handle
+            return handle.slot < slots.size() && slots[handle.slot].generation == handle.generation;
+        }
+
+        // nullptr for a handle whose value was removed
+        T* find(SlotHandle handle) {
+            return contains(handle) ? &dense[slots[handle.slot].position] : nullptr;
+        }
+        const T* find(SlotHandle handle) const {
+            return contains(handle) ? &dense[slots[handle.slot].position] : nullptr;
+        }
+
+        // handle must be contained
+        T& get(SlotHandle handle) {
+            return dense[slots[handle.slot].position];
+        }
+        const T& get(SlotHandle handle) const {
+            return dense[slots[handle.slot].position];
+        }
+
+        // position of the value in values(); handle must be contained
+        size_t positionOf(SlotHandle handle) const {
+            return slots[handle.slot].position;
+        }
+        SlotHandle handleAt(size_t position) const {
+            uint32_t slot = denseSlots[position];
+            return { slot, slots[slot].generation };
+        }
+
+        // same handle and position for the new value
+        void replace(SlotHandle handle, T value) {
+            get(handle) = std::move(value);
+        }
+
+        // handle must be contained; the last value moves into its position
+        void remove(SlotHandle handle) {
+            uint32_t position = slots[handle.slot].position;
+            uint32_t last = dense.size() - 1;
+            if (position != last) {
+                dense[position] = std::move(dense[last]);
+                denseSlots[position] = denseSlots[last];
+                slots[denseSlots[position]].position = position;
+            }
+            dense.pop_back();
+            denseSlots.pop_back();
+            slots[handle.slot].generation++;
+            slots[handle.slot].position = freeHead;
+            freeHead = handle.slot;
+        }
+
+        const std::vector<T>& values() const {
+            return dense;
+        }
+        size_t size() const {
+            return dense.size();
+        }
+
+    private:
+        struct Slot {
+            uint32_t position;      // in dense, or the next free slot once the slot is free
+            uint32_t generation;
+        };
+
+        std::vector<T> dense;
+        std::vector<uint32_t> denseSlots;   // position in dense -> slot
+        std::vector<Slot> slots;
+        uint32_t freeHead = SlotHandle::NONE;
+};
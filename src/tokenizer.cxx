@@ -124,7 +124,7 @@ CHARACTER_CLASS(Escape, c == 'a' || c == 'b' || c == 'f' || c == 'n' ||
 /* Sets needed for various important reserved keywords in L++ */
 std::unordered_set<std::string> reserved_imports {"Centrifuge", "Electrophoresis"};
 std::unordered_set<std::string> reserved_keywords { "import", "container", "protocol", "reagent", "protein", "reaction",
-                                                    "pathway", "membrane", "domain", "plasm"};
+                                                    "pathway", "membrane", "complex", "domain", "plasm"};
 std::unordered_set<std::string> reserved_functions { "getReagent", "mix", "add", "clear", 
                                                     "close", "pellet", "supernatant", "remove" };
 std::unordered_set<std::string> reserved_params { "ctr", "time", "spd", "vol", "temp", 
@@ -285,9 +285,41 @@ FileNode* Tokenizer::linkImports(std::string fileName, std::string directory, To
     return masterFile;
 }
 
+// true if name is followed by a range index, ie. R[0..999]
+static bool isSpeciesArray(Tokenizer::Token* name) {
+    Tokenizer::Token* cur = name->next;
+    if (cur == NULL || cur->type != Tokenizer::TYPE_SYMBOL_BRACKET_OPEN) {
+        return false;
+    }
+    for (cur = cur->next; cur != NULL && cur->type != Tokenizer::TYPE_SYMBOL_BRACKET_CLOSED &&
+                          cur->type != Tokenizer::TYPE_SYMBOL_SEMICOLON; cur = cur->next) {
+        if (cur->type == Tokenizer::TYPE_SYMBOL_RANGE) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void Tokenizer::findIdentifiers(Token* cur) {
     bool isIdentifier = false;
+    bool inComplex = false;     // from "complex" to the closing brace of its declaration
+    int complexDepth = 0;
     while (cur != NULL) {
+        if (cur->type == Tokenizer::TYPE_KEYWORD && cur->text == "complex") {
+            inComplex = true;
+        }
+        if (inComplex) {
+            // complex, domain and state names are names in reactions too, not chemicals
+            if (cur->type == Tokenizer::TYPE_IDENTIFIER) {
+                identifiers.insert(cur->text);
+            } else if (cur->type == Tokenizer::TYPE_SYMBOL_CURLY_OPEN) {
+                complexDepth++;
+            } else if (cur->type == Tokenizer::TYPE_SYMBOL_CURLY_CLOSED && --complexDepth == 0) {
+                inComplex = false;
+            }
+            cur = cur->next;
+            continue;
+        }
         if (cur->type == Tokenizer::TYPE_KEYWORD ||
             cur->type == Tokenizer::TYPE_PRIMITIVE ||
             cur->type == Tokenizer::TYPE_RETURN) {
@@ -306,6 +338,10 @@ void Tokenizer::findIdentifiers(Token* cur) {
             identifiers.insert(cur->text);
             std::cout << "LOCATED IDENTIFIER: " << cur->text << std::endl;
         }
+        else if (cur->type == Tokenizer::TYPE_IDENTIFIER && isSpeciesArray(cur)) {
+            // R[0..999]: elements keep the declared name in reactions, ie. R[3] and not a chemical R
+            identifiers.insert(cur->text);
+        }
         cur = cur->next;
     }
 }
@@ -373,15 +409,34 @@ static int callback(void *again, int count, char **data, char **columns) {
 }
 
 
+/* Returns the token after a balanced [...] starting at token, ie. the ( of
+   reaction bind[i](...), or token itself if it does not open a bracket. */
+static Tokenizer::Token* skipIndex(Tokenizer::Token* token) {
+    int depth = 0;
+    while (token != NULL && token->type != Tokenizer::TYPE_END) {
+        if (token->type == Tokenizer::TYPE_SYMBOL_BRACKET_OPEN) {
+            depth++;
+        } else if (token->type == Tokenizer::TYPE_SYMBOL_BRACKET_CLOSED && depth > 0) {
+            depth--;
+        } else if (depth == 0) {
+            return token;
+        }
+        token = token->next;
+    }
+    return token;
+}
+
 void Tokenizer::findChemicals(Token* root) {
     Token* cur = root;
     bool inParam = false;
     while (cur != NULL) {
         // if the marked identifier is NOT ACTUALLY an identifier,
         // it should be a chemical
-        if ((cur->text == "reaction" || cur->text == "reagent") && 
-            (cur->next->next->type == Tokenizer::TYPE_SYMBOL_PAREN_OPEN ||
-             cur->next->next->type == Tokenizer::TYPE_SYMBOL_CURLY_OPEN)) {
+        Token* afterName = (cur->text == "reaction" || cur->text == "reagent") && cur->next != NULL ?
+                           skipIndex(cur->next->next) : NULL;
+        if (afterName != NULL &&
+            (afterName->type == Tokenizer::TYPE_SYMBOL_PAREN_OPEN ||
+             afterName->type == Tokenizer::TYPE_SYMBOL_CURLY_OPEN)) {
             inParam = true;
         }
         else if (cur->type == Tokenizer::TYPE_SYMBOL_PAREN_CLOSED ||
@@ -520,9 +575,11 @@ Tokenizer::Token* Tokenizer::Next() {
             type_tbd = true;
         } else if (TryConsume('.')) {
             std::cout << "+ 2" << std::endl;
-            // This could be the beginning of a floating-point number, or it could
-            // just be a '.' symbol.
-            if (TryConsumeOne<Digit>()) {
+            // This could be the beginning of a floating-point number, a range
+            // (R[0..999]), or it could just be a '.' symbol.
+            if (TryConsume('.')) {
+                cur.type = TYPE_SYMBOL_RANGE;
+            } else if (TryConsumeOne<Digit>()) {
                 // It's a floating-point number.
                 if (prev.type == TYPE_IDENTIFIER &&
                     cur.line == prev.line &&
@@ -603,8 +660,69 @@ void Tokenizer::NextChar() {
 }
 
 void ErrorCollector::AddError(int line, ColumnNumber column, const std::string& message) {
-    std::cout << message << " at <" << line << ", " << column << ">\n";
-    // error(message);
+    if (echo) {
+        std::cout << message << " at <" << line << ", " << column << ">\n";
+    }
+    diagnostics.push_back({ true, line, column, message });
+    errorCount++;
+    if (maxErrors > 0 && errorCount >= maxErrors) {
+        std::cout << "Too many errors (limit " << maxErrors << "), stopping." << std::endl;
+        PrintSummary();
+        exit(1);
+    }
+}
+
+void ErrorCollector::AddWarning(int line, ColumnNumber column, const std::string& message) {
+    if (echo) {
+        std::cout << "warning: " << message << " at <" << line << ", " << column << ">\n";
+    }
+    diagnostics.push_back({ false, line, column, message });
+    warningCount++;
+}
+
+void ErrorCollector::AddAll(const ErrorCollector& other) {
+    for (const Diagnostic& diagnostic : other.GetDiagnostics()) {
+        if (diagnostic.isError) {
+            AddError(diagnostic.line, diagnostic.column, diagnostic.message);
+        } else {
+            AddWarning(diagnostic.line, diagnostic.column, diagnostic.message);
+        }
+    }
+}
+
+void ErrorCollector::SetMaxErrors(int newMaxErrors) {
+    maxErrors = newMaxErrors;
+}
+
+int ErrorCollector::GetMaxErrors() const {
+    return maxErrors;
+}
+
+int ErrorCollector::GetErrorCount() const {
+    return errorCount;
+}
+
+int ErrorCollector::GetWarningCount() const {
+    return warningCount;
+}
+
+const std::vector<ErrorCollector::Diagnostic>& ErrorCollector::GetDiagnostics() const {
+    return diagnostics;
+}
+
+void ErrorCollector::PrintSummary() const {
+    for (const Diagnostic& diagnostic : diagnostics) {
+        std::string message = diagnostic.message;
+        while (!message.empty() && message.back() == '\n') {
+            message.pop_back();
+        }
+        fprintf(stderr, "%s: %s", diagnostic.isError ? "error" : "warning", message.c_str());
+        if (diagnostic.line >= 0) {
+            fprintf(stderr, " at <%d, %d>", diagnostic.line, diagnostic.column);
+        }
+        fprintf(stderr, "\n");
+    }
+    fprintf(stderr, "%d error(s), %d warning(s) generated.\n", errorCount, warningCount);
 }
 
 void Tokenizer::AddError(const std::string& message) {
@@ -1092,7 +1210,9 @@ Tokenizer::TokenType Tokenizer::ConsumeNumber(bool started_with_dot) {
     } else {
         /* Supports numbers w/ leading zeroes like "0.5" */
         ConsumeZeroOrMore<Digit>();
-        if (TryConsume('.')) {
+        // "0..999" is an integer followed by a range
+        bool isRange = cur_char == '.' && buffer_pos + 1 < file_size && buffer[buffer_pos + 1] == '.';
+        if (!isRange && TryConsume('.')) {
             is_float = true;
             ConsumeZeroOrMore<Digit>();
         }
@@ -1331,6 +1451,9 @@ std::string Tokenizer::translateTokenType(Tokenizer::TokenType type) {
         case Tokenizer::TYPE_SYMBOL_DOT: 
             output = "DOT";
             break;
+        case Tokenizer::TYPE_SYMBOL_RANGE:
+            output = "RANGE";
+            break;
         case Tokenizer::TYPE_SYMBOL_GEQ:
             output = "GEQ";
             break;
@@ -76,10 +76,26 @@ class FileNode;
 typedef int ColumnNumber;
 
 /* ErrorCollector is modified from the Google Protobuf API. It is directly
-   implemented as a class rather than an abstract interface. */
+   implemented as a class rather than an abstract interface.
+
+   Diagnostics are printed as they arrive and also kept, so that a compile
+   that recovers from errors can report every problem at once. Once
+   maxErrors errors have been added the summary is printed and compilation
+   stops (0, the default, means no limit; a recovering Parser sets one). A collector that does not echo only keeps its
+   diagnostics, ie. to buffer those of a parallel parse until they can be
+   replayed in source order with AddAll(). */
 class ErrorCollector {
 public:
-    inline ErrorCollector() {}
+    struct Diagnostic {
+        bool isError;
+        int line;
+        ColumnNumber column;
+        std::string message;
+    };
+
+    inline ErrorCollector() : maxErrors(0), errorCount(0), warningCount(0), echo(true) {}
+    inline explicit ErrorCollector(int newMaxErrors) : maxErrors(newMaxErrors), errorCount(0), warningCount(0), echo(true) {}
+    inline ErrorCollector(int newMaxErrors, bool newEcho) : maxErrors(newMaxErrors), errorCount(0), warningCount(0), echo(newEcho) {}
 
     /* Indicates that there was an error in the input at the given line and
         column numbers. The numbers are zero-based, so you may want to add 1 to
@@ -90,6 +106,23 @@ public:
        column numbers. The numbers are zero-based, so you may want to add 1 to each
        before printing them. */
     void AddWarning(int line, ColumnNumber column, const std::string& message);
+
+    // adds every diagnostic of other, in order, as if it had been added here
+    void AddAll(const ErrorCollector& other);
+
+    void SetMaxErrors(int newMaxErrors);
+    int GetMaxErrors() const;
+    int GetErrorCount() const;
+    int GetWarningCount() const;
+    const std::vector<Diagnostic>& GetDiagnostics() const;
+    void PrintSummary() const;
+
+private:
+    std::vector<Diagnostic> diagnostics;
+    int maxErrors;
+    int errorCount;
+    int warningCount;
+    bool echo;
 };
 
 
@@ -147,6 +180,7 @@ class Tokenizer {
       TYPE_SYMBOL_NOT,                // !
       TYPE_SYMBOL_COMMA,              // ,
       TYPE_SYMBOL_DOT,                // .
+      TYPE_SYMBOL_RANGE,              // ..
       TYPE_SYMBOL_GEQ,                // >=
       TYPE_SYMBOL_LEQ,                // <=
       TYPE_SYMBOL_GT,                 // >
@@ -652,6 +686,12 @@ static int getFileSize(const char* fileName) {
 }
 
 static void fail(std::string errorMessage, Tokenizer::Token* curToken) {
+   if (recoveringCollector != nullptr) {
+      // parser resynchronizes at the next statement instead of exiting
+      recoveringCollector->AddError(curToken ? curToken->line : -1,
+                                    curToken ? curToken->column : -1, errorMessage);
+      throw SyntaxError(errorMessage);
+   }
    printf("\033[1;31m");    // format color as red
    printf("error: %s", errorMessage.c_str());
    exit(1);
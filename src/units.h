@@ -0,0 +1,155 @@
+#pragma once
+
+#include "ast.h"
+
+#include <cstdint>
+
+/*  Units:
+    --------------------------------------
+    Every UNIT has a dimension (exponents of the base quantities) and an
+    exact affine conversion to canonical units:
+
+        canonical = value * prefixScale(prefix) * scale + offset
+
+    Canonical units are SI with one exception: length is measured in
+    decimeters, so volumes come out in liters and concentrations in mol/L,
+    which is what the simulator's rate laws are written in. Everything here
+    is constexpr, so conversions of literals fold away at compile time.
+*/
+
+struct Dimension {
+    int8_t length = 0;
+    int8_t mass = 0;
+    int8_t time = 0;
+    int8_t current = 0;
+    int8_t temperature = 0;
+    int8_t amount = 0;
+    int8_t luminosity = 0;
+
+    constexpr bool operator==(const Dimension& other) const {
+        return length == other.length && mass == other.mass && time == other.time &&
+               current == other.current && temperature == other.temperature &&
+               amount == other.amount && luminosity == other.luminosity;
+    }
+    constexpr bool operator!=(const Dimension& other) const {
+        return !(*this == other);
+    }
+    constexpr Dimension operator*(const Dimension& other) const {
+        return { int8_t(length + other.length), int8_t(mass + other.mass), int8_t(time + other.time),
+                 int8_t(current + other.current), int8_t(temperature + other.temperature),
+                 int8_t(amount + other.amount), int8_t(luminosity + other.luminosity) };
+    }
+    constexpr Dimension operator/(const Dimension& other) const {
+        return *this * other.pow(-1);
+    }
+    constexpr Dimension pow(int exponent) const {
+        return { int8_t(length * exponent), int8_t(mass * exponent), int8_t(time * exponent),
+                 int8_t(current * exponent), int8_t(temperature * exponent),
+                 int8_t(amount * exponent), int8_t(luminosity * exponent) };
+    }
+    constexpr bool isDimensionless() const {
+        return *this == Dimension();
+    }
+};
+
+namespace dimensions {
+    constexpr Dimension NONE {};
+    constexpr Dimension LENGTH { 1, 0, 0, 0, 0, 0, 0 };
+    constexpr Dimension MASS { 0, 1, 0, 0, 0, 0, 0 };
+    constexpr Dimension TIME { 0, 0, 1, 0, 0, 0, 0 };
+    constexpr Dimension CURRENT { 0, 0, 0, 1, 0, 0, 0 };
+    constexpr Dimension TEMPERATURE { 0, 0, 0, 0, 1, 0, 0 };
+    constexpr Dimension AMOUNT { 0, 0, 0, 0, 0, 1, 0 };
+    constexpr Dimension LUMINOSITY { 0, 0, 0, 0, 0, 0, 1 };
+}
+
+struct UnitInfo {
+    Dimension dimension;
+    double scale;
+    double offset;
+};
+
+constexpr UnitInfo unitInfo(UNIT unit) {
+    switch (unit) {
+        case UNIT::NO_UNIT:     return { dimensions::NONE, 1, 0 };
+        case UNIT::LITER:       return { dimensions::LENGTH.pow(3), 1, 0 };
+        case UNIT::SEC:         return { dimensions::TIME, 1, 0 };
+        case UNIT::MIN:         return { dimensions::TIME, 60, 0 };
+        case UNIT::HR:          return { dimensions::TIME, 3600, 0 };
+        case UNIT::GRAM:        return { dimensions::MASS, 1e-3, 0 };
+        case UNIT::CELSIUS:     return { dimensions::TEMPERATURE, 1, 273.15 };
+        case UNIT::FAHRENHEIT:  return { dimensions::TEMPERATURE, 5.0 / 9.0, 459.67 * 5.0 / 9.0 };
+        case UNIT::KELVIN:      return { dimensions::TEMPERATURE, 1, 0 };
+        // kg * dm^2 / (s^3 * A)
+        case UNIT::VOLT:        return { dimensions::MASS * dimensions::LENGTH.pow(2) / (dimensions::TIME.pow(3) * dimensions::CURRENT), 100, 0 };
+        case UNIT::AMPERE:      return { dimensions::CURRENT, 1, 0 };
+        case UNIT::MOL:         return { dimensions::AMOUNT, 1, 0 };
+        case UNIT::MOLARITY:    return { dimensions::AMOUNT / dimensions::LENGTH.pow(3), 1, 0 };
+        case UNIT::MOLALITY:    return { dimensions::AMOUNT / dimensions::MASS, 1, 0 };
+        case UNIT::CANDELA:     return { dimensions::LUMINOSITY, 1, 0 };
+        // revolutions per second
+        case UNIT::RPM:         return { dimensions::TIME.pow(-1), 1.0 / 60.0, 0 };
+        // standard gravity, 9.80665 m/s^2
+        case UNIT::GFORCE:      return { dimensions::LENGTH / dimensions::TIME.pow(2), 98.0665, 0 };
+    }
+    return { dimensions::NONE, 1, 0 };
+}
+
+constexpr double prefixScale(PREFIX prefix) {
+    switch (prefix) {
+        case PREFIX::NO_PREFIX: return 1;
+        case PREFIX::Y:         return 1e24;
+        case PREFIX::Z:         return 1e21;
+        case PREFIX::E:         return 1e18;
+        case PREFIX::P:         return 1e15;
+        case PREFIX::T:         return 1e12;
+        case PREFIX::G:         return 1e9;
+        case PREFIX::M:         return 1e6;
+        case PREFIX::k:         return 1e3;
+        case PREFIX::h:         return 1e2;
+        case PREFIX::da:        return 1e1;
+        case PREFIX::d:         return 1e-1;
+        case PREFIX::c:         return 1e-2;
+        case PREFIX::m:         return 1e-3;
+        case PREFIX::u:         return 1e-6;
+        case PREFIX::n:         return 1e-9;
+        case PREFIX::p:         return 1e-12;
+        case PREFIX::f:         return 1e-15;
+        case PREFIX::a:         return 1e-18;
+        case PREFIX::z:         return 1e-21;
+        case PREFIX::y:         return 1e-24;
+    }
+    return 1;
+}
+
+constexpr Dimension dimensionOf(UNIT unit) {
+    return unitInfo(unit).dimension;
+}
+
+constexpr double toCanonical(double num, PREFIX prefix, UNIT unit) {
+    UnitInfo info = unitInfo(unit);
+    return num * prefixScale(prefix) * info.scale + info.offset;
+}
+
+constexpr double fromCanonical(double canonical, PREFIX prefix, UNIT unit) {
+    UnitInfo info = unitInfo(unit);
+    return (canonical - info.offset) / info.scale / prefixScale(prefix);
+}
+
+/* The first unit (in UNIT order) of the given dimension that has no offset,
+   used to express the result of multiplying or dividing quantities. False if
+   no unit has that dimension. */
+constexpr bool findUnitOf(Dimension dimension, UNIT* unit) {
+    for (int i = static_cast<int>(UNIT::NO_UNIT); i <= static_cast<int>(UNIT::GFORCE); i++) {
+        UnitInfo info = unitInfo(static_cast<UNIT>(i));
+        if (info.dimension == dimension && info.offset == 0) {
+            *unit = static_cast<UNIT>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+static_assert(toCanonical(2, PREFIX::NO_PREFIX, UNIT::HR) == 7200);
+static_assert(toCanonical(5, PREFIX::m, UNIT::MOLARITY) == 5 * 1e-3);
+static_assert(dimensionOf(UNIT::MOLARITY) == dimensionOf(UNIT::MOL) / dimensionOf(UNIT::LITER));
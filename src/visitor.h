@@ -0,0 +1,95 @@
+#pragma once
+
+#include "ast.h"
+
+/*  AST Visitor:
+    --------------------------------------
+    Dispatches on the NODE tag stored on every node and static_casts to the
+    concrete class, so a pass over the tree costs a switch per node rather
+    than virtual calls or dynamic_casts.
+
+    Passes derive from ASTVisitor<Pass, Result> (CRTP) and override only the
+    visit methods they care about. Every visit method that is not overridden
+    falls back to the visit method of its parent class in the node hierarchy,
+    ending at visitNode(), which returns a default-constructed Result.
+
+        class Counter : public ASTVisitor<Counter, int> {
+            public:
+                int visitSymbol(SymbolNode* symbol) { return 1; }
+                int visitNode(ASTNode* node) { return 0; }
+        };
+*/
+
+template<typename Derived, typename Result = void>
+class ASTVisitor {
+    public:
+        Result visit(ASTNode* node) {
+            switch (node->getNodeType()) {
+                case NODE::UNARY_NODE:
+                    return self().visitUnary(static_cast<UnaryNode*>(node));
+                case NODE::BINARY_NODE:
+                    return self().visitBinary(static_cast<BinaryNode*>(node));
+                case NODE::TERNARY_NODE:
+                    return self().visitTernary(static_cast<TernaryNode*>(node));
+                case NODE::LOOPING_NODE:
+                    return self().visitLooping(static_cast<LoopingNode*>(node));
+                case NODE::IF_NODE:
+                    return self().visitIf(static_cast<IfNode*>(node));
+                case NODE::IF_ELSE_NODE:
+                    return self().visitIfElse(static_cast<IfElseNode*>(node));
+                case NODE::NUMBER_NODE:
+                    return self().visitNumber(static_cast<NumberNode*>(node));
+                case NODE::SYMBOL_NODE:
+                    return self().visitSymbol(static_cast<SymbolNode*>(node));
+                case NODE::IDENTIFIER_NODE:
+                    return self().visitIdentifier(static_cast<IdentifierNode*>(node));
+                case NODE::FUNCTION_NODE:
+                    return self().visitFunction(static_cast<FunctionNode*>(node));
+                case NODE::PARAM_NODE:
+                    return self().visitParam(static_cast<ParamNode*>(node));
+                case NODE::RETURN_NODE:
+                    return self().visitReturn(static_cast<ReturnNode*>(node));
+                case NODE::CHEMICAL_NODE:
+                    return self().visitChemical(static_cast<ChemicalNode*>(node));
+                case NODE::KEYWORD_NODE:
+                    return self().visitKeyword(static_cast<KeywordNode*>(node));
+                case NODE::IMPORT_NODE:
+                    return self().visitImport(static_cast<ImportNode*>(node));
+                case NODE::INDEX_NODE:
+                    return self().visitIndex(static_cast<IndexNode*>(node));
+                case NODE::SPECIES_LIST_NODE:
+                    return self().visitSpeciesList(static_cast<SpeciesListNode*>(node));
+                default:
+                    return self().visitNode(node);
+            }
+        }
+
+        // base of the hierarchy
+        Result visitNode(ASTNode* node) { return Result(); }
+
+        // direct children of ASTNode
+        Result visitUnary(UnaryNode* node) { return self().visitNode(node); }
+        Result visitBinary(BinaryNode* node) { return self().visitNode(node); }
+        Result visitTernary(TernaryNode* node) { return self().visitNode(node); }
+        Result visitNumber(NumberNode* node) { return self().visitNode(node); }
+        Result visitIdentifier(IdentifierNode* node) { return self().visitNode(node); }
+        Result visitParam(ParamNode* node) { return self().visitNode(node); }
+        Result visitChemical(ChemicalNode* node) { return self().visitNode(node); }
+        Result visitImport(ImportNode* node) { return self().visitNode(node); }
+        Result visitSpeciesList(SpeciesListNode* node) { return self().visitNode(node); }
+
+        // grandchildren of ASTNode
+        Result visitFunction(FunctionNode* node) { return self().visitUnary(node); }
+        Result visitReturn(ReturnNode* node) { return self().visitUnary(node); }
+        Result visitSymbol(SymbolNode* node) { return self().visitBinary(node); }
+        Result visitLooping(LoopingNode* node) { return self().visitBinary(node); }
+        Result visitIf(IfNode* node) { return self().visitBinary(node); }
+        Result visitKeyword(KeywordNode* node) { return self().visitBinary(node); }
+        Result visitIndex(IndexNode* node) { return self().visitBinary(node); }
+        Result visitIfElse(IfElseNode* node) { return self().visitTernary(node); }
+
+    private:
+        Derived& self() {
+            return static_cast<Derived&>(*this);
+        }
+};
@@ -0,0 +1,508 @@
+#include "vm.h"
+#include "error.h"
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+// -DVM_COMPUTED_GOTO=0 forces the portable switch dispatch
+#ifndef VM_COMPUTED_GOTO
+#if defined(__GNUC__)
+#define VM_COMPUTED_GOTO 1
+#else
+#define VM_COMPUTED_GOTO 0
+#endif
+#endif
+
+static constexpr const char* opcodeTexts[] = {
+    "HALT", "MOVE", "ADD", "SUBTRACT", "MULTIPLY", "DIVIDE", "MODULO", "POWER",
+    "EQUALS", "NOT_EQUALS", "GEQ", "GT", "LEQ", "LT", "LOGI_AND", "LOGI_OR",
+    "JUMP", "JUMP_IF_FALSE", "CALL", "RETURN"
+};
+static_assert(sizeof(opcodeTexts) / sizeof(opcodeTexts[0]) == static_cast<size_t>(OPCODE::COUNT));
+
+static bool hasUnit(UNIT unit) {
+    return unit != UNIT::NO_UNIT;
+}
+
+static std::string unitName(PREFIX prefix, UNIT unit) {
+    return std::string(prefixToText(prefix)) + unitToText(unit);
+}
+
+[[noreturn]] static void compileError(const std::string& message, ASTNode* node) {
+    error(message + " on line " + std::to_string(node->getLine()) + ".\n");
+}
+
+static ASTNode* nextOf(ASTNode* statement) {
+    return statement->hasNextStatement ? statement->getNextStatement() : nullptr;
+}
+
+void Bytecode::print() const {
+    std::cout << "+ Bytecode: " << code.size() << " instructions, " << image.size() << " registers" << std::endl;
+    for (size_t i = 0; i < code.size(); i++) {
+        const Instruction& instruction = code[i];
+        std::cout << i << ": " << opcodeTexts[static_cast<size_t>(instruction.op)];
+        switch (instruction.op) {
+            case OPCODE::HALT:
+                break;
+            case OPCODE::JUMP:
+            case OPCODE::CALL:
+                std::cout << " " << instruction.target();
+                break;
+            case OPCODE::JUMP_IF_FALSE:
+                std::cout << " r" << instruction.a << ", " << instruction.target();
+                break;
+            case OPCODE::RETURN:
+                std::cout << " r" << instruction.a;
+                break;
+            case OPCODE::MOVE:
+                std::cout << " r" << instruction.a << ", r" << instruction.b;
+                break;
+            default:
+                std::cout << " r" << instruction.a << ", r" << instruction.b << ", r" << instruction.c;
+                break;
+        }
+        std::cout << std::endl;
+    }
+}
+
+/* Bytecode compiler */
+Bytecode BytecodeCompiler::compile(ASTNode* tree, Scope* newScope) {
+    bytecode = Bytecode();
+    scope = newScope;
+    variableIds.clear();
+    constantIds.clear();
+    freeTemporaries.clear();
+    statementTemporaries.clear();
+
+    compileStatements(tree);
+    emit(OPCODE::HALT);
+    return std::move(bytecode);
+}
+
+void BytecodeCompiler::compileStatements(ASTNode* statement) {
+    for (; statement != nullptr; statement = nextOf(statement)) {
+        compileStatement(statement);
+        // nothing computed by a statement is live once it has run
+        freeTemporaries.insert(freeTemporaries.end(), statementTemporaries.begin(), statementTemporaries.end());
+        statementTemporaries.clear();
+    }
+}
+
+void BytecodeCompiler::compileStatement(ASTNode* statement) {
+    if (LoopingNode* loop = nodeCast<LoopingNode>(statement)) {
+        size_t exitJump;
+        if (loop->getLoopType() == LOOPING::FOR) {
+            // for (declaration; condition; increment) is parsed as
+            // declaration + if-else(condition, body, increment)
+            IfElseNode* runOrIncrement = nodeCast<IfElseNode>(loop->getRight());
+            if (runOrIncrement == nullptr) {
+                compileError("Malformed for loop", loop);
+            }
+            compileStatements(loop->getLeft());
+            size_t loopStart = bytecode.code.size();
+            compileCondition(runOrIncrement->getLeft(), &exitJump);
+            compileStatements(runOrIncrement->getCenter());
+            compileStatements(runOrIncrement->getRight());
+            patchJump(emitJump(OPCODE::JUMP), loopStart);
+        } else {
+            size_t loopStart = bytecode.code.size();
+            compileCondition(loop->getLeft(), &exitJump);
+            compileStatements(loop->getRight());
+            patchJump(emitJump(OPCODE::JUMP), loopStart);
+        }
+        patchJump(exitJump, bytecode.code.size());
+    }
+    else if (IfElseNode* ifElse = nodeCast<IfElseNode>(statement)) {
+        size_t elseJump;
+        compileCondition(ifElse->getLeft(), &elseJump);
+        compileStatements(ifElse->getCenter());
+        size_t endJump = emitJump(OPCODE::JUMP);
+        patchJump(elseJump, bytecode.code.size());
+        compileStatements(ifElse->getRight());
+        patchJump(endJump, bytecode.code.size());
+    }
+    else if (IfNode* ifNode = nodeCast<IfNode>(statement)) {
+        size_t endJump;
+        compileCondition(ifNode->getLeft(), &endJump);
+        compileStatements(ifNode->getRight());
+        patchJump(endJump, bytecode.code.size());
+    }
+    else if (ReturnNode* returnNode = nodeCast<ReturnNode>(statement)) {
+        emit(OPCODE::RETURN, compileExpression(returnNode->getChild()).reg);
+    }
+    else if (SymbolNode* symbol = nodeCast<SymbolNode>(statement);
+             symbol != nullptr && symbol->getSymbol() == SYMBOL::ASSIGNMENT &&
+             nodeCast<IdentifierNode>(symbol->getLeft()) != nullptr) {
+        compileAssignment(symbol);
+    }
+    else if (statement->getNodeType() == NODE::AST_NODE) {
+        // <empty block>
+    }
+    else {
+        size_t index = bytecode.statements.size();
+        bytecode.statements.push_back(statement);
+        size_t call = emit(OPCODE::CALL);
+        bytecode.code[call].setTarget(index);
+    }
+}
+
+void BytecodeCompiler::compileAssignment(SymbolNode* assignment) {
+    uint16_t variable = variableRegister(static_cast<IdentifierNode*>(assignment->getLeft()));
+    // variables hold the number in whatever unit it was computed in, as the scope does
+    Value value = compileExpression(assignment->getRight(), variable);
+    if (value.reg != variable) {
+        emit(OPCODE::MOVE, variable, value.reg);
+    }
+}
+
+void BytecodeCompiler::compileCondition(ASTNode* condition, size_t* exitJump) {
+    Value value = compileExpression(condition);
+    *exitJump = emitJump(OPCODE::JUMP_IF_FALSE, value.reg);
+}
+
+/* Returns the register holding the value of node. Operators write to target if
+   it is given; literals and variables are returned in their own registers. */
+BytecodeCompiler::Value BytecodeCompiler::compileExpression(ASTNode* node, int target) {
+    if (node == nullptr) {
+        error("Missing operand in expression.\n");
+    }
+    if (NumberNode* number = nodeCast<NumberNode>(node)) {
+        Quantity quantity = number->getQuantity();
+        return { constantRegister(quantity.num), quantity.prefix, quantity.unit };
+    }
+    if (IdentifierNode* identifier = nodeCast<IdentifierNode>(node)) {
+        return { variableRegister(identifier), PREFIX::NO_PREFIX, UNIT::NO_UNIT };
+    }
+    if (SymbolNode* symbol = nodeCast<SymbolNode>(node)) {
+        return compileSymbol(symbol, target);
+    }
+    compileError("Cannot compile " + node->getText() + " as a number", node);
+}
+
+/* Same operators and unit rules as ASTNode::evaluate(). */
+BytecodeCompiler::Value BytecodeCompiler::compileSymbol(SymbolNode* symbol, int target) {
+    Value left = compileExpression(symbol->getLeft());
+    Value right = compileExpression(symbol->getRight());
+    OPCODE op;
+    bool matchUnits = true;
+    bool comparison = false;
+
+    switch (symbol->getSymbol()) {
+        case SYMBOL::ADD:           op = OPCODE::ADD; break;
+        case SYMBOL::SUBTRACT:      op = OPCODE::SUBTRACT; break;
+        case SYMBOL::PERCENT:       op = OPCODE::MODULO; break;
+        case SYMBOL::EQUALS:        op = OPCODE::EQUALS; comparison = true; break;
+        case SYMBOL::NOT_EQUALS:    op = OPCODE::NOT_EQUALS; comparison = true; break;
+        case SYMBOL::GEQ:           op = OPCODE::GEQ; comparison = true; break;
+        case SYMBOL::GT:            op = OPCODE::GT; comparison = true; break;
+        case SYMBOL::LEQ:           op = OPCODE::LEQ; comparison = true; break;
+        case SYMBOL::LT:            op = OPCODE::LT; comparison = true; break;
+        case SYMBOL::LOGI_AND:      op = OPCODE::LOGI_AND; matchUnits = false; comparison = true; break;
+        case SYMBOL::LOGI_OR:       op = OPCODE::LOGI_OR; matchUnits = false; comparison = true; break;
+        case SYMBOL::MULTIPLY:      op = OPCODE::MULTIPLY; matchUnits = false; break;
+        case SYMBOL::DIVIDE:        op = OPCODE::DIVIDE; matchUnits = false; break;
+        case SYMBOL::CARAT:         op = OPCODE::POWER; matchUnits = false; break;
+        default:
+            compileError("Cannot compile operation with symbol " + symbol->getText(), symbol);
+    }
+    uint16_t result = target >= 0 ? target : temporary();
+
+    if (matchUnits) {
+        if (!hasUnit(right.unit)) {
+            right.prefix = left.prefix;
+            right.unit = left.unit;
+        } else if (!hasUnit(left.unit)) {
+            left.prefix = right.prefix;
+            left.unit = right.unit;
+        } else if (dimensionOf(left.unit) != dimensionOf(right.unit)) {
+            compileError("Cannot apply " + symbol->getText() + " to " + unitName(left.prefix, left.unit) +
+                         " and " + unitName(right.prefix, right.unit), symbol);
+        } else {
+            right = convert(right, left.prefix, left.unit, -1);
+        }
+        emit(op, result, left.reg, right.reg);
+        if (comparison) {
+            return { result, PREFIX::NO_PREFIX, UNIT::NO_UNIT };
+        }
+        return { result, left.prefix, left.unit };
+    }
+
+    switch (op) {
+        case OPCODE::MULTIPLY: {
+            if (hasUnit(left.unit) && hasUnit(right.unit)) {
+                Dimension dimension = dimensionOf(left.unit) * dimensionOf(right.unit);
+                left = canonical(left, -1);
+                right = canonical(right, -1);
+                emit(op, result, left.reg, right.reg);
+                return withDimension({ result, PREFIX::NO_PREFIX, UNIT::NO_UNIT }, dimension, symbol, result);
+            }
+            Value unit = hasUnit(left.unit) ? left : right;
+            emit(op, result, left.reg, right.reg);
+            return { result, unit.prefix, unit.unit };
+        }
+        case OPCODE::DIVIDE: {
+            if (hasUnit(right.unit)) {
+                Dimension dimension = dimensionOf(left.unit) / dimensionOf(right.unit);
+                left = canonical(left, -1);
+                right = canonical(right, -1);
+                emit(op, result, left.reg, right.reg);
+                return withDimension({ result, PREFIX::NO_PREFIX, UNIT::NO_UNIT }, dimension, symbol, result);
+            }
+            emit(op, result, left.reg, right.reg);
+            return { result, left.prefix, left.unit };
+        }
+        case OPCODE::POWER: {
+            if (hasUnit(right.unit)) {
+                compileError("Exponent " + unitName(right.prefix, right.unit) + " must be a plain number", symbol);
+            }
+            if (!hasUnit(left.unit)) {
+                emit(op, result, left.reg, right.reg);
+                return { result, PREFIX::NO_PREFIX, UNIT::NO_UNIT };
+            }
+            // the unit of the result has to be known here, so the exponent must be a literal
+            NumberNode* exponentNode = nodeCast<NumberNode>(symbol->getRight());
+            if (exponentNode == nullptr || std::floor(exponentNode->getNum()) != exponentNode->getNum()) {
+                compileError("Cannot raise " + unitName(left.prefix, left.unit) + " to a power that is not an integer literal", symbol);
+            }
+            Dimension dimension = dimensionOf(left.unit).pow(static_cast<int>(exponentNode->getNum()));
+            left = canonical(left, -1);
+            emit(op, result, left.reg, right.reg);
+            return withDimension({ result, PREFIX::NO_PREFIX, UNIT::NO_UNIT }, dimension, symbol, result);
+        }
+        default:
+            // logical operators
+            emit(op, result, left.reg, right.reg);
+            return { result, PREFIX::NO_PREFIX, UNIT::NO_UNIT };
+    }
+}
+
+BytecodeCompiler::Value BytecodeCompiler::convert(Value value, PREFIX prefix, UNIT unit, int target) {
+    if (value.prefix == prefix && value.unit == unit) {
+        return value;
+    }
+    // conversions are affine: x -> x * scale + offset
+    double offset = fromCanonical(toCanonical(0, value.prefix, value.unit), prefix, unit);
+    double scale = fromCanonical(toCanonical(1, value.prefix, value.unit), prefix, unit) - offset;
+    Value converted = affine(value, scale, offset, target);
+    converted.prefix = prefix;
+    converted.unit = unit;
+    return converted;
+}
+
+BytecodeCompiler::Value BytecodeCompiler::canonical(Value value, int target) {
+    UnitInfo info = unitInfo(value.unit);
+    Value converted = affine(value, prefixScale(value.prefix) * info.scale, info.offset, target);
+    // canonical values are tracked as plain numbers; callers know their dimension
+    converted.prefix = PREFIX::NO_PREFIX;
+    converted.unit = UNIT::NO_UNIT;
+    return converted;
+}
+
+BytecodeCompiler::Value BytecodeCompiler::withDimension(Value value, Dimension dimension, SymbolNode* symbol, int target) {
+    UNIT unit;
+    if (!findUnitOf(dimension, &unit)) {
+        compileError("No unit has the dimension of the result of " + symbol->getText(), symbol);
+    }
+    Value converted = affine(value, 1 / unitInfo(unit).scale, 0, target);
+    converted.prefix = PREFIX::NO_PREFIX;
+    converted.unit = unit;
+    return converted;
+}
+
+BytecodeCompiler::Value BytecodeCompiler::affine(Value value, double scale, double offset, int target) {
+    if (scale == 1 && offset == 0) {
+        return value;
+    }
+    uint16_t result = target >= 0 ? target : temporary();
+    uint16_t source = value.reg;
+    if (scale != 1) {
+        emit(OPCODE::MULTIPLY, result, source, constantRegister(scale));
+        source = result;
+    }
+    if (offset != 0) {
+        emit(OPCODE::ADD, result, source, constantRegister(offset));
+    }
+    value.reg = result;
+    return value;
+}
+
+uint16_t BytecodeCompiler::variableRegister(IdentifierNode* identifier) {
+    // the parser's binding if it made one, else the innermost declaration
+    ResolvedSlot binding = identifier->getResolved();
+    if (binding.kind != RESOLVED::VARIABLE) {
+        binding.scope = scope != NULL ? scope->resolve(identifier->getName(), &binding.index) : NULL;
+    }
+    if (binding.scope == NULL) {
+        compileError("Identifier " + identifier->getName() + " is not declared", identifier);
+    }
+
+    std::unordered_map<int, uint16_t>& slots = variableIds[binding.scope];
+    auto found = slots.find(binding.index);
+    if (found != slots.end()) {
+        return found->second;
+    }
+    uint16_t reg = newRegister();
+    slots.emplace(binding.index, reg);
+    bytecode.variables.push_back({ binding.scope, binding.index, reg });
+    return reg;
+}
+
+uint16_t BytecodeCompiler::constantRegister(double num) {
+    uint64_t bits;
+    std::memcpy(&bits, &num, sizeof(bits));
+    auto found = constantIds.find(bits);
+    if (found != constantIds.end()) {
+        return found->second;
+    }
+    uint16_t reg = newRegister();
+    bytecode.image[reg] = num;
+    constantIds.emplace(bits, reg);
+    return reg;
+}
+
+uint16_t BytecodeCompiler::temporary() {
+    uint16_t reg;
+    if (!freeTemporaries.empty()) {
+        reg = freeTemporaries.back();
+        freeTemporaries.pop_back();
+    } else {
+        reg = newRegister();
+    }
+    statementTemporaries.push_back(reg);
+    return reg;
+}
+
+uint16_t BytecodeCompiler::newRegister() {
+    if (bytecode.image.size() > UINT16_MAX) {
+        error("Protocol needs more than 65536 registers.\n");
+    }
+    bytecode.image.push_back(0);
+    return static_cast<uint16_t>(bytecode.image.size() - 1);
+}
+
+size_t BytecodeCompiler::emit(OPCODE op, uint16_t a, uint16_t b, uint16_t c) {
+    bytecode.code.push_back({ op, a, b, c });
+    return bytecode.code.size() - 1;
+}
+
+size_t BytecodeCompiler::emitJump(OPCODE op, uint16_t a) {
+    return emit(op, a);
+}
+
+void BytecodeCompiler::patchJump(size_t jump, size_t target) {
+    bytecode.code[jump].setTarget(static_cast<uint32_t>(target));
+}
+
+/* Virtual machine */
+void VirtualMachine::setHost(std::function<void(ASTNode*)> newHost) {
+    host = std::move(newHost);
+}
+
+double VirtualMachine::run(const Bytecode& bytecode) {
+    registers = bytecode.image;
+    for (const VariableRegister& variable : bytecode.variables) {
+        const SymbolValue& value = variable.scope->getSymbolValue(variable.slot);
+        if (value.index() == 0) {
+            registers[variable.reg] = std::get<double>(value);
+        }
+    }
+
+    double* r = registers.data();
+    const Instruction* code = bytecode.code.data();
+    const Instruction* ip = code;
+
+/* Each handler ends in VM_NEXT() or VM_DISPATCH(). With computed goto every
+   handler jumps straight to the next one through the label table; otherwise
+   they 'continue' back to the switch. */
+#if VM_COMPUTED_GOTO
+    static const void* const labels[] = {
+        &&op_HALT, &&op_MOVE, &&op_ADD, &&op_SUBTRACT, &&op_MULTIPLY, &&op_DIVIDE,
+        &&op_MODULO, &&op_POWER, &&op_EQUALS, &&op_NOT_EQUALS, &&op_GEQ, &&op_GT,
+        &&op_LEQ, &&op_LT, &&op_LOGI_AND, &&op_LOGI_OR, &&op_JUMP, &&op_JUMP_IF_FALSE,
+        &&op_CALL, &&op_RETURN, &&op_COUNT
+    };
+    static_assert(sizeof(labels) / sizeof(labels[0]) == static_cast<size_t>(OPCODE::COUNT) + 1);
+#define VM_CASE(name) op_##name:
+#define VM_DISPATCH() goto *labels[static_cast<size_t>(ip->op)]
+#else
+#define VM_CASE(name) case OPCODE::name:
+#define VM_DISPATCH() continue
+#endif
+#define VM_NEXT() ip++; VM_DISPATCH()
+#define VM_BINARY(name, expression) \
+    VM_CASE(name) { double b = r[ip->b]; double c = r[ip->c]; r[ip->a] = (expression); VM_NEXT(); }
+
+#if VM_COMPUTED_GOTO
+    VM_DISPATCH();
+#else
+    for (;;) {
+        switch (ip->op) {
+#endif
+            VM_CASE(HALT) {
+                return 0;
+            }
+            VM_CASE(MOVE) {
+                r[ip->a] = r[ip->b];
+                VM_NEXT();
+            }
+            VM_BINARY(ADD, b + c)
+            VM_BINARY(SUBTRACT, b - c)
+            VM_BINARY(MULTIPLY, b * c)
+            VM_BINARY(DIVIDE, b / c)
+            VM_BINARY(MODULO, std::fmod(b, c))
+            VM_BINARY(POWER, std::pow(b, c))
+            VM_BINARY(EQUALS, b == c)
+            VM_BINARY(NOT_EQUALS, b != c)
+            VM_BINARY(GEQ, b >= c)
+            VM_BINARY(GT, b > c)
+            VM_BINARY(LEQ, b <= c)
+            VM_BINARY(LT, b < c)
+            VM_BINARY(LOGI_AND, b && c)
+            VM_BINARY(LOGI_OR, b || c)
+            VM_CASE(JUMP) {
+                ip = code + ip->target();
+                VM_DISPATCH();
+            }
+            VM_CASE(JUMP_IF_FALSE) {
+                ip = r[ip->a] == 0 ? code + ip->target() : ip + 1;
+                VM_DISPATCH();
+            }
+            VM_CASE(CALL) {
+                if (host) {
+                    host(bytecode.statements[ip->target()]);
+                }
+                VM_NEXT();
+            }
+            VM_CASE(RETURN) {
+                return r[ip->a];
+            }
+            VM_CASE(COUNT) {
+                error("Invalid bytecode instruction.\n");
+            }
+#if !VM_COMPUTED_GOTO
+        }
+    }
+#endif
+
+#undef VM_BINARY
+#undef VM_NEXT
+#undef VM_DISPATCH
+#undef VM_CASE
+}
+
+void VirtualMachine::store(const Bytecode& bytecode) {
+    for (const VariableRegister& variable : bytecode.variables) {
+        variable.scope->putVal(variable.scope->getSymbolName(variable.slot), registers[variable.reg]);
+    }
+}
+
+double VirtualMachine::getVariable(const Bytecode& bytecode, const std::string& name) const {
+    for (const VariableRegister& variable : bytecode.variables) {
+        if (variable.scope->getSymbolName(variable.slot) == name) {
+            return registers[variable.reg];
+        }
+    }
+    error("Variable " + name + " is not used by the protocol.\n");
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "ast.h"
+#include "scope.h"
+#include "units.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*  Bytecode VM:
+    --------------------------------------
+    Runs protocol logic (assignments, for/while loops, if/else, return) and
+    numeric expressions without walking the tree. BytecodeCompiler lowers a
+    statement chain to a flat list of register instructions once, and
+    VirtualMachine executes that list with a dispatch loop (computed goto on
+    GCC and Clang, a switch everywhere else).
+
+    Registers hold doubles and are laid out when compiling:
+        variables   one register per (scope, slot) the code reads or writes
+        constants   one register per distinct literal, filled in the image
+        temporaries reused from statement to statement
+
+    Units are resolved while compiling. Every expression has a static prefix
+    and unit (variables are plain numbers), so the conversions that
+    ASTNode::evaluate() performs on each call become constant multiply/add
+    instructions, or a compile error if the dimensions do not match.
+
+    Statements that are not protocol logic (reactions, function calls, ...)
+    compile to a CALL that hands the node to the host, in program order.
+*/
+
+enum class OPCODE : uint8_t {
+    HALT,
+    MOVE,               // a = b
+    ADD,                // a = b + c
+    SUBTRACT,           // a = b - c
+    MULTIPLY,           // a = b * c
+    DIVIDE,             // a = b / c
+    MODULO,             // a = fmod(b, c)
+    POWER,              // a = pow(b, c)
+    EQUALS,             // a = b == c
+    NOT_EQUALS,         // a = b != c
+    GEQ,                // a = b >= c
+    GT,                 // a = b > c
+    LEQ,                // a = b <= c
+    LT,                 // a = b < c
+    LOGI_AND,           // a = b && c
+    LOGI_OR,            // a = b || c
+    JUMP,               // pc = target
+    JUMP_IF_FALSE,      // if (!a) pc = target
+    CALL,               // host(statements[target])
+    RETURN,             // result = a, stop
+    COUNT
+};
+
+/* 8 bytes. Registers are 16-bit; jumps keep a 32-bit target in b (low half)
+   and c (high half). */
+struct Instruction {
+    OPCODE op;
+    uint16_t a;
+    uint16_t b;
+    uint16_t c;
+
+    uint32_t target() const {
+        return static_cast<uint32_t>(b) | (static_cast<uint32_t>(c) << 16);
+    }
+    void setTarget(uint32_t newTarget) {
+        b = static_cast<uint16_t>(newTarget & 0xFFFF);
+        c = static_cast<uint16_t>(newTarget >> 16);
+    }
+};
+
+struct VariableRegister {
+    Scope* scope;
+    int slot;
+    uint16_t reg;
+};
+
+struct Bytecode {
+    std::vector<Instruction> code;
+    std::vector<double> image;                  // initial register values (constants)
+    std::vector<VariableRegister> variables;    // loaded from their scopes before each run
+    std::vector<ASTNode*> statements;           // CALL targets
+
+    void print() const;
+};
+
+class BytecodeCompiler {
+    public:
+        BytecodeCompiler() {}
+
+        // compiles the statement chain starting at tree. Identifiers without a
+        // parser binding are resolved from scope outwards.
+        Bytecode compile(ASTNode* tree, Scope* scope);
+
+    private:
+        // register + static unit of a compiled expression
+        struct Value {
+            uint16_t reg;
+            PREFIX prefix;
+            UNIT unit;
+        };
+
+        void compileStatements(ASTNode* statement);
+        void compileStatement(ASTNode* statement);
+        void compileAssignment(SymbolNode* assignment);
+        void compileCondition(ASTNode* condition, size_t* exitJump);
+        Value compileExpression(ASTNode* node, int target = -1);
+        Value compileSymbol(SymbolNode* symbol, int target);
+
+        // rewrites value (converting its register if needed) into prefix + unit
+        Value convert(Value value, PREFIX prefix, UNIT unit, int target);
+        Value canonical(Value value, int target);
+        // canonical value of dimension -> first unit of that dimension (see findUnitOf)
+        Value withDimension(Value value, Dimension dimension, SymbolNode* symbol, int target);
+        Value affine(Value value, double scale, double offset, int target);
+
+        uint16_t variableRegister(IdentifierNode* identifier);
+        uint16_t constantRegister(double num);
+        uint16_t temporary();
+        uint16_t newRegister();
+
+        size_t emit(OPCODE op, uint16_t a = 0, uint16_t b = 0, uint16_t c = 0);
+        size_t emitJump(OPCODE op, uint16_t a = 0);
+        void patchJump(size_t jump, size_t target);
+
+        Bytecode bytecode;
+        Scope* scope = nullptr;
+        std::unordered_map<Scope*, std::unordered_map<int, uint16_t>> variableIds;
+        std::unordered_map<uint64_t, uint16_t> constantIds;         // keyed by bit pattern
+        std::vector<uint16_t> freeTemporaries;
+        std::vector<uint16_t> statementTemporaries;     // returned to freeTemporaries after each statement
+};
+
+class VirtualMachine {
+    public:
+        VirtualMachine() {}
+
+        // handler for CALL instructions; without one they are skipped
+        void setHost(std::function<void(ASTNode*)> newHost);
+
+        // runs bytecode and returns the value of its return statement (0 if none)
+        double run(const Bytecode& bytecode);
+        // writes the variables of the last run back into their scopes
+        void store(const Bytecode& bytecode);
+        // value of a variable after the last run
+        double getVariable(const Bytecode& bytecode, const std::string& name) const;
+
+    private:
+        std::vector<double> registers;
+        std::function<void(ASTNode*)> host;
+};
@@ -0,0 +1,125 @@
+#include "parser.h"
+#include "vm.h"
+#include "error.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*  Bytecode VM benchmark:
+    --------------------------------------
+    Runs a loop-heavy protocol (nested for loops, if/else, a while loop) once
+    by walking the tree with ASTNode::evaluate() and once on the bytecode VM,
+    checks that both leave the same values behind and prints the times.
+
+        make vm_bench [iterations=N]
+*/
+
+static std::string loopProtocol(int iterations) {
+    std::string n = std::to_string(iterations);
+    return "int total = 0;\n"
+           "int evens = 0;\n"
+           "for (int i = 0; i < " + n + "; i = i + 1) {\n"
+           "    for (int j = 0; j < 100; j = j + 1) {\n"
+           "        if (j % 2 == 0) {\n"
+           "            evens = evens + 1;\n"
+           "        } else {\n"
+           "            total = total + i * j - evens;\n"
+           "        }\n"
+           "    }\n"
+           "}\n"
+           "int steps = 0;\n"
+           "while (steps < " + n + " * 100) {\n"
+           "    steps = steps + 2;\n"
+           "}\n";
+}
+
+/* Tree-walking reference: the same statements as BytecodeCompiler, executed
+   by evaluating each expression on the tree and storing into the scope. */
+static void treeWalk(ASTNode* statement, Scope* scope) {
+    for (; statement != nullptr;
+         statement = statement->hasNextStatement ? statement->getNextStatement() : nullptr) {
+        if (LoopingNode* loop = nodeCast<LoopingNode>(statement)) {
+            if (loop->getLoopType() == LOOPING::FOR) {
+                IfElseNode* runOrIncrement = static_cast<IfElseNode*>(loop->getRight());
+                treeWalk(loop->getLeft(), scope);
+                while (runOrIncrement->getLeft()->evaluate(scope).num != 0) {
+                    treeWalk(runOrIncrement->getCenter(), scope);
+                    treeWalk(runOrIncrement->getRight(), scope);
+                }
+            } else {
+                while (loop->getLeft()->evaluate(scope).num != 0) {
+                    treeWalk(loop->getRight(), scope);
+                }
+            }
+        }
+        else if (IfElseNode* ifElse = nodeCast<IfElseNode>(statement)) {
+            treeWalk(ifElse->getLeft()->evaluate(scope).num != 0 ? ifElse->getCenter() : ifElse->getRight(), scope);
+        }
+        else if (IfNode* ifNode = nodeCast<IfNode>(statement)) {
+            if (ifNode->getLeft()->evaluate(scope).num != 0) {
+                treeWalk(ifNode->getRight(), scope);
+            }
+        }
+        else if (SymbolNode* symbol = nodeCast<SymbolNode>(statement)) {
+            IdentifierNode* identifier = nodeCast<IdentifierNode>(symbol->getLeft());
+            if (symbol->getSymbol() == SYMBOL::ASSIGNMENT && identifier != nullptr) {
+                double value = symbol->getRight()->evaluate(scope).num;
+                int slot;
+                scope->resolve(identifier->getName(), &slot)->putVal(identifier->getName(), value);
+            }
+        }
+    }
+}
+
+template<typename Run>
+static double milliseconds(Run run) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::stoi(argv[1]) : 10000;
+    std::string source = loopProtocol(iterations);
+    std::vector<char> input(source.begin(), source.end());
+    input.push_back('\0');
+
+    ErrorCollector collect;
+    Tokenizer* tokenizer = new Tokenizer(input.data(), &collect);
+    tokenizer->setFileSize(source.size());
+    auto [head, tail] = tokenizer->tokenize(input.data());
+    tokenizer->findIdentifiers(head);
+    tokenizer->findChemicals(head);
+
+    Parser* parser = new Parser(head);
+    ASTNode* root = parser->parse();
+    Scope* global = parser->getScope("global");
+
+    double treeTime = milliseconds([&] { treeWalk(root, global); });
+    std::vector<double> treeValues;
+    for (const char* name : { "total", "evens", "steps" }) {
+        treeValues.push_back(std::get<double>(global->getSymbolValue(name)));
+    }
+
+    BytecodeCompiler compiler;
+    VirtualMachine vm;
+    Bytecode bytecode;
+    double compileTime = milliseconds([&] { bytecode = compiler.compile(root, global); });
+    double vmTime = milliseconds([&] { vm.run(bytecode); });
+
+    int index = 0;
+    for (const char* name : { "total", "evens", "steps" }) {
+        if (vm.getVariable(bytecode, name) != treeValues[index++]) {
+            error(std::string("Bytecode VM and tree walker disagree on ") + name + ".\n");
+        }
+    }
+
+    std::cout << "+ " << iterations << " x 100 loop iterations, " << bytecode.code.size() << " instructions" << std::endl;
+    std::cout << "tree walker:  " << treeTime << " ms" << std::endl;
+    std::cout << "bytecode vm:  " << vmTime << " ms (+ " << compileTime << " ms to compile), "
+              << treeTime / vmTime << "x" << std::endl;
+    return 0;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "ast.h"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/*  AST Walker:
+    --------------------------------------
+    Depth-first traversal of an AST with an explicit stack. Neither child
+    depth nor the length of a nextStatement chain uses C++ stack frames, so a
+    file with 100k top-level statements walks the same as a file with ten.
+
+    Each walk claims a new epoch number. A node is marked visited by storing
+    the epoch on it, which means no reset pass is needed between walks, and a
+    node reachable twice in the same walk is only visited once.
+
+    Hooks:
+        pre(node, depth, fromNextStatement) -> bool
+            called when a node is first reached. Returning false skips the
+            node's children (its next statement is still walked).
+        post(node, depth)
+            called after all of the node's children, and their statement
+            chains, have been walked.
+
+    Children are walked at depth + 1; a next statement is walked at the same
+    depth as the statement before it.
+*/
+
+class ASTWalker {
+    public:
+        ASTWalker() : epoch(claimEpoch()) {}
+
+        template<typename Pre>
+        void walk(ASTNode* root, Pre pre) {
+            walk(root, pre, [](ASTNode*, int) {});
+        }
+
+        template<typename Pre, typename Post>
+        void walk(ASTNode* root, Pre pre, Post post) {
+            if (root == nullptr) {
+                return;
+            }
+            stack.clear();
+            stack.push_back({ root, 0, false, false });
+
+            while (!stack.empty()) {
+                WalkStep step = stack.back();
+                stack.pop_back();
+                ASTNode* node = step.node;
+
+                if (step.exit) {
+                    post(node, step.depth);
+                    continue;
+                }
+                if (node->visitEpoch == epoch) {
+                    continue;
+                }
+                node->visitEpoch = epoch;
+
+                bool descend = pre(node, step.depth, step.fromNextStatement);
+
+                // pushed in reverse so that children are walked first, in order,
+                // followed by the exit hook and then the next statement
+                if (node->hasNextStatement && node->getNextStatement() != nullptr) {
+                    stack.push_back({ node->getNextStatement(), step.depth, true, false });
+                }
+                stack.push_back({ node, step.depth, false, true });
+                if (descend) {
+                    ChildSpan children = node->getChildren();
+                    for (size_t i = children.size(); i > 0; i--) {
+                        stack.push_back({ children[i - 1], step.depth + 1, false, false });
+                    }
+                }
+            }
+        }
+
+        uint32_t getEpoch() const {
+            return epoch;
+        }
+
+    private:
+        struct WalkStep {
+            ASTNode* node;
+            int depth;
+            bool fromNextStatement;
+            bool exit;
+        };
+
+        static uint32_t claimEpoch() {
+            static std::atomic<uint32_t> nextEpoch{1};
+            uint32_t claimed = nextEpoch.fetch_add(1);
+            if (claimed == 0) {
+                // 0 is the epoch of a node that has never been walked
+                claimed = nextEpoch.fetch_add(1);
+            }
+            return claimed;
+        }
+
+        uint32_t epoch;
+        std::vector<WalkStep> stack;
+};